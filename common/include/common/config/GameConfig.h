@@ -27,6 +27,7 @@ struct GameConfig
     CfgVar<WndMode> wnd_mode = FULLSCREEN;
     CfgVar<bool> vsync = true;
     CfgVar<unsigned> geometry_cache_size{32, [](auto val) { return std::clamp(val, 2u, 32u); }};
+    CfgVar<unsigned> dynamic_geometry_buffer_size{49152, [](auto val) { return std::clamp(val, 6144u, 1048576u); }};
 
     static unsigned min_fps_limit;
     static unsigned max_fps_limit;
@@ -58,6 +59,8 @@ struct GameConfig
     CfgVar<bool> muzzle_flash = true;
     CfgVar<bool> glares = true;
     CfgVar<bool> show_enemy_bullets = true;
+    CfgVar<bool> gpu_particles = false;
+    CfgVar<bool> multithreaded_rendering = false;
 
     static constexpr float min_fov = 75.0f;
     static constexpr float max_fov = 160.0f;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <random>
+
+// Simulation of bad network conditions for one direction of traffic. The code is independent of the platform.
+//
+// Simulator only decides what happens with a datagram - if it is lost, when it is delivered and if it is duplicated.
+// Caller keeps the datagrams until their delivery time. All random decisions use a seeded generator so a test can be
+// reproduced by using the same seed.
+
+struct NetConditions
+{
+    // One-way delay
+    int latency_ms = 0;
+    // Maximal random delay added to the latency
+    int jitter_ms = 0;
+    // Probabilities in range 0-1
+    float loss = 0.0f;
+    float duplicate = 0.0f;
+    // Probability that a datagram is held back so it arrives after datagrams sent later
+    float reorder = 0.0f;
+    // 0 means unlimited bandwidth
+    int bytes_per_second = 0;
+
+    [[nodiscard]] bool active() const
+    {
+        return latency_ms > 0 || jitter_ms > 0 || loss > 0.0f || duplicate > 0.0f || reorder > 0.0f ||
+            bytes_per_second > 0;
+    }
+};
+
+struct NetConditionSimStats
+{
+    unsigned long long num_datagrams = 0;
+    unsigned long long num_lost = 0;
+    unsigned long long num_duplicated = 0;
+    unsigned long long num_reordered = 0;
+};
+
+class NetConditionSim
+{
+public:
+    // Additional delay of reordered datagrams
+    static constexpr int reorder_delay_ms = 30;
+
+    explicit NetConditionSim(unsigned seed = 1) : rng_{seed} {}
+
+    void set_conditions(const NetConditions& conditions)
+    {
+        conditions_ = conditions;
+    }
+
+    [[nodiscard]] const NetConditions& conditions() const
+    {
+        return conditions_;
+    }
+
+    // Restarts the random generator and clears statistics
+    void reset(unsigned seed);
+
+    // Decides the fate of a datagram sent at the given time. Writes delivery times of its copies and returns their
+    // count (0 if the datagram is lost, 2 if it is duplicated).
+    int schedule(std::size_t len, int now_ms, std::array<int, 2>& deliver_ms);
+
+    [[nodiscard]] const NetConditionSimStats& stats() const
+    {
+        return stats_;
+    }
+
+private:
+    bool chance(float probability);
+    int delay(int now_ms);
+
+    NetConditions conditions_;
+    std::mt19937 rng_;
+    int link_busy_until_ms_ = 0;
+    NetConditionSimStats stats_;
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// Delta compression of obj_update packets. The code is independent of the platform.
+//
+// Stock obj_update payload is parsed into a snapshot of quantized object states. Every snapshot sent to a client gets
+// a sequence number and is encoded as a difference against the newest snapshot acknowledged by the client (or against
+// an empty snapshot if there is none). Decoder keeps received snapshots so it can reconstruct the full state and
+// convert it back to the stock obj_update payload.
+//
+// packet:  u16 sequence, u16 baseline sequence, u8 flags, varint object count, objects
+// object:  varint handle delta (objects are sorted by handle), u8 field mask, changed fields
+//
+// Integers are little-endian, varints use LEB128 encoding and signed deltas are zigzag encoded.
+
+// Position is quantized to 1/1024 m
+constexpr float obj_update_pos_scale = 1024.0f;
+// Number of snapshots that can be used as a baseline
+constexpr int obj_update_delta_history_size = 32;
+
+struct ObjUpdateState
+{
+    static constexpr uint8_t flag_pos_rot_anim = 0x01;
+
+    uint32_t handle = 0;
+    uint8_t flags = 0;
+    // Fields below are set only if flag_pos_rot_anim is present in flags
+    uint16_t ticks = 0;
+    std::array<int32_t, 3> pos{};
+    int16_t angle_x = 0;
+    int16_t angle_y = 0;
+    // state flags, move_dir_x, move_dir_y, move_speed
+    std::array<uint8_t, 4> movement{};
+    // Remaining optional fields (amp flags, weapon, health and armor, etc.) copied verbatim
+    std::vector<std::byte> extra;
+
+    bool operator==(const ObjUpdateState& other) const = default;
+};
+
+// Objects are sorted by handle
+using ObjUpdateSnapshot = std::vector<ObjUpdateState>;
+
+// Location of a single object in stock obj_update payload
+struct ObjUpdateEntryView
+{
+    uint32_t handle = 0;
+    uint8_t flags = 0;
+    std::size_t offset = 0;
+    std::size_t size = 0;
+};
+
+// Splits stock obj_update payload (without game packet header) into objects without decoding them. Objects keep
+// the original order. Returns false if payload is malformed.
+bool obj_update_split(const std::byte* data, std::size_t len, std::vector<ObjUpdateEntryView>& entries);
+
+// Parses stock obj_update payload (without game packet header). Returns false if payload is malformed or contains
+// positions that cannot be quantized.
+bool obj_update_parse(const std::byte* data, std::size_t len, ObjUpdateSnapshot& snapshot);
+// Builds stock obj_update payload (without game packet header)
+void obj_update_write(const ObjUpdateSnapshot& snapshot, std::vector<std::byte>& out);
+
+class ObjUpdateDeltaEncoder
+{
+public:
+    // Encodes snapshot and remembers it as a possible baseline for next packets
+    void encode(const ObjUpdateSnapshot& snapshot, std::vector<std::byte>& out);
+    void ack(uint16_t sequence);
+
+    [[nodiscard]] std::optional<uint16_t> acked_sequence() const
+    {
+        return acked_sequence_;
+    }
+
+private:
+    struct HistoryEntry
+    {
+        bool valid = false;
+        uint16_t sequence = 0;
+        ObjUpdateSnapshot snapshot;
+    };
+
+    std::array<HistoryEntry, obj_update_delta_history_size> history_;
+    uint16_t next_sequence_ = 0;
+    std::optional<uint16_t> acked_sequence_;
+};
+
+class ObjUpdateDeltaDecoder
+{
+public:
+    // Returns false if packet is malformed or its baseline is not available
+    bool decode(const std::byte* data, std::size_t len, ObjUpdateSnapshot& snapshot);
+
+    // Newest sequence received so far (it should be acknowledged)
+    [[nodiscard]] std::optional<uint16_t> last_sequence() const
+    {
+        return last_sequence_;
+    }
+
+private:
+    struct HistoryEntry
+    {
+        bool valid = false;
+        uint16_t sequence = 0;
+        ObjUpdateSnapshot snapshot;
+    };
+
+    std::array<HistoryEntry, obj_update_delta_history_size> history_;
+    std::optional<uint16_t> last_sequence_;
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <common/rfproto.h>
+
+// Bounds-checked reading and writing of packets described in rfproto.h. The code is independent of the platform.
+//
+// Reader never copies the packet buffer - strings are returned as views into it and fixed-size structures are copied
+// into values directly from the buffer (they are packed so they cannot be accessed in place safely). Every read
+// checks the remaining length and puts the reader into a failed state if the packet is too short. After a failure all
+// subsequent reads fail too, so it is enough to check the result once after reading all fields.
+
+// Layout checks of packet structures used by the codec. Offsets are relative to the end of the game packet header.
+static_assert(sizeof(RF_GamePacketHeader) == 3);
+static_assert(sizeof(RF_Vector) == 12);
+static_assert(sizeof(RF_Matrix) == 36);
+static_assert(sizeof(RF_EntityCreatePacketRest) == 71);
+static_assert(offsetof(RF_EntityCreatePacketRest, entity_handle) == 2);
+static_assert(offsetof(RF_EntityCreatePacketRest, pos) == 10);
+static_assert(offsetof(RF_EntityCreatePacketRest, player_id) == 58);
+static_assert(offsetof(RF_EntityCreatePacketRest, weapon) == 63);
+static_assert(sizeof(RF_ReloadPacket) == sizeof(RF_GamePacketHeader) + 16);
+static_assert(offsetof(RF_ReloadPacket, weapon) == sizeof(RF_GamePacketHeader) + 4);
+static_assert(sizeof(RF_TeamChangePacket) == sizeof(RF_GamePacketHeader) + 2);
+static_assert(offsetof(RF_ChatLinePacket, message) == sizeof(RF_GamePacketHeader) + 2);
+
+class PacketReader
+{
+public:
+    PacketReader(const void* data, std::size_t len) :
+        data_(static_cast<const std::byte*>(data)), len_(len)
+    {}
+
+    template<typename T>
+    std::optional<T> read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (!ensure(sizeof(T))) {
+            return {};
+        }
+        T value;
+        std::memcpy(&value, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return {value};
+    }
+
+    // Reads zero-terminated string that is at most max_len characters long (without the terminator)
+    std::optional<std::string_view> read_string(std::size_t max_len)
+    {
+        if (failed_) {
+            return {};
+        }
+        auto begin = reinterpret_cast<const char*>(data_ + pos_);
+        std::size_t limit = std::min(remaining(), max_len + 1);
+        auto end = static_cast<const char*>(std::memchr(begin, 0, limit));
+        if (!end) {
+            failed_ = true;
+            return {};
+        }
+        std::string_view str{begin, static_cast<std::size_t>(end - begin)};
+        pos_ += str.size() + 1;
+        return {str};
+    }
+
+    bool skip(std::size_t n)
+    {
+        if (!ensure(n)) {
+            return false;
+        }
+        pos_ += n;
+        return true;
+    }
+
+    [[nodiscard]] const std::byte* current() const
+    {
+        return data_ + pos_;
+    }
+
+    [[nodiscard]] std::size_t offset() const
+    {
+        return pos_;
+    }
+
+    [[nodiscard]] std::size_t remaining() const
+    {
+        return failed_ ? 0 : len_ - pos_;
+    }
+
+    [[nodiscard]] bool failed() const
+    {
+        return failed_;
+    }
+
+private:
+    bool ensure(std::size_t n)
+    {
+        if (failed_ || len_ - pos_ < n) {
+            failed_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    const std::byte* data_;
+    std::size_t len_;
+    std::size_t pos_ = 0;
+    bool failed_ = false;
+};
+
+class PacketWriter
+{
+public:
+    PacketWriter(void* buf, std::size_t capacity) :
+        buf_(static_cast<std::byte*>(buf)), capacity_(capacity)
+    {}
+
+    template<typename T>
+    bool write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return write_bytes(&value, sizeof(T));
+    }
+
+    // Writes string with zero terminator
+    bool write_string(std::string_view str)
+    {
+        if (str.find('\0') != std::string_view::npos || !ensure(str.size() + 1)) {
+            failed_ = true;
+            return false;
+        }
+        std::memcpy(buf_ + pos_, str.data(), str.size());
+        buf_[pos_ + str.size()] = std::byte{0};
+        pos_ += str.size() + 1;
+        return true;
+    }
+
+    bool write_bytes(const void* data, std::size_t len)
+    {
+        if (!ensure(len)) {
+            return false;
+        }
+        std::memcpy(buf_ + pos_, data, len);
+        pos_ += len;
+        return true;
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        return pos_;
+    }
+
+    [[nodiscard]] bool failed() const
+    {
+        return failed_;
+    }
+
+private:
+    bool ensure(std::size_t n)
+    {
+        if (failed_ || capacity_ - pos_ < n) {
+            failed_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    std::byte* buf_;
+    std::size_t capacity_;
+    std::size_t pos_ = 0;
+    bool failed_ = false;
+};
+
+// Writes game packet header and payload produced by the callback. Returns total packet size or 0 if packet does not
+// fit in the buffer.
+template<typename F>
+std::size_t write_game_packet(void* buf, std::size_t capacity, uint8_t type, F&& write_payload)
+{
+    PacketWriter writer{buf, capacity};
+    if (!writer.write(RF_GamePacketHeader{}) || !write_payload(writer) || writer.failed() ||
+        writer.size() - sizeof(RF_GamePacketHeader) > UINT16_MAX) {
+        return 0;
+    }
+    RF_GamePacketHeader header;
+    header.type = type;
+    header.size = static_cast<uint16_t>(writer.size() - sizeof(header));
+    std::memcpy(buf, &header, sizeof(header));
+    return writer.size();
+}
+
+// Returns reader limited to payload of the first game packet in the buffer or nullopt if the packet is truncated
+inline std::optional<PacketReader> read_game_packet(const void* data, std::size_t len, RF_GamePacketHeader& header)
+{
+    PacketReader reader{data, len};
+    auto hdr = reader.read<RF_GamePacketHeader>();
+    if (!hdr || reader.remaining() < hdr.value().size) {
+        return {};
+    }
+    header = hdr.value();
+    return {PacketReader{reader.current(), header.size}};
+}
+
+// Parsed entity_create packet payload. Name points into the packet buffer.
+struct EntityCreatePacketView
+{
+    std::string_view name;
+    RF_EntityCreatePacketRest rest;
+};
+
+// Entity names are copied by the game into a 256 bytes buffer
+constexpr std::size_t rf_max_entity_name_len = 255;
+
+inline std::optional<EntityCreatePacketView> read_entity_create_packet(PacketReader& reader)
+{
+    auto name = reader.read_string(rf_max_entity_name_len);
+    auto rest = reader.read<RF_EntityCreatePacketRest>();
+    if (!name || !rest) {
+        return {};
+    }
+    return {EntityCreatePacketView{name.value(), rest.value()}};
+}
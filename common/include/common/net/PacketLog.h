@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Binary log of received multiplayer datagrams. The format is independent of the platform:
+//
+// header:  char magic[4] = "DFPL", u16 version, u16 reserved, u64 capture start time (seconds since Unix epoch)
+// record:  u32 timestamp (milliseconds since capture start), u32 IP address, u16 port, u8 flags, u16 data length,
+//          data bytes
+//
+// All integers are little-endian. IP address and port are stored exactly as in rf::NetAddr (network byte order).
+
+struct PacketLogRecord
+{
+    static constexpr uint8_t flag_reliable = 1;
+
+    uint32_t timestamp_ms = 0;
+    uint32_t ip_addr = 0;
+    uint16_t port = 0;
+    uint8_t flags = 0;
+    std::vector<std::byte> data;
+
+    [[nodiscard]] bool is_reliable() const
+    {
+        return (flags & flag_reliable) != 0;
+    }
+};
+
+class PacketLogWriter
+{
+public:
+    PacketLogWriter(const std::string& filename, uint64_t start_time);
+    void write(const PacketLogRecord& record);
+    void flush();
+
+private:
+    std::ofstream stream_;
+};
+
+class PacketLogReader
+{
+public:
+    PacketLogReader(const std::string& filename);
+
+    // Returns false at the end of the log
+    bool read(PacketLogRecord& record);
+
+    [[nodiscard]] uint64_t start_time() const
+    {
+        return start_time_;
+    }
+
+private:
+    std::ifstream stream_;
+    uint64_t start_time_ = 0;
+};
+
+constexpr char packet_log_magic[4] = {'D', 'F', 'P', 'L'};
+constexpr uint16_t packet_log_version = 1;
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// Reliable ordered byte stream used between DF servers and clients instead of the stock reliable channel. The code is
+// independent of the platform.
+//
+// Sender splits written data into segments with 16-bit sequence numbers. Receiver acknowledges the next expected
+// sequence number and a bitfield of segments received out of order (selective acknowledgement). Sender estimates
+// smoothed RTT like TCP (RFC 6298) to compute the retransmission timeout, retransmits a segment as soon as 3 later
+// segments are acknowledged or a later segment was acknowledged more than RTT ago (fast retransmit) and limits the
+// number of segments in flight with a congestion window (slow start and congestion avoidance).
+//
+// data:  u16 sequence, payload
+// ack:   u16 next expected sequence, u32 bitfield of received segments (bit N is set if segment with sequence
+//        next_expected + 1 + N was received)
+//
+// Integers are little-endian.
+
+constexpr std::size_t reliable_transport_max_segment_data_size = 480;
+constexpr std::size_t reliable_transport_data_header_size = 2;
+constexpr std::size_t reliable_transport_ack_size = 6;
+// Maximal number of unacknowledged segments (limited by the size of the acknowledgement bitfield)
+constexpr unsigned reliable_transport_max_window = 32;
+
+struct ReliableSenderStats
+{
+    unsigned long long num_segments_sent = 0;
+    unsigned long long num_retransmits = 0;
+    unsigned long long num_fast_retransmits = 0;
+    unsigned long long num_timeouts = 0;
+};
+
+class ReliableSender
+{
+public:
+    // Appends data to the stream
+    void write(const std::byte* data, std::size_t len);
+
+    // Processes acknowledgement. Returns false if it is malformed.
+    bool process_ack(const std::byte* data, std::size_t len, int now_ms);
+
+    // Sends new segments allowed by the congestion window and retransmits lost ones
+    void poll(int now_ms, const std::function<void(const std::byte*, std::size_t)>& send);
+
+    // True if some segment could not be delivered after many retransmissions
+    [[nodiscard]] bool failed() const
+    {
+        return failed_;
+    }
+
+    [[nodiscard]] bool idle() const
+    {
+        return segments_.empty() && queue_.empty();
+    }
+
+    [[nodiscard]] int srtt_ms() const
+    {
+        return static_cast<int>(srtt_);
+    }
+
+    [[nodiscard]] int rto_ms() const
+    {
+        return rto_;
+    }
+
+    [[nodiscard]] float cwnd() const
+    {
+        return cwnd_;
+    }
+
+    [[nodiscard]] std::size_t num_unacked() const
+    {
+        return segments_.size();
+    }
+
+    [[nodiscard]] std::size_t queued_bytes() const
+    {
+        return queue_.size();
+    }
+
+    [[nodiscard]] const ReliableSenderStats& stats() const
+    {
+        return stats_;
+    }
+
+private:
+    struct Segment
+    {
+        uint16_t seq = 0;
+        std::vector<std::byte> data;
+        int sent_ms = 0;
+        int num_transmissions = 0;
+        bool acked = false;
+        bool lost = false;
+    };
+
+    void update_rtt(int sample_ms);
+    void on_loss(bool timeout);
+    void detect_losses(int now_ms);
+    void transmit(Segment& segment, int now_ms, const std::function<void(const std::byte*, std::size_t)>& send);
+
+    std::deque<Segment> segments_;
+    std::deque<std::byte> queue_;
+    uint16_t next_seq_ = 0;
+    bool has_rtt_ = false;
+    float srtt_ = 0.0f;
+    float rttvar_ = 0.0f;
+    int rto_ = 1000;
+    float cwnd_ = 16.0f;
+    float ssthresh_ = static_cast<float>(reliable_transport_max_window);
+    bool in_recovery_ = false;
+    uint16_t recovery_seq_ = 0;
+    // Send time of the most recently sent segment that was acknowledged
+    bool has_delivered_ = false;
+    int last_delivered_sent_ms_ = 0;
+    bool failed_ = false;
+    ReliableSenderStats stats_;
+};
+
+class ReliableReceiver
+{
+public:
+    // Processes data segment. Returns false if it is malformed.
+    bool process_data(const std::byte* data, std::size_t len);
+
+    // Appends data received in order to the output
+    void read(std::vector<std::byte>& out);
+
+    // Writes acknowledgement if any segment was received since the last call
+    bool poll_ack(std::vector<std::byte>& out);
+
+private:
+    uint16_t next_expected_ = 0;
+    std::array<std::vector<std::byte>, reliable_transport_max_window> window_;
+    std::array<bool, reliable_transport_max_window> received_{};
+    std::vector<std::byte> ready_;
+    bool ack_pending_ = false;
+};
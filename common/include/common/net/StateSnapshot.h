@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// World state snapshot sent to a player joining a level. The code is independent of the platform.
+//
+// Stock server answers state_info_request with many small reliable packets (booleans, glass, clutter, triggers, etc.)
+// followed by state_info_done. Snapshot is a zlib compressed concatenation of these game packets (including their
+// headers) split into chunks that are sent one by one. Receiver decompresses the complete snapshot and processes the
+// packets in the original order.
+//
+// chunk:  u16 snapshot ID, u16 chunk index, u16 chunk count, u32 uncompressed size, compressed data
+//
+// Integers are little-endian.
+
+// Maximal size of compressed data in a single chunk so the whole chunk fits into one reliable datagram
+constexpr std::size_t state_snapshot_max_chunk_data_size = 400;
+// Snapshots bigger than this are rejected by the receiver
+constexpr std::size_t state_snapshot_max_size = 16 * 1024 * 1024;
+
+struct StateSnapshotChunkHeader
+{
+    uint16_t snapshot_id = 0;
+    uint16_t chunk_index = 0;
+    uint16_t num_chunks = 0;
+    uint32_t uncompressed_size = 0;
+};
+
+constexpr std::size_t state_snapshot_chunk_header_size = 10;
+
+class StateSnapshotBuilder
+{
+public:
+    // Adds game packet including its header
+    void add_packet(const std::byte* data, std::size_t len);
+    void clear();
+
+    // Compresses collected packets. Returns a list of encoded chunks (with chunk headers) or an empty list on failure.
+    [[nodiscard]] std::vector<std::vector<std::byte>> build(uint16_t snapshot_id, int compression_level = 6) const;
+
+    // Concatenated packets in the order they were added
+    [[nodiscard]] const std::vector<std::byte>& data() const
+    {
+        return data_;
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        return data_.size();
+    }
+
+    [[nodiscard]] std::size_t num_packets() const
+    {
+        return num_packets_;
+    }
+
+private:
+    std::vector<std::byte> data_;
+    std::size_t num_packets_ = 0;
+};
+
+class StateSnapshotReceiver
+{
+public:
+    enum class Result
+    {
+        incomplete,
+        complete,
+        error,
+    };
+
+    // Adds encoded chunk (with chunk header). Chunks of a newer snapshot replace the old one.
+    Result add_chunk(const std::byte* data, std::size_t len);
+
+    // Decompressed snapshot. Valid after add_chunk returned Result::complete.
+    [[nodiscard]] const std::vector<std::byte>& data() const
+    {
+        return data_;
+    }
+
+    [[nodiscard]] float progress() const
+    {
+        return num_chunks_ > 0 ? static_cast<float>(num_received_) / static_cast<float>(num_chunks_) : 0.0f;
+    }
+
+    [[nodiscard]] std::size_t compressed_size() const
+    {
+        return compressed_.size();
+    }
+
+    void reset();
+
+private:
+    bool active_ = false;
+    uint16_t snapshot_id_ = 0;
+    uint16_t num_chunks_ = 0;
+    uint16_t num_received_ = 0;
+    uint32_t uncompressed_size_ = 0;
+    std::vector<std::vector<std::byte>> chunks_;
+    std::vector<std::byte> compressed_;
+    std::vector<std::byte> data_;
+};
+
+bool state_snapshot_parse_chunk_header(const std::byte* data, std::size_t len, StateSnapshotChunkHeader& header);
+
+// Calls the callback for every game packet in the snapshot (data includes the packet header). Returns false if
+// the snapshot is malformed.
+bool state_snapshot_for_each_packet(const std::vector<std::byte>& snapshot,
+    const std::function<void(const std::byte*, std::size_t)>& callback);
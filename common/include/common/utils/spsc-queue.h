@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+// Lock-free bounded queue for a single producer thread and a single consumer thread
+template <typename T, std::size_t N>
+class SpscQueue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+    std::array<T, N> slots_;
+    // Indices grow indefinitely and are wrapped when accessing slots. Head and tail are kept on separate cache lines
+    // so producer and consumer do not slow each other down.
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+
+public:
+    // Called by the producer. Returns false if the queue is full.
+    bool try_push(const T& value)
+    {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        slots_[tail & (N - 1)] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Called by the consumer
+    std::optional<T> try_pop()
+    {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return {};
+        }
+        std::optional<T> value{slots_[head & (N - 1)]};
+        head_.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+};
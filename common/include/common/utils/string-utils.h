@@ -181,3 +181,25 @@ inline std::string_view get_ext_from_filename(std::string_view filename)
     return filename.substr(dot_pos + 1);
 }
 
+inline std::string json_escape(std::string_view str)
+{
+    static constexpr char hex_digits[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(str.size());
+    for (char c : str) {
+        auto uc = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        }
+        else if (uc < 0x20) {
+            result += "\\u00";
+            result += hex_digits[uc >> 4];
+            result += hex_digits[uc & 0xF];
+        }
+        else {
+            result += c;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,48 @@
+#include <common/net/NetConditionSim.h>
+#include <algorithm>
+
+void NetConditionSim::reset(unsigned seed)
+{
+    rng_.seed(seed);
+    link_busy_until_ms_ = 0;
+    stats_ = {};
+}
+
+bool NetConditionSim::chance(float probability)
+{
+    return probability > 0.0f && std::uniform_real_distribution<float>{0.0f, 1.0f}(rng_) < probability;
+}
+
+int NetConditionSim::delay(int now_ms)
+{
+    int jitter = conditions_.jitter_ms > 0 ? std::uniform_int_distribution<int>{0, conditions_.jitter_ms}(rng_) : 0;
+    int result = now_ms + conditions_.latency_ms + jitter;
+    if (chance(conditions_.reorder)) {
+        result += reorder_delay_ms;
+        ++stats_.num_reordered;
+    }
+    return result;
+}
+
+int NetConditionSim::schedule(std::size_t len, int now_ms, std::array<int, 2>& deliver_ms)
+{
+    ++stats_.num_datagrams;
+    if (chance(conditions_.loss)) {
+        ++stats_.num_lost;
+        return 0;
+    }
+    int send_ms = now_ms;
+    if (conditions_.bytes_per_second > 0) {
+        // Datagrams leave the link one after another so a queue builds up if it is too slow
+        auto transmit_ms = static_cast<int>(len * 1000 / static_cast<std::size_t>(conditions_.bytes_per_second));
+        link_busy_until_ms_ = std::max(link_busy_until_ms_, now_ms) + transmit_ms;
+        send_ms = link_busy_until_ms_;
+    }
+    deliver_ms[0] = delay(send_ms);
+    if (chance(conditions_.duplicate)) {
+        ++stats_.num_duplicated;
+        deliver_ms[1] = delay(send_ms);
+        return 2;
+    }
+    return 1;
+}
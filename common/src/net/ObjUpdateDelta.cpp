@@ -0,0 +1,529 @@
+#include <common/net/ObjUpdateDelta.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // obj_update flags that add data to the stock packet (see RF_ObjectUpdateFlags in rfproto.h)
+    constexpr uint8_t ouf_unknown4 = 0x02;
+    constexpr uint8_t ouf_weapon_type = 0x04;
+    constexpr uint8_t ouf_unknown3 = 0x08;
+    constexpr uint8_t ouf_health_armor = 0x20;
+    constexpr uint8_t ouf_amp_flags = 0x80;
+
+    constexpr uint32_t obj_update_terminator = 0xFFFFFFFF;
+    constexpr std::size_t pos_rot_anim_size = 22;
+
+    // Delta packet
+    constexpr uint8_t delta_flag_has_baseline = 0x01;
+    // Delta object field mask
+    constexpr uint8_t field_flags = 0x01;
+    constexpr uint8_t field_ticks = 0x02;
+    constexpr uint8_t field_pos_x = 0x04;
+    constexpr uint8_t field_pos_y = 0x08;
+    constexpr uint8_t field_pos_z = 0x10;
+    constexpr uint8_t field_angles = 0x20;
+    constexpr uint8_t field_movement = 0x40;
+    constexpr uint8_t field_extra = 0x80;
+    // Protection against huge allocations caused by malformed packets
+    constexpr uint32_t max_objects = 1024;
+
+    class ByteWriter
+    {
+    public:
+        ByteWriter(std::vector<std::byte>& out) : out_{out} {}
+
+        void write_u8(uint8_t value)
+        {
+            out_.push_back(static_cast<std::byte>(value));
+        }
+
+        template<typename T>
+        void write_le(T value)
+        {
+            for (std::size_t i = 0; i < sizeof(T); ++i) {
+                write_u8(static_cast<uint8_t>((static_cast<uint64_t>(value) >> (i * 8)) & 0xFF));
+            }
+        }
+
+        void write_varint(uint32_t value)
+        {
+            while (value >= 0x80) {
+                write_u8(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            write_u8(static_cast<uint8_t>(value));
+        }
+
+        void write_zigzag(int32_t value)
+        {
+            write_varint((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+        }
+
+        void write_bytes(const std::byte* data, std::size_t len)
+        {
+            out_.insert(out_.end(), data, data + len);
+        }
+
+    private:
+        std::vector<std::byte>& out_;
+    };
+
+    class ByteReader
+    {
+    public:
+        ByteReader(const std::byte* data, std::size_t len) : data_{data}, len_{len} {}
+
+        bool read_u8(uint8_t& value)
+        {
+            if (pos_ >= len_) {
+                return false;
+            }
+            value = static_cast<uint8_t>(data_[pos_++]);
+            return true;
+        }
+
+        template<typename T>
+        bool read_le(T& value)
+        {
+            if (len_ - pos_ < sizeof(T)) {
+                return false;
+            }
+            uint64_t result = 0;
+            for (std::size_t i = 0; i < sizeof(T); ++i) {
+                result |= static_cast<uint64_t>(data_[pos_ + i]) << (i * 8);
+            }
+            pos_ += sizeof(T);
+            value = static_cast<T>(result);
+            return true;
+        }
+
+        bool read_varint(uint32_t& value)
+        {
+            value = 0;
+            for (int shift = 0; shift < 35; shift += 7) {
+                uint8_t byte = 0;
+                if (!read_u8(byte)) {
+                    return false;
+                }
+                value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool read_zigzag(int32_t& value)
+        {
+            uint32_t raw = 0;
+            if (!read_varint(raw)) {
+                return false;
+            }
+            value = static_cast<int32_t>((raw >> 1) ^ (~(raw & 1) + 1));
+            return true;
+        }
+
+        bool read_bytes(std::vector<std::byte>& out, std::size_t len)
+        {
+            if (len_ - pos_ < len) {
+                return false;
+            }
+            out.assign(data_ + pos_, data_ + pos_ + len);
+            pos_ += len;
+            return true;
+        }
+
+        bool skip(std::size_t len)
+        {
+            if (len_ - pos_ < len) {
+                return false;
+            }
+            pos_ += len;
+            return true;
+        }
+
+        [[nodiscard]] std::size_t pos() const
+        {
+            return pos_;
+        }
+
+        [[nodiscard]] const std::byte* data() const
+        {
+            return data_;
+        }
+
+        [[nodiscard]] bool at_end() const
+        {
+            return pos_ == len_;
+        }
+
+    private:
+        const std::byte* data_;
+        std::size_t len_;
+        std::size_t pos_ = 0;
+    };
+
+    bool quantize_pos(float value, int32_t& result)
+    {
+        float scaled = value * obj_update_pos_scale;
+        if (!std::isfinite(scaled) || std::fabs(scaled) >= 2147483520.0f) {
+            return false;
+        }
+        result = static_cast<int32_t>(std::lround(scaled));
+        return true;
+    }
+
+    bool is_newer_sequence(uint16_t a, uint16_t b)
+    {
+        return static_cast<int16_t>(static_cast<uint16_t>(a - b)) > 0;
+    }
+
+    const ObjUpdateState* find_in_snapshot(const ObjUpdateSnapshot& snapshot, uint32_t handle)
+    {
+        auto it = std::lower_bound(snapshot.begin(), snapshot.end(), handle,
+            [](const ObjUpdateState& state, uint32_t h) { return state.handle < h; });
+        if (it != snapshot.end() && it->handle == handle) {
+            return &*it;
+        }
+        return nullptr;
+    }
+
+    std::size_t get_extra_fixed_size(uint8_t flags)
+    {
+        std::size_t size = 0;
+        if (flags & ouf_amp_flags) {
+            size += 1;
+        }
+        if (flags & ouf_weapon_type) {
+            size += 1;
+        }
+        if (flags & ouf_health_armor) {
+            size += 3;
+        }
+        return size;
+    }
+
+    // Skips optional fields that follow the position block
+    bool skip_optional_fields(ByteReader& reader, uint8_t flags)
+    {
+        if (!reader.skip(get_extra_fixed_size(flags))) {
+            return false;
+        }
+        if (flags & ouf_unknown3) {
+            uint8_t count = 0;
+            if (!reader.read_u8(count) || !reader.skip(count * 3u)) {
+                return false;
+            }
+        }
+        if ((flags & ouf_unknown4) && !reader.skip(2)) {
+            return false;
+        }
+        return true;
+    }
+
+    void encode_object(ByteWriter& writer, const ObjUpdateState& state, const ObjUpdateState& base)
+    {
+        uint8_t mask = 0;
+        if (state.flags != base.flags) {
+            mask |= field_flags;
+        }
+        if (state.ticks != base.ticks) {
+            mask |= field_ticks;
+        }
+        if (state.pos[0] != base.pos[0]) {
+            mask |= field_pos_x;
+        }
+        if (state.pos[1] != base.pos[1]) {
+            mask |= field_pos_y;
+        }
+        if (state.pos[2] != base.pos[2]) {
+            mask |= field_pos_z;
+        }
+        if (state.angle_x != base.angle_x || state.angle_y != base.angle_y) {
+            mask |= field_angles;
+        }
+        if (state.movement != base.movement) {
+            mask |= field_movement;
+        }
+        if (state.extra != base.extra) {
+            mask |= field_extra;
+        }
+
+        writer.write_u8(mask);
+        if (mask & field_flags) {
+            writer.write_u8(state.flags);
+        }
+        if (mask & field_ticks) {
+            writer.write_zigzag(static_cast<int16_t>(state.ticks - base.ticks));
+        }
+        for (int i = 0; i < 3; ++i) {
+            if (mask & (field_pos_x << i)) {
+                // Wrapping difference is decoded properly even if it overflows
+                writer.write_zigzag(static_cast<int32_t>(static_cast<uint32_t>(state.pos[i]) - static_cast<uint32_t>(base.pos[i])));
+            }
+        }
+        if (mask & field_angles) {
+            writer.write_zigzag(static_cast<int16_t>(state.angle_x - base.angle_x));
+            writer.write_zigzag(static_cast<int16_t>(state.angle_y - base.angle_y));
+        }
+        if (mask & field_movement) {
+            for (uint8_t value : state.movement) {
+                writer.write_u8(value);
+            }
+        }
+        if (mask & field_extra) {
+            writer.write_varint(static_cast<uint32_t>(state.extra.size()));
+            writer.write_bytes(state.extra.data(), state.extra.size());
+        }
+    }
+
+    bool decode_object(ByteReader& reader, ObjUpdateState& state, const ObjUpdateState& base)
+    {
+        uint8_t mask = 0;
+        if (!reader.read_u8(mask)) {
+            return false;
+        }
+        uint32_t handle = state.handle;
+        state = base;
+        state.handle = handle;
+        if ((mask & field_flags) && !reader.read_u8(state.flags)) {
+            return false;
+        }
+        int32_t delta = 0;
+        if (mask & field_ticks) {
+            if (!reader.read_zigzag(delta)) {
+                return false;
+            }
+            state.ticks = static_cast<uint16_t>(base.ticks + delta);
+        }
+        for (int i = 0; i < 3; ++i) {
+            if (mask & (field_pos_x << i)) {
+                if (!reader.read_zigzag(delta)) {
+                    return false;
+                }
+                state.pos[i] = static_cast<int32_t>(static_cast<uint32_t>(base.pos[i]) + static_cast<uint32_t>(delta));
+            }
+        }
+        if (mask & field_angles) {
+            if (!reader.read_zigzag(delta)) {
+                return false;
+            }
+            state.angle_x = static_cast<int16_t>(base.angle_x + delta);
+            if (!reader.read_zigzag(delta)) {
+                return false;
+            }
+            state.angle_y = static_cast<int16_t>(base.angle_y + delta);
+        }
+        if (mask & field_movement) {
+            for (uint8_t& value : state.movement) {
+                if (!reader.read_u8(value)) {
+                    return false;
+                }
+            }
+        }
+        if (mask & field_extra) {
+            uint32_t extra_len = 0;
+            if (!reader.read_varint(extra_len) || !reader.read_bytes(state.extra, extra_len)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool obj_update_split(const std::byte* data, std::size_t len, std::vector<ObjUpdateEntryView>& entries)
+{
+    entries.clear();
+    ByteReader reader{data, len};
+    while (true) {
+        ObjUpdateEntryView entry;
+        entry.offset = reader.pos();
+        if (!reader.read_le(entry.handle)) {
+            return false;
+        }
+        if (entry.handle == obj_update_terminator) {
+            break;
+        }
+        if (!reader.read_u8(entry.flags)) {
+            return false;
+        }
+        if ((entry.flags & ObjUpdateState::flag_pos_rot_anim) && !reader.skip(pos_rot_anim_size)) {
+            return false;
+        }
+        if (!skip_optional_fields(reader, entry.flags)) {
+            return false;
+        }
+        entry.size = reader.pos() - entry.offset;
+        entries.push_back(entry);
+    }
+    return reader.at_end();
+}
+
+bool obj_update_parse(const std::byte* data, std::size_t len, ObjUpdateSnapshot& snapshot)
+{
+    snapshot.clear();
+    ByteReader reader{data, len};
+    while (true) {
+        ObjUpdateState state;
+        if (!reader.read_le(state.handle)) {
+            return false;
+        }
+        if (state.handle == obj_update_terminator) {
+            break;
+        }
+        if (!reader.read_u8(state.flags)) {
+            return false;
+        }
+        if (state.flags & ObjUpdateState::flag_pos_rot_anim) {
+            uint32_t pos_bits[3];
+            if (!reader.read_le(state.ticks) || !reader.read_le(pos_bits[0]) || !reader.read_le(pos_bits[1]) ||
+                !reader.read_le(pos_bits[2]) || !reader.read_le(state.angle_x) || !reader.read_le(state.angle_y)) {
+                return false;
+            }
+            for (int i = 0; i < 3; ++i) {
+                float value;
+                std::memcpy(&value, &pos_bits[i], sizeof(value));
+                if (!quantize_pos(value, state.pos[i])) {
+                    return false;
+                }
+            }
+            for (uint8_t& value : state.movement) {
+                if (!reader.read_u8(value)) {
+                    return false;
+                }
+            }
+        }
+        std::size_t extra_start = reader.pos();
+        if (!skip_optional_fields(reader, state.flags)) {
+            return false;
+        }
+        state.extra.assign(reader.data() + extra_start, reader.data() + reader.pos());
+        snapshot.push_back(std::move(state));
+    }
+    if (!reader.at_end()) {
+        return false;
+    }
+    std::stable_sort(snapshot.begin(), snapshot.end(),
+        [](const ObjUpdateState& a, const ObjUpdateState& b) { return a.handle < b.handle; });
+    return true;
+}
+
+void obj_update_write(const ObjUpdateSnapshot& snapshot, std::vector<std::byte>& out)
+{
+    ByteWriter writer{out};
+    for (const auto& state : snapshot) {
+        writer.write_le(state.handle);
+        writer.write_u8(state.flags);
+        if (state.flags & ObjUpdateState::flag_pos_rot_anim) {
+            writer.write_le(state.ticks);
+            for (int32_t value : state.pos) {
+                float pos = static_cast<float>(value) / obj_update_pos_scale;
+                uint32_t bits;
+                std::memcpy(&bits, &pos, sizeof(bits));
+                writer.write_le(bits);
+            }
+            writer.write_le(state.angle_x);
+            writer.write_le(state.angle_y);
+            for (uint8_t value : state.movement) {
+                writer.write_u8(value);
+            }
+        }
+        writer.write_bytes(state.extra.data(), state.extra.size());
+    }
+    writer.write_le(obj_update_terminator);
+}
+
+void ObjUpdateDeltaEncoder::encode(const ObjUpdateSnapshot& snapshot, std::vector<std::byte>& out)
+{
+    uint16_t sequence = next_sequence_++;
+    const HistoryEntry* baseline = nullptr;
+    if (acked_sequence_) {
+        const auto& entry = history_[acked_sequence_.value() % obj_update_delta_history_size];
+        if (entry.valid && entry.sequence == acked_sequence_.value() &&
+            static_cast<uint16_t>(sequence - entry.sequence) < obj_update_delta_history_size) {
+            baseline = &entry;
+        }
+    }
+
+    ByteWriter writer{out};
+    writer.write_le(sequence);
+    writer.write_le<uint16_t>(baseline ? baseline->sequence : 0);
+    writer.write_u8(baseline ? delta_flag_has_baseline : 0);
+    writer.write_varint(static_cast<uint32_t>(snapshot.size()));
+
+    uint32_t prev_handle = 0;
+    for (const auto& state : snapshot) {
+        writer.write_varint(state.handle - prev_handle);
+        prev_handle = state.handle;
+        const ObjUpdateState* base = baseline ? find_in_snapshot(baseline->snapshot, state.handle) : nullptr;
+        encode_object(writer, state, base ? *base : ObjUpdateState{});
+    }
+
+    auto& entry = history_[sequence % obj_update_delta_history_size];
+    entry.valid = true;
+    entry.sequence = sequence;
+    entry.snapshot = snapshot;
+}
+
+void ObjUpdateDeltaEncoder::ack(uint16_t sequence)
+{
+    // Ignore acknowledgements of packets that were not sent yet and reordered old acknowledgements
+    if (!is_newer_sequence(next_sequence_, sequence)) {
+        return;
+    }
+    if (!acked_sequence_ || is_newer_sequence(sequence, acked_sequence_.value())) {
+        acked_sequence_ = {sequence};
+    }
+}
+
+bool ObjUpdateDeltaDecoder::decode(const std::byte* data, std::size_t len, ObjUpdateSnapshot& snapshot)
+{
+    ByteReader reader{data, len};
+    uint16_t sequence = 0;
+    uint16_t baseline_sequence = 0;
+    uint8_t flags = 0;
+    uint32_t count = 0;
+    if (!reader.read_le(sequence) || !reader.read_le(baseline_sequence) || !reader.read_u8(flags) ||
+        !reader.read_varint(count) || count > max_objects) {
+        return false;
+    }
+
+    const ObjUpdateSnapshot* baseline = nullptr;
+    if (flags & delta_flag_has_baseline) {
+        const auto& entry = history_[baseline_sequence % obj_update_delta_history_size];
+        if (!entry.valid || entry.sequence != baseline_sequence) {
+            return false;
+        }
+        baseline = &entry.snapshot;
+    }
+
+    snapshot.clear();
+    snapshot.resize(count);
+    uint32_t prev_handle = 0;
+    for (auto& state : snapshot) {
+        uint32_t handle_delta = 0;
+        if (!reader.read_varint(handle_delta)) {
+            return false;
+        }
+        state.handle = prev_handle + handle_delta;
+        prev_handle = state.handle;
+        const ObjUpdateState* base = baseline ? find_in_snapshot(*baseline, state.handle) : nullptr;
+        if (!decode_object(reader, state, base ? *base : ObjUpdateState{})) {
+            return false;
+        }
+    }
+    if (!reader.at_end()) {
+        return false;
+    }
+
+    auto& entry = history_[sequence % obj_update_delta_history_size];
+    entry.valid = true;
+    entry.sequence = sequence;
+    entry.snapshot = snapshot;
+    if (!last_sequence_ || is_newer_sequence(sequence, last_sequence_.value())) {
+        last_sequence_ = {sequence};
+    }
+    return true;
+}
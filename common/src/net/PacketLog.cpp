@@ -0,0 +1,97 @@
+#include <common/net/PacketLog.h>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+template<typename T>
+static void write_le(std::ofstream& stream, T value)
+{
+    char buf[sizeof(T)];
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        buf[i] = static_cast<char>((static_cast<uint64_t>(value) >> (i * 8)) & 0xFF);
+    }
+    stream.write(buf, sizeof(buf));
+}
+
+template<typename T>
+static bool read_le(std::ifstream& stream, T& value)
+{
+    unsigned char buf[sizeof(T)];
+    if (!stream.read(reinterpret_cast<char*>(buf), sizeof(buf))) {
+        return false;
+    }
+    uint64_t result = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        result |= static_cast<uint64_t>(buf[i]) << (i * 8);
+    }
+    value = static_cast<T>(result);
+    return true;
+}
+
+PacketLogWriter::PacketLogWriter(const std::string& filename, uint64_t start_time) :
+    stream_{filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc}
+{
+    if (!stream_) {
+        throw std::runtime_error("cannot open packet log for writing: " + filename);
+    }
+    stream_.write(packet_log_magic, sizeof(packet_log_magic));
+    write_le<uint16_t>(stream_, packet_log_version);
+    write_le<uint16_t>(stream_, 0);
+    write_le<uint64_t>(stream_, start_time);
+}
+
+void PacketLogWriter::write(const PacketLogRecord& record)
+{
+    if (record.data.size() > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error("packet too big for packet log");
+    }
+    write_le<uint32_t>(stream_, record.timestamp_ms);
+    write_le<uint32_t>(stream_, record.ip_addr);
+    write_le<uint16_t>(stream_, record.port);
+    write_le<uint8_t>(stream_, record.flags);
+    write_le<uint16_t>(stream_, static_cast<uint16_t>(record.data.size()));
+    stream_.write(reinterpret_cast<const char*>(record.data.data()), static_cast<std::streamsize>(record.data.size()));
+}
+
+void PacketLogWriter::flush()
+{
+    stream_.flush();
+}
+
+PacketLogReader::PacketLogReader(const std::string& filename) :
+    stream_{filename, std::ios_base::in | std::ios_base::binary}
+{
+    if (!stream_) {
+        throw std::runtime_error("cannot open packet log: " + filename);
+    }
+    char magic[sizeof(packet_log_magic)];
+    uint16_t version = 0;
+    uint16_t reserved = 0;
+    if (!stream_.read(magic, sizeof(magic)) || std::memcmp(magic, packet_log_magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("not a packet log: " + filename);
+    }
+    if (!read_le(stream_, version) || !read_le(stream_, reserved) || !read_le(stream_, start_time_)) {
+        throw std::runtime_error("truncated packet log header: " + filename);
+    }
+    if (version != packet_log_version) {
+        throw std::runtime_error("unsupported packet log version: " + std::to_string(version));
+    }
+}
+
+bool PacketLogReader::read(PacketLogRecord& record)
+{
+    if (!read_le(stream_, record.timestamp_ms)) {
+        // Clean end of the log
+        return false;
+    }
+    uint16_t len = 0;
+    if (!read_le(stream_, record.ip_addr) || !read_le(stream_, record.port) || !read_le(stream_, record.flags) ||
+        !read_le(stream_, len)) {
+        throw std::runtime_error("truncated packet log record header");
+    }
+    record.data.resize(len);
+    if (!stream_.read(reinterpret_cast<char*>(record.data.data()), len)) {
+        throw std::runtime_error("truncated packet log record data");
+    }
+    return true;
+}
@@ -0,0 +1,264 @@
+#include <common/net/ReliableTransport.h>
+#include <common/net/PacketCodec.h>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr int min_rto_ms = 150;
+    // Both peers process packets once per frame so RTT samples are quantized and RTO needs some margin
+    constexpr float min_rtt_variance_term = 50.0f;
+    constexpr int max_rto_ms = 4000;
+    // Number of segments acknowledged after a missing one that makes it considered lost
+    constexpr int dup_threshold = 3;
+    constexpr int max_transmissions = 15;
+    // Game traffic is sparse and most losses are not caused by congestion so the window is never reduced too much
+    constexpr float min_cwnd = 8.0f;
+    constexpr float cwnd_decrease_factor = 0.7f;
+
+    // Signed distance between sequence numbers that handles wrapping
+    int seq_diff(uint16_t a, uint16_t b)
+    {
+        return static_cast<int16_t>(static_cast<uint16_t>(a - b));
+    }
+}
+
+void ReliableSender::write(const std::byte* data, std::size_t len)
+{
+    queue_.insert(queue_.end(), data, data + len);
+}
+
+void ReliableSender::update_rtt(int sample_ms)
+{
+    auto sample = static_cast<float>(std::max(sample_ms, 0));
+    if (!has_rtt_) {
+        srtt_ = sample;
+        rttvar_ = sample / 2.0f;
+        has_rtt_ = true;
+    }
+    else {
+        rttvar_ = 0.75f * rttvar_ + 0.25f * std::abs(srtt_ - sample);
+        srtt_ = 0.875f * srtt_ + 0.125f * sample;
+    }
+    auto rto = srtt_ + std::max(4.0f * rttvar_, min_rtt_variance_term);
+    rto_ = std::clamp(static_cast<int>(rto), min_rto_ms, max_rto_ms);
+}
+
+void ReliableSender::on_loss(bool timeout)
+{
+    if (timeout) {
+        ssthresh_ = std::max(cwnd_ * cwnd_decrease_factor, min_cwnd);
+        cwnd_ = min_cwnd;
+        rto_ = std::min(rto_ * 2, max_rto_ms);
+        // Window grows again using slow start
+        in_recovery_ = false;
+        ++stats_.num_timeouts;
+    }
+    else if (!in_recovery_) {
+        // Reduce the window only once per window of data
+        ssthresh_ = std::max(cwnd_ * cwnd_decrease_factor, min_cwnd);
+        cwnd_ = ssthresh_;
+        in_recovery_ = true;
+        recovery_seq_ = next_seq_;
+    }
+}
+
+bool ReliableSender::process_ack(const std::byte* data, std::size_t len, int now_ms)
+{
+    PacketReader reader{data, len};
+    auto next_expected_opt = reader.read<uint16_t>();
+    auto sack_bits_opt = reader.read<uint32_t>();
+    if (reader.failed()) {
+        return false;
+    }
+    uint16_t next_expected = next_expected_opt.value();
+    uint32_t sack_bits = sack_bits_opt.value();
+    if (segments_.empty() || seq_diff(next_expected, segments_.front().seq) < 0 ||
+        seq_diff(next_expected, next_seq_) > 0) {
+        // Old or invalid acknowledgement
+        return seq_diff(next_expected, next_seq_) <= 0;
+    }
+
+    int newest_sample_sent_ms = 0;
+    bool has_sample = false;
+    int num_newly_acked = 0;
+    for (auto& segment : segments_) {
+        int offset = seq_diff(segment.seq, next_expected);
+        bool acked = offset < 0 || (offset > 0 && offset <= 32 && (sack_bits & (1u << (offset - 1))));
+        if (acked && !segment.acked) {
+            segment.acked = true;
+            ++num_newly_acked;
+            // Karn's algorithm: retransmitted segments are ambiguous so do not use them for RTT estimation
+            if (segment.num_transmissions == 1 && (!has_sample || segment.sent_ms - newest_sample_sent_ms > 0)) {
+                newest_sample_sent_ms = segment.sent_ms;
+                has_sample = true;
+            }
+            if (!has_delivered_ || segment.sent_ms - last_delivered_sent_ms_ > 0) {
+                last_delivered_sent_ms_ = segment.sent_ms;
+                has_delivered_ = true;
+            }
+        }
+    }
+    if (has_sample) {
+        update_rtt(now_ms - newest_sample_sent_ms);
+    }
+
+    if (in_recovery_ && seq_diff(next_expected, recovery_seq_) >= 0) {
+        in_recovery_ = false;
+    }
+    if (!in_recovery_) {
+        for (int i = 0; i < num_newly_acked; ++i) {
+            cwnd_ += cwnd_ < ssthresh_ ? 1.0f : 1.0f / cwnd_;
+        }
+        cwnd_ = std::min(cwnd_, static_cast<float>(reliable_transport_max_window));
+    }
+
+    while (!segments_.empty() && segments_.front().acked) {
+        segments_.pop_front();
+    }
+
+    detect_losses(now_ms);
+    return true;
+}
+
+void ReliableSender::detect_losses(int now_ms)
+{
+    // Fast retransmit: a segment is lost if enough later segments were acknowledged or if a segment sent after it
+    // was acknowledged and the segment is older than RTT plus some tolerance for reordering (like RACK in TCP)
+    // Only segments sent after the last transmission of the checked segment are taken into account
+    int reorder_window = static_cast<int>(srtt_ / 4.0f);
+    for (auto it = segments_.begin(); it != segments_.end(); ++it) {
+        if (it->acked || it->lost) {
+            continue;
+        }
+        int num_acked_after = static_cast<int>(std::count_if(std::next(it), segments_.end(), [&](const Segment& s) {
+            return s.acked && s.sent_ms - it->sent_ms >= 0;
+        }));
+        bool sent_before_delivered = has_delivered_ && last_delivered_sent_ms_ - it->sent_ms > 0;
+        bool lost_by_time = sent_before_delivered && now_ms - it->sent_ms >= srtt_ms() + reorder_window;
+        if (num_acked_after >= dup_threshold || lost_by_time) {
+            it->lost = true;
+            ++stats_.num_fast_retransmits;
+            on_loss(false);
+        }
+    }
+}
+
+void ReliableSender::transmit(Segment& segment, int now_ms,
+    const std::function<void(const std::byte*, std::size_t)>& send)
+{
+    std::vector<std::byte> buf(reliable_transport_data_header_size + segment.data.size());
+    PacketWriter writer{buf.data(), buf.size()};
+    writer.write(segment.seq);
+    writer.write_bytes(segment.data.data(), segment.data.size());
+    if (segment.num_transmissions > 0) {
+        ++stats_.num_retransmits;
+    }
+    segment.sent_ms = now_ms;
+    segment.lost = false;
+    ++segment.num_transmissions;
+    ++stats_.num_segments_sent;
+    if (segment.num_transmissions > max_transmissions) {
+        failed_ = true;
+    }
+    send(buf.data(), buf.size());
+}
+
+void ReliableSender::poll(int now_ms, const std::function<void(const std::byte*, std::size_t)>& send)
+{
+    detect_losses(now_ms);
+
+    // Retransmission timeout of the oldest segment in flight
+    auto oldest = std::find_if(segments_.begin(), segments_.end(), [](const Segment& s) {
+        return !s.acked && !s.lost;
+    });
+    if (oldest != segments_.end() && now_ms - oldest->sent_ms >= rto_) {
+        for (auto& segment : segments_) {
+            if (!segment.acked && now_ms - segment.sent_ms >= rto_) {
+                segment.lost = true;
+            }
+        }
+        on_loss(true);
+    }
+
+    auto in_flight = std::count_if(segments_.begin(), segments_.end(), [](const Segment& s) {
+        return !s.acked && !s.lost;
+    });
+    auto can_send = [&]() { return static_cast<float>(in_flight) < std::max(cwnd_, 1.0f); };
+
+    // Lost segments go first so the receiver can deliver data waiting behind them
+    for (auto& segment : segments_) {
+        if (!can_send()) {
+            return;
+        }
+        if (segment.lost) {
+            transmit(segment, now_ms, send);
+            ++in_flight;
+        }
+    }
+    while (!queue_.empty() && segments_.size() < reliable_transport_max_window && can_send()) {
+        auto size = std::min(queue_.size(), reliable_transport_max_segment_data_size);
+        Segment& segment = segments_.emplace_back();
+        segment.seq = next_seq_++;
+        segment.data.assign(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(size));
+        queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(size));
+        transmit(segment, now_ms, send);
+        ++in_flight;
+    }
+}
+
+bool ReliableReceiver::process_data(const std::byte* data, std::size_t len)
+{
+    PacketReader reader{data, len};
+    auto seq_opt = reader.read<uint16_t>();
+    if (!seq_opt) {
+        return false;
+    }
+    uint16_t seq = seq_opt.value();
+    // Duplicates are acknowledged again because the previous acknowledgement could have been lost
+    ack_pending_ = true;
+    int offset = seq_diff(seq, next_expected_);
+    if (offset < 0 || offset >= static_cast<int>(reliable_transport_max_window)) {
+        // Already delivered or outside of the window - sender never exceeds the window so it is a duplicate
+        return true;
+    }
+    auto index = seq % reliable_transport_max_window;
+    if (!received_[index]) {
+        received_[index] = true;
+        window_[index].assign(data + reliable_transport_data_header_size, data + len);
+    }
+    // Move segments that are now in order to the output buffer
+    while (received_[next_expected_ % reliable_transport_max_window]) {
+        auto next_index = next_expected_ % reliable_transport_max_window;
+        ready_.insert(ready_.end(), window_[next_index].begin(), window_[next_index].end());
+        window_[next_index].clear();
+        received_[next_index] = false;
+        ++next_expected_;
+    }
+    return true;
+}
+
+void ReliableReceiver::read(std::vector<std::byte>& out)
+{
+    out.insert(out.end(), ready_.begin(), ready_.end());
+    ready_.clear();
+}
+
+bool ReliableReceiver::poll_ack(std::vector<std::byte>& out)
+{
+    if (!ack_pending_) {
+        return false;
+    }
+    ack_pending_ = false;
+    uint32_t sack_bits = 0;
+    for (unsigned i = 1; i < reliable_transport_max_window; ++i) {
+        if (received_[static_cast<uint16_t>(next_expected_ + i) % reliable_transport_max_window]) {
+            sack_bits |= 1u << (i - 1);
+        }
+    }
+    out.resize(reliable_transport_ack_size);
+    PacketWriter writer{out.data(), out.size()};
+    writer.write(next_expected_);
+    writer.write(sack_bits);
+    return true;
+}
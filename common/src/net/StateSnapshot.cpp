@@ -0,0 +1,141 @@
+#include <common/net/StateSnapshot.h>
+#include <common/rfproto.h>
+#include <common/net/PacketCodec.h>
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+void StateSnapshotBuilder::add_packet(const std::byte* data, std::size_t len)
+{
+    data_.insert(data_.end(), data, data + len);
+    ++num_packets_;
+}
+
+void StateSnapshotBuilder::clear()
+{
+    data_.clear();
+    num_packets_ = 0;
+}
+
+std::vector<std::vector<std::byte>> StateSnapshotBuilder::build(uint16_t snapshot_id, int compression_level) const
+{
+    uLongf compressed_size = compressBound(static_cast<uLong>(data_.size()));
+    std::vector<std::byte> compressed(compressed_size);
+    int result = compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressed_size,
+        reinterpret_cast<const Bytef*>(data_.data()), static_cast<uLong>(data_.size()), compression_level);
+    if (result != Z_OK) {
+        return {};
+    }
+
+    std::size_t num_chunks = (compressed_size + state_snapshot_max_chunk_data_size - 1) /
+        state_snapshot_max_chunk_data_size;
+    if (num_chunks == 0 || num_chunks > UINT16_MAX) {
+        return {};
+    }
+    std::vector<std::vector<std::byte>> chunks;
+    chunks.reserve(num_chunks);
+    for (std::size_t i = 0; i < num_chunks; ++i) {
+        std::size_t offset = i * state_snapshot_max_chunk_data_size;
+        std::size_t chunk_data_size = std::min<std::size_t>(state_snapshot_max_chunk_data_size,
+            compressed_size - offset);
+        std::vector<std::byte> chunk(state_snapshot_chunk_header_size + chunk_data_size);
+        PacketWriter writer{chunk.data(), chunk.size()};
+        writer.write(snapshot_id);
+        writer.write(static_cast<uint16_t>(i));
+        writer.write(static_cast<uint16_t>(num_chunks));
+        writer.write(static_cast<uint32_t>(data_.size()));
+        writer.write_bytes(compressed.data() + offset, chunk_data_size);
+        chunks.push_back(std::move(chunk));
+    }
+    return chunks;
+}
+
+bool state_snapshot_parse_chunk_header(const std::byte* data, std::size_t len, StateSnapshotChunkHeader& header)
+{
+    PacketReader reader{data, len};
+    auto snapshot_id = reader.read<uint16_t>();
+    auto chunk_index = reader.read<uint16_t>();
+    auto num_chunks = reader.read<uint16_t>();
+    auto uncompressed_size = reader.read<uint32_t>();
+    if (reader.failed()) {
+        return false;
+    }
+    header.snapshot_id = snapshot_id.value();
+    header.chunk_index = chunk_index.value();
+    header.num_chunks = num_chunks.value();
+    header.uncompressed_size = uncompressed_size.value();
+    return header.num_chunks > 0 && header.chunk_index < header.num_chunks &&
+        header.uncompressed_size <= state_snapshot_max_size;
+}
+
+void StateSnapshotReceiver::reset()
+{
+    active_ = false;
+    num_chunks_ = 0;
+    num_received_ = 0;
+    chunks_.clear();
+    compressed_.clear();
+}
+
+StateSnapshotReceiver::Result StateSnapshotReceiver::add_chunk(const std::byte* data, std::size_t len)
+{
+    StateSnapshotChunkHeader header;
+    if (!state_snapshot_parse_chunk_header(data, len, header)) {
+        return Result::error;
+    }
+    if (!active_ || header.snapshot_id != snapshot_id_) {
+        reset();
+        active_ = true;
+        snapshot_id_ = header.snapshot_id;
+        num_chunks_ = header.num_chunks;
+        uncompressed_size_ = header.uncompressed_size;
+        chunks_.resize(num_chunks_);
+    }
+    if (header.num_chunks != num_chunks_ || header.uncompressed_size != uncompressed_size_) {
+        reset();
+        return Result::error;
+    }
+    auto& chunk = chunks_[header.chunk_index];
+    if (chunk.empty()) {
+        chunk.assign(data + state_snapshot_chunk_header_size, data + len);
+        ++num_received_;
+    }
+    if (num_received_ < num_chunks_) {
+        return Result::incomplete;
+    }
+
+    for (const auto& c : chunks_) {
+        compressed_.insert(compressed_.end(), c.begin(), c.end());
+    }
+    data_.resize(uncompressed_size_);
+    uLongf dest_len = static_cast<uLongf>(data_.size());
+    int result = uncompress(reinterpret_cast<Bytef*>(data_.data()), &dest_len,
+        reinterpret_cast<const Bytef*>(compressed_.data()), static_cast<uLong>(compressed_.size()));
+    active_ = false;
+    chunks_.clear();
+    if (result != Z_OK || dest_len != uncompressed_size_) {
+        data_.clear();
+        return Result::error;
+    }
+    return Result::complete;
+}
+
+bool state_snapshot_for_each_packet(const std::vector<std::byte>& snapshot,
+    const std::function<void(const std::byte*, std::size_t)>& callback)
+{
+    std::size_t offset = 0;
+    while (offset < snapshot.size()) {
+        RF_GamePacketHeader header;
+        if (offset + sizeof(header) > snapshot.size()) {
+            return false;
+        }
+        std::memcpy(&header, snapshot.data() + offset, sizeof(header));
+        std::size_t packet_size = sizeof(header) + header.size;
+        if (offset + packet_size > snapshot.size()) {
+            return false;
+        }
+        callback(snapshot.data() + offset, packet_size);
+        offset += packet_size;
+    }
+    return true;
+}
@@ -15,6 +15,7 @@
 #include "gr_d3d11_dynamic_geometry.h"
 #include "gr_d3d11_solid.h"
 #include "gr_d3d11_mesh.h"
+#include "gr_d3d11_particle.h"
 
 using namespace rf;
 
@@ -22,6 +23,7 @@ namespace df::gr::d3d11
 {
     constexpr DXGI_FORMAT swap_chain_format = DXGI_FORMAT_B8G8R8A8_UNORM;
     constexpr UINT swap_chain_flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+    constexpr const char* state_manifest_filename = "d3d11_state_cache.txt";
 
     Renderer::Renderer(HWND hwnd) : hwnd_{hwnd}, d3d11_lib_{L"d3d11.dll"}
     {
@@ -40,6 +42,7 @@ namespace df::gr::d3d11
         dyn_geo_renderer_ = std::make_unique<DynamicGeometryRenderer>(device_, *shader_manager_, *render_context_);
         solid_renderer_ = std::make_unique<SolidRenderer>(device_, *shader_manager_, *state_manager_, *dyn_geo_renderer_, *render_context_);
         mesh_renderer_ = std::make_unique<MeshRenderer>(device_, *shader_manager_, *state_manager_, *render_context_);
+        particle_renderer_ = std::make_unique<ParticleRenderer>(device_, *shader_manager_, *render_context_, *dyn_geo_renderer_);
 
         render_context_->set_render_target(default_render_target_view_, depth_stencil_view_);
         render_context_->set_cull_mode(D3D11_CULL_BACK);
@@ -53,6 +56,9 @@ namespace df::gr::d3d11
 
     Renderer::~Renderer()
     {
+        if (state_manager_) {
+            state_manager_->save_manifest(state_manifest_filename);
+        }
         if (context_) {
             context_->ClearState();
         }
@@ -544,9 +550,30 @@ namespace df::gr::d3d11
         solid_renderer_->page_in_movable_solid(solid);
     }
 
+    void Renderer::render_particle_emitter(rf::ParticleEmitter* emitter, const std::function<void()>& default_render)
+    {
+        particle_renderer_->render_emitter(emitter, default_render);
+    }
+
+    void Renderer::warm_up_caches()
+    {
+        if (caches_warmed_up_) {
+            return;
+        }
+        caches_warmed_up_ = true;
+        state_manager_->warm_up(state_manifest_filename);
+    }
+
+    void Renderer::print_cache_stats()
+    {
+        shader_manager_->print_stats();
+        state_manager_->print_stats();
+    }
+
     void Renderer::flush_caches()
     {
         mesh_renderer_->flush_caches();
+        particle_renderer_->clear_cache();
     }
 
     float Renderer::z_far() const
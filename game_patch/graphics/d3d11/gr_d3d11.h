@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <d3d11.h>
 #include <common/ComPtr.h>
 #include <common/DynamicLinkLibrary.h>
@@ -15,6 +16,7 @@ namespace rf
     struct VifLodMesh;
     struct MeshRenderParams;
     struct CharacterInstance;
+    struct ParticleEmitter;
 }
 
 namespace df::gr
@@ -31,6 +33,7 @@ namespace df::gr::d3d11
     class RenderContext;
     class SolidRenderer;
     class MeshRenderer;
+    class ParticleRenderer;
 
     class Renderer
     {
@@ -78,6 +81,9 @@ namespace df::gr::d3d11
         void page_in_character_mesh(rf::VifLodMesh* lod_mesh);
         void page_in_solid(rf::GSolid* solid);
         void page_in_movable_solid(rf::GSolid* solid);
+        void render_particle_emitter(rf::ParticleEmitter* emitter, const std::function<void()>& default_render);
+        void warm_up_caches();
+        void print_cache_stats();
         void flush_caches();
         float z_far() const;
 
@@ -104,7 +110,9 @@ namespace df::gr::d3d11
         std::unique_ptr<RenderContext> render_context_;
         std::unique_ptr<SolidRenderer> solid_renderer_;
         std::unique_ptr<MeshRenderer> mesh_renderer_;
+        std::unique_ptr<ParticleRenderer> particle_renderer_;
         int render_target_bm_handle_ = -1;
+        bool caches_warmed_up_ = false;
     };
 
     void init_error(ID3D11Device* device);
@@ -1,28 +1,51 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
 #include <d3d11.h>
 #include <common/ComPtr.h>
 #include "gr_d3d11.h"
 
 namespace df::gr::d3d11
 {
+    template<typename T>
+    constexpr DXGI_FORMAT index_format()
+    {
+        static_assert(sizeof(T) == 2 || sizeof(T) == 4, "unsupported index type");
+        return sizeof(T) == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+    }
+
+    // Dynamic buffer split into multiple segments. Every segment is guarded by an event query issued when
+    // the writer leaves it, so it can be safely reused with D3D11_MAP_WRITE_NO_OVERWRITE once GPU is done with it.
+    // D3D11_MAP_WRITE_DISCARD is only used if GPU is still behind when wrapping around to an old segment.
     template<typename T>
     class RingBuffer
     {
     public:
-        RingBuffer(int buffer_size, UINT bind_flags, ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> device_context) :
-            buffer_size_{buffer_size}, device_{device}, device_context_{device_context}
+        RingBuffer(int buffer_size, UINT bind_flags, ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> device_context, int num_segments = 1) :
+            segment_size_{buffer_size / num_segments}, device_{device}, device_context_{device_context},
+            segment_queries_(num_segments), segment_query_pending_(num_segments, false)
         {
+            assert(num_segments > 0 && segment_size_ > 0);
             D3D11_BUFFER_DESC buffer_desc;
             ZeroMemory(&buffer_desc, sizeof(buffer_desc));
             buffer_desc.Usage            = D3D11_USAGE_DYNAMIC;
-            buffer_desc.ByteWidth        = buffer_size * sizeof(T);
+            buffer_desc.ByteWidth        = segment_size_ * num_segments * sizeof(T);
             buffer_desc.BindFlags        = bind_flags;
             buffer_desc.CPUAccessFlags   = D3D11_CPU_ACCESS_WRITE;
 
             DF_GR_D3D11_CHECK_HR(
                 device_->CreateBuffer(&buffer_desc, nullptr, &buffer_)
             );
+
+            if (num_segments > 1) {
+                CD3D11_QUERY_DESC query_desc{D3D11_QUERY_EVENT};
+                for (auto& query : segment_queries_) {
+                    DF_GR_D3D11_CHECK_HR(
+                        device_->CreateQuery(&query_desc, &query)
+                    );
+                }
+            }
         }
 
         ~RingBuffer()
@@ -32,18 +55,19 @@ namespace df::gr::d3d11
 
         T* alloc(int size)
         {
-            bool buffer_full = is_full(size);
-            assert(!mapped_data_ || !buffer_full);
+            assert(size <= segment_size_);
+            bool segment_full = is_full(size);
+            assert(!mapped_data_ || !segment_full);
             if (!mapped_data_) {
-                D3D11_MAP map_type = buffer_full ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+                D3D11_MAP map_type = D3D11_MAP_WRITE_NO_OVERWRITE;
+                if (segment_full) {
+                    map_type = next_segment();
+                }
                 D3D11_MAPPED_SUBRESOURCE mapped_subres;
                 DF_GR_D3D11_CHECK_HR(
                     device_context_->Map(buffer_, 0, map_type, 0, &mapped_subres)
                 );
                 mapped_data_ = reinterpret_cast<T*>(mapped_subres.pData);
-                if (buffer_full) {
-                    start_pos_ = current_pos_ = 0;
-                }
             }
 
             T* allocated_data = mapped_data_ + current_pos_;
@@ -64,7 +88,7 @@ namespace df::gr::d3d11
 
         bool is_full(int size) const
         {
-            return current_pos_ + size > buffer_size_;
+            return current_pos_ + size > segment_end();
         }
 
         ID3D11Buffer* get_buffer() const
@@ -77,12 +101,63 @@ namespace df::gr::d3d11
             return current_pos_ - start_pos_;
         }
 
+        int get_segment_size() const
+        {
+            return segment_size_;
+        }
+
     private:
-        int buffer_size_;
+        int num_segments() const
+        {
+            return static_cast<int>(segment_queries_.size());
+        }
+
+        int segment_end() const
+        {
+            return (current_segment_ + 1) * segment_size_;
+        }
+
+        bool is_segment_idle(int segment)
+        {
+            if (!segment_query_pending_[segment]) {
+                return true;
+            }
+            BOOL done = FALSE;
+            HRESULT hr = device_context_->GetData(segment_queries_[segment], &done, sizeof(done),
+                D3D11_ASYNC_GETDATA_DONOTFLUSH);
+            if (hr == S_OK && done) {
+                segment_query_pending_[segment] = false;
+                return true;
+            }
+            return false;
+        }
+
+        D3D11_MAP next_segment()
+        {
+            if (num_segments() > 1) {
+                // Mark the end of GPU usage of the segment we are leaving
+                device_context_->End(segment_queries_[current_segment_]);
+                segment_query_pending_[current_segment_] = true;
+            }
+            current_segment_ = (current_segment_ + 1) % num_segments();
+            start_pos_ = current_pos_ = current_segment_ * segment_size_;
+            if (num_segments() > 1 && is_segment_idle(current_segment_)) {
+                return D3D11_MAP_WRITE_NO_OVERWRITE;
+            }
+            // GPU has not caught up yet - let the driver rename the buffer. Old content is no longer accessible
+            // so all segments are free again
+            std::fill(segment_query_pending_.begin(), segment_query_pending_.end(), false);
+            return D3D11_MAP_WRITE_DISCARD;
+        }
+
+        int segment_size_;
         ComPtr<ID3D11Device> device_;
         ComPtr<ID3D11DeviceContext> device_context_;
         ComPtr<ID3D11Buffer> buffer_;
+        std::vector<ComPtr<ID3D11Query>> segment_queries_;
+        std::vector<bool> segment_query_pending_;
         T* mapped_data_ = nullptr;
+        int current_segment_ = 0;
         int start_pos_ = 0;
         int current_pos_ = 0;
     };
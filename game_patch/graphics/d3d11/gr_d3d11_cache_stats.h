@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace df::gr::d3d11
+{
+    // Only misses are counted. Cache hits also happen on deferred context recording threads but objects are always
+    // created on the main thread.
+    struct CacheStats
+    {
+        std::uint64_t misses = 0;
+    };
+}
@@ -1,5 +1,6 @@
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 #include "../../rf/gr/gr_light.h"
 #include "../../rf/os/frametime.h"
 #include "gr_d3d11.h"
@@ -25,26 +26,85 @@ namespace df::gr::d3d11
         render_mode_cbuffer_{device_},
         per_frame_buffer_{device_}
     {
-        bind_cbuffers();
+        bind_cbuffers(*this);
     }
 
-    void RenderContext::bind_cbuffers()
+    RenderContext::RenderContext(ComPtr<ID3D11DeviceContext> deferred_context, const RenderContext& parent) :
+        RenderContext{parent.device_, std::move(deferred_context), parent.state_manager_, parent.shader_manager_,
+            parent.texture_manager_}
+    {
+        assert(device_context_->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED);
+        bind_cbuffers(parent);
+    }
+
+    void RenderContext::bind_cbuffers(const RenderContext& shared_context)
     {
         ID3D11Buffer* vs_cbuffers[] = {
             model_transform_cbuffer_,
-            view_proj_transform_cbuffer_,
-            per_frame_buffer_,
+            shared_context.view_proj_transform_cbuffer_,
+            shared_context.per_frame_buffer_,
             nullptr,
         };
         device_context_->VSSetConstantBuffers(0, std::size(vs_cbuffers), vs_cbuffers);
 
         ID3D11Buffer* ps_cbuffers[] = {
             render_mode_cbuffer_,
-            lights_buffer_,
+            shared_context.lights_buffer_,
         };
         device_context_->PSSetConstantBuffers(0, std::size(ps_cbuffers), ps_cbuffers);
     }
 
+    void RenderContext::reset_state_cache()
+    {
+        std::fill(std::begin(current_vertex_buffers_), std::end(current_vertex_buffers_), nullptr);
+        current_index_buffer_ = nullptr;
+        current_index_format_ = DXGI_FORMAT_UNKNOWN;
+        current_input_layout_ = nullptr;
+        current_vertex_shader_ = nullptr;
+        current_pixel_shader_ = nullptr;
+        current_primitive_topology_ = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+        current_tex_handles_ = {-2, -2};
+        current_cull_mode_ = D3D11_CULL_NONE;
+        current_mode_.reset();
+        current_sampler_states_ = {nullptr, nullptr};
+        current_blend_state_ = nullptr;
+        current_depth_stencil_state_ = nullptr;
+        current_rasterizer_state_ = nullptr;
+        zbias_changed_ = true;
+        depth_clip_enabled_changed_ = true;
+        // Dynamic buffers must be mapped with D3D11_MAP_WRITE_DISCARD in every command list before being used
+        model_transform_cbuffer_.invalidate();
+        render_mode_cbuffer_.invalidate();
+    }
+
+    void RenderContext::begin_deferred_recording(const RenderContext& parent)
+    {
+        // FinishCommandList resets deferred context state to defaults
+        reset_state_cache();
+        bind_cbuffers(parent);
+        set_render_target(parent.render_target_view_, parent.depth_stencil_view_);
+        set_clip();
+        zbias_ = parent.zbias_;
+        depth_clip_enabled_ = parent.depth_clip_enabled_;
+        // Rasterizer state depends only on the values copied above and the cull mode so resolve it here
+        for (D3D11_CULL_MODE cull_mode : {D3D11_CULL_NONE, D3D11_CULL_BACK}) {
+            state_manager_.lookup_rasterizer_state(cull_mode, zbias_, depth_clip_enabled_);
+        }
+    }
+
+    void RenderContext::prepare_for_deferred(gr::Mode mode, int tex_handle0, int tex_handle1, ResolvedTextureViews& views)
+    {
+        state_manager_.lookup_sampler_state(mode.get_texture_source(), 0);
+        state_manager_.lookup_sampler_state(mode.get_texture_source(), 1);
+        state_manager_.lookup_blend_state(mode.get_alpha_blend());
+        state_manager_.lookup_depth_stencil_state(mode.get_zbuffer_type());
+        for (int tex_handle : {tex_handle0, tex_handle1}) {
+            if (tex_handle != -1 && !views.count(tex_handle)) {
+                views.emplace(tex_handle, texture_manager_.lookup_texture(tex_handle));
+            }
+        }
+    }
+
     void RenderContext::clear()
     {
         // Note: original code clears clip rect only but it is not trivial in D3D11
@@ -202,13 +262,10 @@ namespace df::gr::d3d11
         DF_GR_D3D11_CHECK_HR(device->CreateBuffer(&desc, nullptr, &buffer_));
     }
 
+    LightsBuffer::~LightsBuffer() = default;
+
     void LightsBuffer::update(ID3D11DeviceContext* device_context)
     {
-        D3D11_MAPPED_SUBRESOURCE mapped_subres;
-        DF_GR_D3D11_CHECK_HR(
-            device_context->Map(buffer_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped_subres)
-        );
-
         LightsBufferData data{};
         for (int i = 0; i < std::min(rf::gr::num_relevant_lights, LightsBufferData::max_point_lights); ++i) {
             LightsBufferData::PointLight& gpu_light = data.point_lights[i];
@@ -229,8 +286,19 @@ namespace df::gr::d3d11
             gpu_light.radius = light->rad_2;
         }
 
-        std::memcpy(mapped_subres.pData, &data, sizeof(data));
+        if (current_data_ && std::memcmp(current_data_.get(), &data, sizeof(data)) == 0) {
+            return;
+        }
+        if (!current_data_) {
+            current_data_ = std::make_unique<LightsBufferData>();
+        }
+        *current_data_ = data;
 
+        D3D11_MAPPED_SUBRESOURCE mapped_subres;
+        DF_GR_D3D11_CHECK_HR(
+            device_context->Map(buffer_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped_subres)
+        );
+        std::memcpy(mapped_subres.pData, &data, sizeof(data));
         device_context->Unmap(buffer_, 0);
     }
 
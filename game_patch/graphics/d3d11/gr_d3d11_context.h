@@ -1,6 +1,9 @@
 #pragma once
 
 #include <optional>
+#include <cmath>
+#include <unordered_map>
+#include <memory>
 #include <d3d11.h>
 #include <common/ComPtr.h>
 #include "gr_d3d11_transform.h"
@@ -30,6 +33,11 @@ namespace df::gr::d3d11
             }
         }
 
+        void invalidate()
+        {
+            current_model_pos_ = {NAN, NAN, NAN};
+        }
+
         operator ID3D11Buffer*() const
         {
             return buffer_;
@@ -59,10 +67,13 @@ namespace df::gr::d3d11
         ComPtr<ID3D11Buffer> buffer_;
     };
 
+    struct LightsBufferData;
+
     class LightsBuffer
     {
     public:
         LightsBuffer(ID3D11Device* device);
+        ~LightsBuffer();
         void update(ID3D11DeviceContext* device_context);
 
         operator ID3D11Buffer*() const
@@ -72,6 +83,8 @@ namespace df::gr::d3d11
 
     private:
         ComPtr<ID3D11Buffer> buffer_;
+        // Last uploaded data - buffer is only mapped if the relevant lights set changed
+        std::unique_ptr<LightsBufferData> current_data_;
     };
 
     class RenderModeBuffer
@@ -104,6 +117,11 @@ namespace df::gr::d3d11
             }
         }
 
+        void invalidate()
+        {
+            force_update_ = true;
+        }
+
     private:
         void update_buffer(ID3D11DeviceContext* device_context);
 
@@ -129,6 +147,8 @@ namespace df::gr::d3d11
         ComPtr<ID3D11Buffer> buffer_;
     };
 
+    using ResolvedTextureViews = std::unordered_map<int, ID3D11ShaderResourceView*>;
+
     class RenderContext
     {
     public:
@@ -139,6 +159,22 @@ namespace df::gr::d3d11
             ShaderManager& shader_manager,
             TextureManager& texture_manager
         );
+        // Context recording into a deferred device context. View-projection, per-frame and lights constant
+        // buffers are shared with the parent context
+        RenderContext(ComPtr<ID3D11DeviceContext> deferred_context, const RenderContext& parent);
+
+        // Must be called on the main thread before recording a new command list in a deferred context
+        void begin_deferred_recording(const RenderContext& parent);
+
+        // Creates all state objects and texture views needed to render using given mode and textures, so a deferred
+        // context can later use them without touching the managers' caches
+        void prepare_for_deferred(gr::Mode mode, int tex_handle0, int tex_handle1, ResolvedTextureViews& views);
+
+        void set_resolved_texture_views(const ResolvedTextureViews* views)
+        {
+            resolved_texture_views_ = views;
+            current_tex_handles_ = {-2, -2};
+        }
 
         ID3D11Device* device() const
         {
@@ -265,11 +301,12 @@ namespace df::gr::d3d11
             }
         }
 
-        void set_index_buffer(ID3D11Buffer* index_buffer)
+        void set_index_buffer(ID3D11Buffer* index_buffer, DXGI_FORMAT format = DXGI_FORMAT_R16_UINT)
         {
-            if (index_buffer != current_index_buffer_) {
+            if (index_buffer != current_index_buffer_ || format != current_index_format_) {
                 current_index_buffer_ = index_buffer;
-                device_context_->IASetIndexBuffer(index_buffer, DXGI_FORMAT_R16_UINT, 0);
+                current_index_format_ = format;
+                device_context_->IASetIndexBuffer(index_buffer, format, 0);
             }
         }
 
@@ -352,18 +389,33 @@ namespace df::gr::d3d11
             device_context_->DrawIndexed(index_count, index_start_location, base_vertex_location);
         }
 
+        void draw_indexed_instanced(int index_count, int instance_count, int start_instance_location)
+        {
+            device_context_->DrawIndexedInstanced(index_count, instance_count, 0, 0, start_instance_location);
+        }
+
         const Projection& projection() const
         {
             return projection_;
         }
 
     private:
-        void bind_cbuffers();
+        void bind_cbuffers(const RenderContext& shared_context);
+        void reset_state_cache();
+
+        ID3D11ShaderResourceView* lookup_texture(int tex_handle)
+        {
+            if (resolved_texture_views_) {
+                auto it = resolved_texture_views_->find(tex_handle);
+                return it != resolved_texture_views_->end() ? it->second : nullptr;
+            }
+            return texture_manager_.lookup_texture(tex_handle);
+        }
 
         ID3D11ShaderResourceView* get_diffuse_texture_view(int tex_handle)
         {
             if (tex_handle != -1) {
-                return texture_manager_.lookup_texture(tex_handle);
+                return lookup_texture(tex_handle);
             }
             return texture_manager_.get_white_texture();
         }
@@ -371,7 +423,7 @@ namespace df::gr::d3d11
         ID3D11ShaderResourceView* get_lightmap_texture_view(int tex_handle)
         {
             if (tex_handle != -1) {
-                return texture_manager_.lookup_texture(tex_handle);
+                return lookup_texture(tex_handle);
             }
             return texture_manager_.get_gray_texture();
         }
@@ -388,11 +440,13 @@ namespace df::gr::d3d11
         LightsBuffer lights_buffer_;
         RenderModeBuffer render_mode_cbuffer_;
         PerFrameBuffer per_frame_buffer_;
+        const ResolvedTextureViews* resolved_texture_views_ = nullptr;
 
         ID3D11RenderTargetView* render_target_view_ = nullptr;
         ID3D11DepthStencilView* depth_stencil_view_ = nullptr;
         ID3D11Buffer* current_vertex_buffers_[vertex_buffer_slots] = {};
         ID3D11Buffer* current_index_buffer_ = nullptr;
+        DXGI_FORMAT current_index_format_ = DXGI_FORMAT_UNKNOWN;
         ID3D11InputLayout* current_input_layout_ = nullptr;
         ID3D11VertexShader* current_vertex_shader_ = nullptr;
         ID3D11PixelShader* current_pixel_shader_ = nullptr;
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <xlog/xlog.h>
+#include "gr_d3d11.h"
+#include "gr_d3d11_deferred.h"
+#include "gr_d3d11_context.h"
+
+namespace df::gr::d3d11
+{
+    CommandListRecorder::CommandListRecorder(ID3D11Device* device, RenderContext& immediate_render_context, int num_workers) :
+        immediate_render_context_{immediate_render_context}
+    {
+        // Command lists emulated by the runtime are slower than rendering on the immediate context
+        D3D11_FEATURE_DATA_THREADING threading_support{};
+        HRESULT hr = device->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading_support, sizeof(threading_support));
+        if (FAILED(hr) || !threading_support.DriverCommandLists) {
+            xlog::info("D3D11 driver does not support command lists - multithreaded rendering is disabled");
+            return;
+        }
+
+        for (int i = 0; i < num_workers; ++i) {
+            auto worker = std::make_unique<Worker>();
+            worker->index = i;
+            hr = device->CreateDeferredContext(0, &worker->device_context);
+            if (FAILED(hr)) {
+                xlog::warn("CreateDeferredContext failed (hr {:x}) - multithreaded rendering is disabled",
+                    static_cast<unsigned>(hr));
+                workers_.clear();
+                return;
+            }
+            worker->render_context = std::make_unique<RenderContext>(worker->device_context, immediate_render_context_);
+            workers_.push_back(std::move(worker));
+        }
+        // Start threads after all workers are created so they never see a partially constructed recorder
+        for (auto& worker : workers_) {
+            worker->thread = std::thread{&CommandListRecorder::worker_thread_proc, this, std::ref(*worker)};
+        }
+        xlog::info("Created {} D3D11 deferred context workers", num_workers);
+    }
+
+    CommandListRecorder::~CommandListRecorder()
+    {
+        {
+            std::lock_guard lock{mutex_};
+            stopping_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker->thread.join();
+        }
+    }
+
+    int CommandListRecorder::default_num_workers()
+    {
+        // Leave one core for the main thread that executes the command lists
+        int num_cores = static_cast<int>(std::thread::hardware_concurrency());
+        return std::clamp(num_cores - 1, 1, 4);
+    }
+
+    void CommandListRecorder::record_and_execute(const Job& job)
+    {
+        // Deferred contexts are not thread-safe but they can be used by different threads at different times.
+        // Prepare them on the main thread while workers are idle.
+        for (auto& worker : workers_) {
+            worker->render_context->begin_deferred_recording(immediate_render_context_);
+        }
+
+        {
+            std::lock_guard lock{mutex_};
+            job_ = &job;
+            num_pending_ = num_workers();
+            ++generation_;
+        }
+        work_cv_.notify_all();
+
+        {
+            std::unique_lock lock{mutex_};
+            done_cv_.wait(lock, [this]() { return num_pending_ == 0; });
+            job_ = nullptr;
+        }
+
+        ID3D11DeviceContext* immediate_context = immediate_render_context_.device_context();
+        for (auto& worker : workers_) {
+            if (worker->command_list) {
+                // Restore immediate context state so RenderContext state cache stays valid
+                immediate_context->ExecuteCommandList(worker->command_list, TRUE);
+                worker->command_list.release();
+            }
+        }
+    }
+
+    void CommandListRecorder::worker_thread_proc(Worker& worker)
+    {
+        unsigned last_generation = 0;
+        while (true) {
+            const Job* job;
+            {
+                std::unique_lock lock{mutex_};
+                work_cv_.wait(lock, [&]() { return stopping_ || generation_ != last_generation; });
+                if (stopping_) {
+                    return;
+                }
+                last_generation = generation_;
+                job = job_;
+            }
+
+            (*job)(worker.index, *worker.render_context);
+            DF_GR_D3D11_CHECK_HR(
+                worker.device_context->FinishCommandList(FALSE, &worker.command_list)
+            );
+
+            bool all_done;
+            {
+                std::lock_guard lock{mutex_};
+                all_done = --num_pending_ == 0;
+            }
+            if (all_done) {
+                done_cv_.notify_one();
+            }
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <d3d11.h>
+#include <common/ComPtr.h>
+
+namespace df::gr::d3d11
+{
+    class RenderContext;
+
+    // Records draw calls on worker threads using deferred device contexts. Recorded command lists are executed on
+    // the immediate context in worker order so the final submission order is deterministic.
+    class CommandListRecorder
+    {
+    public:
+        using Job = std::function<void(int worker_index, RenderContext& context)>;
+
+        CommandListRecorder(ID3D11Device* device, RenderContext& immediate_render_context, int num_workers);
+        ~CommandListRecorder();
+
+        int num_workers() const
+        {
+            return static_cast<int>(workers_.size());
+        }
+
+        // False if deferred contexts could not be created and rendering must be done on the immediate context
+        bool available() const
+        {
+            return !workers_.empty();
+        }
+
+        RenderContext& worker_render_context(int worker_index)
+        {
+            return *workers_[worker_index]->render_context;
+        }
+
+        // Runs the job on all workers in parallel, waits for them and executes the recorded command lists
+        void record_and_execute(const Job& job);
+
+        static int default_num_workers();
+
+    private:
+        struct Worker
+        {
+            int index;
+            ComPtr<ID3D11DeviceContext> device_context;
+            std::unique_ptr<RenderContext> render_context;
+            ComPtr<ID3D11CommandList> command_list;
+            std::thread thread;
+        };
+
+        void worker_thread_proc(Worker& worker);
+
+        RenderContext& immediate_render_context_;
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::mutex mutex_;
+        std::condition_variable work_cv_;
+        std::condition_variable done_cv_;
+        const Job* job_ = nullptr;
+        unsigned generation_ = 0;
+        int num_pending_ = 0;
+        bool stopping_ = false;
+    };
+}
@@ -1,4 +1,6 @@
 #include <cassert>
+#include <algorithm>
+#include "../../main/main.h"
 #include "gr_d3d11.h"
 #include "gr_d3d11_dynamic_geometry.h"
 #include "gr_d3d11_shader.h"
@@ -8,13 +10,16 @@ using namespace rf;
 
 namespace df::gr::d3d11
 {
-    constexpr int batch_max_vertex = 6000;
-    constexpr int batch_max_index = 10000;
+    constexpr int ring_buffer_segments = 3;
+    constexpr int max_queued_batches = 32;
+    constexpr int max_queued_quads = 1024;
 
     DynamicGeometryRenderer::DynamicGeometryRenderer(ComPtr<ID3D11Device> device, ShaderManager& shader_manager, RenderContext& render_context) :
         device_{device}, render_context_(render_context),
-        vertex_ring_buffer_{batch_max_vertex, D3D11_BIND_VERTEX_BUFFER, device_, render_context.device_context()},
-        index_ring_buffer_{batch_max_index, D3D11_BIND_INDEX_BUFFER, device_, render_context.device_context()}
+        vertex_ring_buffer_{static_cast<int>(g_game_config.dynamic_geometry_buffer_size.value()),
+            D3D11_BIND_VERTEX_BUFFER, device_, render_context.device_context(), ring_buffer_segments},
+        index_ring_buffer_{static_cast<int>(g_game_config.dynamic_geometry_buffer_size.value()) * 2,
+            D3D11_BIND_INDEX_BUFFER, device_, render_context.device_context(), ring_buffer_segments}
     {
         vertex_shader_ = shader_manager.get_vertex_shader(VertexShaderId::transformed);
         std_pixel_shader_ = shader_manager.get_pixel_shader(PixelShaderId::standard);
@@ -22,6 +27,12 @@ namespace df::gr::d3d11
     }
 
     void DynamicGeometryRenderer::flush()
+    {
+        flush_queued_quads();
+        draw_batch();
+    }
+
+    void DynamicGeometryRenderer::draw_batch()
     {
         auto [start_vertex, num_vertex] = vertex_ring_buffer_.submit();
         if (num_vertex == 0) {
@@ -33,7 +44,7 @@ namespace df::gr::d3d11
             num_vertex, num_index, rf::bm::get_filename(state_.textures[0]));
 
         render_context_.set_vertex_buffer(vertex_ring_buffer_.get_buffer(), sizeof(GpuTransformedVertex));
-        render_context_.set_index_buffer(index_ring_buffer_.get_buffer());
+        render_context_.set_index_buffer(index_ring_buffer_.get_buffer(), index_format<Index>());
         render_context_.set_vertex_shader(vertex_shader_);
         render_context_.set_pixel_shader(state_.pixel_shader);
         render_context_.set_primitive_topology(state_.primitive_topology);
@@ -44,6 +55,63 @@ namespace df::gr::d3d11
         render_context_.draw_indexed(num_index, start_index, start_vertex);
     }
 
+    void DynamicGeometryRenderer::queue_quad(const State& state, const QueuedQuad& quad)
+    {
+        if (num_queued_quads_ >= max_queued_quads) {
+            flush_queued_quads();
+        }
+
+        // Find the latest batch using the same state. The quad can join it only if it does not overlap any quad
+        // queued after that batch - otherwise blending order would change
+        QueuedBatch* target_batch = nullptr;
+        for (int i = num_queued_batches_ - 1; i >= 0; --i) {
+            auto& batch = queued_batches_[i];
+            if (batch.state == state) {
+                target_batch = &batch;
+                break;
+            }
+            bool overlaps = std::any_of(batch.quads.begin(), batch.quads.end(), [&](const QueuedQuad& other) {
+                return other.overlaps(quad);
+            });
+            if (overlaps) {
+                break;
+            }
+        }
+
+        if (!target_batch) {
+            if (num_queued_batches_ == max_queued_batches) {
+                flush_queued_quads();
+            }
+            if (num_queued_batches_ == static_cast<int>(queued_batches_.size())) {
+                queued_batches_.emplace_back();
+            }
+            target_batch = &queued_batches_[num_queued_batches_++];
+            target_batch->state = state;
+        }
+        target_batch->quads.push_back(quad);
+        ++num_queued_quads_;
+    }
+
+    void DynamicGeometryRenderer::flush_queued_quads()
+    {
+        for (int i = 0; i < num_queued_batches_; ++i) {
+            auto& batch = queued_batches_[i];
+            for (const auto& quad : batch.quads) {
+                auto [gpu_verts, gpu_ind_ptr, base_vertex] = setup(4, 6, batch.state);
+                std::copy(quad.vertices.begin(), quad.vertices.end(), gpu_verts);
+                *(gpu_ind_ptr++) = base_vertex;
+                *(gpu_ind_ptr++) = base_vertex + 1;
+                *(gpu_ind_ptr++) = base_vertex + 2;
+                *(gpu_ind_ptr++) = base_vertex;
+                *(gpu_ind_ptr++) = base_vertex + 2;
+                *(gpu_ind_ptr++) = base_vertex + 3;
+            }
+            batch.quads.clear();
+        }
+        num_queued_batches_ = 0;
+        num_queued_quads_ = 0;
+    }
+
     static inline bool mode_uses_vertex_color(gr::Mode mode)
     {
         if (mode.get_texture_source() == gr::TEXTURE_SOURCE_NONE) {
@@ -94,11 +162,18 @@ namespace df::gr::d3d11
     void DynamicGeometryRenderer::add_poly(int nv, const gr::Vertex **vertices, int vertex_attributes, const std::array<int, 2>& tex_handles, gr::Mode mode)
     {
         int num_index = (nv - 2) * 3;
-        if (nv > batch_max_vertex || num_index > batch_max_index) {
+        if (nv > vertex_ring_buffer_.get_segment_size() || num_index > index_ring_buffer_.get_segment_size()) {
             xlog::error("too many vertices/indices needed in dynamic geometry renderer");
             return;
         }
 
+        // 3D polygons are depth tested and often blended so keep their submission order
+        flush_queued_quads();
+
+        if (mode_capture_active_ && !captured_mode_) {
+            captured_mode_ = mode;
+        }
+
         std::array<int, 2> normalized_tex_handles = normalize_texture_handles_for_mode(mode, tex_handles);
 
         State new_state{
@@ -154,6 +229,7 @@ namespace df::gr::d3d11
     {
         constexpr int num_verts = 2;
         constexpr int num_inds = 2;
+        flush_queued_quads();
         State new_state{
             D3D11_PRIMITIVE_TOPOLOGY_LINELIST,
             {-1, -1},
@@ -237,22 +313,19 @@ namespace df::gr::d3d11
             std::swap(v_top, v_bottom);
         }
 
-        constexpr int num_verts = 4;
-        constexpr int num_inds = 6;
-
         State new_state{
             D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST,
             {bm_handle, -1},
             mode,
             ui_pixel_shader_,
         };
-        auto [gpu_verts, gpu_ind_ptr, base_vertex] = setup(num_verts, num_inds, new_state);
 
         rf::Color color = get_vertex_color_from_screen(mode);
         int diffuse = pack_color(color);
 
-        for (int i = 0; i < num_verts; ++i) {
-            GpuTransformedVertex& gpu_vert = gpu_verts[i];
+        QueuedQuad quad;
+        for (int i = 0; i < static_cast<int>(quad.vertices.size()); ++i) {
+            GpuTransformedVertex& gpu_vert = quad.vertices[i];
             gpu_vert.x = (i == 0 || i == 3) ? sx_left : sx_right;
             gpu_vert.y = (i == 0 || i == 1) ? sy_top : sy_bottom;
             gpu_vert.z = 1.0f;
@@ -261,11 +334,10 @@ namespace df::gr::d3d11
             gpu_vert.u0 = (i == 0 || i == 3) ? u_left : u_right;
             gpu_vert.v0 = (i == 0 || i == 1) ? v_top : v_bottom;
         }
-        *(gpu_ind_ptr++) = base_vertex;
-        *(gpu_ind_ptr++) = base_vertex + 1;
-        *(gpu_ind_ptr++) = base_vertex + 2;
-        *(gpu_ind_ptr++) = base_vertex;
-        *(gpu_ind_ptr++) = base_vertex + 2;
-        *(gpu_ind_ptr++) = base_vertex + 3;
+        quad.left = std::min(sx_left, sx_right);
+        quad.right = std::max(sx_left, sx_right);
+        quad.top = std::max(sy_top, sy_bottom);
+        quad.bottom = std::min(sy_top, sy_bottom);
+        queue_quad(new_state, quad);
     }
 }
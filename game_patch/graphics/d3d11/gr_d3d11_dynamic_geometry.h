@@ -1,15 +1,17 @@
 #pragma once
 
 #include <array>
+#include <optional>
+#include <vector>
 #include <d3d11.h>
 #include <common/ComPtr.h>
 #include "../../rf/gr/gr.h"
 #include "gr_d3d11_shader.h"
 #include "gr_d3d11_buffer.h"
+#include "gr_d3d11_vertex.h"
 
 namespace df::gr::d3d11
 {
-    struct GpuTransformedVertex;
     class RenderContext;
 
     class DynamicGeometryRenderer
@@ -23,6 +25,18 @@ namespace df::gr::d3d11
         void bitmap(int bm_handle, float x, float y, float w, float h, float sx, float sy, float sw, float sh, bool flip_x, bool flip_y, gr::Mode mode);
         void flush();
 
+        void begin_mode_capture()
+        {
+            mode_capture_active_ = true;
+            captured_mode_.reset();
+        }
+
+        std::optional<rf::gr::Mode> end_mode_capture()
+        {
+            mode_capture_active_ = false;
+            return captured_mode_;
+        }
+
     private:
         struct State
         {
@@ -41,27 +55,57 @@ namespace df::gr::d3d11
             bool operator==(const State& other) const = default;
         };
 
-        std::tuple<GpuTransformedVertex*, rf::ushort*, rf::ushort> setup(int num_vert, int num_ind, const State& state)
+        // Indices are 32-bit so a batch is not limited to 65536 vertices when a big ring buffer is configured
+        using Index = rf::uint;
+
+        // Screen-space quad waiting in the reorder queue
+        struct QueuedQuad
+        {
+            std::array<GpuTransformedVertex, 4> vertices;
+            float left, top, right, bottom;
+
+            bool overlaps(const QueuedQuad& other) const
+            {
+                return left < other.right && other.left < right && top > other.bottom && other.top > bottom;
+            }
+        };
+
+        // Queued quads sharing the same state. Batches are drawn in queue order.
+        struct QueuedBatch
+        {
+            State state;
+            std::vector<QueuedQuad> quads;
+        };
+
+        std::tuple<GpuTransformedVertex*, Index*, Index> setup(int num_vert, int num_ind, const State& state)
         {
             if (state_ != state || vertex_ring_buffer_.is_full(num_vert) || index_ring_buffer_.is_full(num_ind)) {
-                flush();
+                draw_batch();
                 state_ = state;
             }
-            auto base_vertex = static_cast<rf::ushort>(vertex_ring_buffer_.get_pos());
+            auto base_vertex = static_cast<Index>(vertex_ring_buffer_.get_pos());
             auto gpu_verts = vertex_ring_buffer_.alloc(num_vert);
             auto gpu_inds = index_ring_buffer_.alloc(num_ind);
             return {gpu_verts, gpu_inds, base_vertex};
         }
 
+        void draw_batch();
+        void queue_quad(const State& state, const QueuedQuad& quad);
+        void flush_queued_quads();
         std::array<float, 4> convert_pos(const rf::gr::Vertex& v, bool is_3d);
 
         ComPtr<ID3D11Device> device_;
         RenderContext& render_context_;
         RingBuffer<GpuTransformedVertex> vertex_ring_buffer_;
-        RingBuffer<rf::ushort> index_ring_buffer_;
+        RingBuffer<Index> index_ring_buffer_;
         VertexShaderAndLayout vertex_shader_;
         ComPtr<ID3D11PixelShader> std_pixel_shader_;
         ComPtr<ID3D11PixelShader> ui_pixel_shader_;
         State state_;
+        std::vector<QueuedBatch> queued_batches_;
+        int num_queued_batches_ = 0;
+        int num_queued_quads_ = 0;
+        bool mode_capture_active_ = false;
+        std::optional<rf::gr::Mode> captured_mode_;
     };
 }
@@ -11,6 +11,7 @@
 #include "../../rf/mover.h"
 #include "../../bmpman/bmpman.h"
 #include "../../main/main.h"
+#include "../../os/console.h"
 #include "gr_d3d11.h"
 
 namespace df::gr::d3d11
@@ -211,6 +212,11 @@ namespace df::gr::d3d11
         return v->flags;
     }
 
+    void render_particle_emitter(rf::ParticleEmitter* emitter, const std::function<void()>& default_render)
+    {
+        renderer->render_particle_emitter(emitter, default_render);
+    }
+
     bool poly(int nv, rf::gr::Vertex** vertices, int vertex_attributes, rf::gr::Mode mode, bool constant_sw, float sw)
     {
         return renderer->poly(nv, vertices, vertex_attributes, mode, constant_sw, sw);
@@ -295,6 +301,8 @@ namespace df::gr::d3d11
         0x0045CC20,
         []() {
             if (renderer) {
+                // Create state objects used by previous sessions while the loading screen is displayed
+                renderer->warm_up_caches();
                 renderer->page_in_solid(rf::level.geometry);
                 for (rf::MoverBrush& mb : DoublyLinkedList{rf::mover_brush_list}) {
                     renderer->page_in_movable_solid(mb.geometry);
@@ -303,6 +311,27 @@ namespace df::gr::d3d11
         },
     };
 
+    ConsoleCommand2 d3d11_cache_stats_cmd{
+        "d3d11_cache_stats",
+        []() {
+            if (renderer) {
+                renderer->print_cache_stats();
+            }
+        },
+        "Print D3D11 shader and state object cache statistics",
+    };
+
+    ConsoleCommand2 d3d11_deferred_contexts_cmd{
+        "d3d11_deferred_contexts",
+        []() {
+            g_game_config.multithreaded_rendering = !g_game_config.multithreaded_rendering;
+            g_game_config.save();
+            rf::console::print("Multithreaded rendering using deferred contexts is {}",
+                g_game_config.multithreaded_rendering ? "enabled" : "disabled");
+        },
+        "Toggles recording of level geometry draw calls on worker threads",
+    };
+
     static CodeInjection level_page_out_injection{
         0x0045CB83,
         []() {
@@ -327,6 +356,9 @@ void gr_d3d11_apply_patch()
     level_page_in_injection.install();
     level_page_out_injection.install();
 
+    d3d11_cache_stats_cmd.register_cmd();
+    d3d11_deferred_contexts_cmd.register_cmd();
+
     // Do not use built-in render cache
     AsmWriter{0x004F0B90}.jmp(clear_solid_render_cache); // g_render_cache_clear
     AsmWriter{0x004F0B20}.ret(); // g_render_cache_init
@@ -0,0 +1,128 @@
+#include <cassert>
+#include "../../rf/particle_emitter.h"
+#include "../../main/main.h"
+#include "gr_d3d11.h"
+#include "gr_d3d11_particle.h"
+#include "gr_d3d11_dynamic_geometry.h"
+#include "gr_d3d11_context.h"
+
+using namespace rf;
+
+namespace df::gr::d3d11
+{
+    constexpr int instance_ring_buffer_size = 12288;
+    constexpr int instance_ring_buffer_segments = 3;
+
+    ParticleRenderer::ParticleRenderer(ComPtr<ID3D11Device> device, ShaderManager& shader_manager, RenderContext& render_context, DynamicGeometryRenderer& dyn_geo_renderer) :
+        device_{device}, render_context_{render_context}, dyn_geo_renderer_{dyn_geo_renderer},
+        instance_ring_buffer_{instance_ring_buffer_size, D3D11_BIND_VERTEX_BUFFER, device_,
+            render_context.device_context(), instance_ring_buffer_segments}
+    {
+        GpuParticleCorner corners[] = {
+            {-1.0f,  1.0f, 0.0f, 0.0f},
+            { 1.0f,  1.0f, 1.0f, 0.0f},
+            { 1.0f, -1.0f, 1.0f, 1.0f},
+            {-1.0f, -1.0f, 0.0f, 1.0f},
+        };
+        CD3D11_BUFFER_DESC vb_desc{
+            sizeof(corners),
+            D3D11_BIND_VERTEX_BUFFER,
+            D3D11_USAGE_IMMUTABLE,
+        };
+        D3D11_SUBRESOURCE_DATA vb_subres_data{corners, 0, 0};
+        DF_GR_D3D11_CHECK_HR(
+            device_->CreateBuffer(&vb_desc, &vb_subres_data, &corner_vb_)
+        );
+
+        rf::ushort indices[] = {0, 1, 2, 0, 2, 3};
+        CD3D11_BUFFER_DESC ib_desc{
+            sizeof(indices),
+            D3D11_BIND_INDEX_BUFFER,
+            D3D11_USAGE_IMMUTABLE,
+        };
+        D3D11_SUBRESOURCE_DATA ib_subres_data{indices, 0, 0};
+        DF_GR_D3D11_CHECK_HR(
+            device_->CreateBuffer(&ib_desc, &ib_subres_data, &corner_ib_)
+        );
+
+        vertex_shader_ = shader_manager.get_vertex_shader(VertexShaderId::particle);
+        pixel_shader_ = shader_manager.get_pixel_shader(PixelShaderId::standard);
+    }
+
+    bool ParticleRenderer::can_render(ParticleEmitter* emitter) const
+    {
+        // Animated particles and particles using a different bitmap than the emitter are left for the engine
+        for (Particle* p = emitter->particle_list.next; p != &emitter->particle_list; p = p->next) {
+            if (p->num_frames > 1 || p->first_frame_bitmap != emitter->pci.bitmap_handle) {
+                return false;
+            }
+        }
+        return emitter->pci.bitmap_handle != -1;
+    }
+
+    void ParticleRenderer::render_emitter(ParticleEmitter* emitter, const std::function<void()>& default_render)
+    {
+        if (!g_game_config.gpu_particles || !can_render(emitter)) {
+            default_render();
+            return;
+        }
+
+        ModeCacheKey key{emitter->pci.bitmap_handle, emitter->pci.flags, emitter->pci.flags2};
+        auto it = mode_cache_.find(key);
+        if (it == mode_cache_.end()) {
+            // Let the engine render this emitter once and remember the render mode it picks for the bitmap and flags
+            dyn_geo_renderer_.begin_mode_capture();
+            default_render();
+            std::optional<rf::gr::Mode> mode = dyn_geo_renderer_.end_mode_capture();
+            if (mode) {
+                mode_cache_.insert({key, mode.value()});
+            }
+            return;
+        }
+        draw(emitter, it->second);
+    }
+
+    void ParticleRenderer::draw(ParticleEmitter* emitter, rf::gr::Mode mode)
+    {
+        // Keep order of geometry queued before this emitter
+        dyn_geo_renderer_.flush();
+
+        render_context_.set_vertex_buffer(corner_vb_, sizeof(GpuParticleCorner), 0);
+        render_context_.set_vertex_buffer(instance_ring_buffer_.get_buffer(), sizeof(GpuParticleInstance), 1);
+        render_context_.set_index_buffer(corner_ib_);
+        render_context_.set_vertex_shader(vertex_shader_);
+        render_context_.set_pixel_shader(pixel_shader_);
+        render_context_.set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        render_context_.set_mode(mode);
+        auto textures = normalize_texture_handles_for_mode(mode, {emitter->pci.bitmap_handle, -1});
+        render_context_.set_textures(textures[0], textures[1]);
+        render_context_.set_cull_mode(D3D11_CULL_NONE);
+
+        int max_instances = instance_ring_buffer_.get_segment_size();
+        Particle* p = emitter->particle_list.next;
+        while (p != &emitter->particle_list) {
+            int num_instances = 0;
+            for (Particle* it = p; it != &emitter->particle_list && num_instances < max_instances; it = it->next) {
+                ++num_instances;
+            }
+            GpuParticleInstance* gpu_instances = instance_ring_buffer_.alloc(num_instances);
+            for (int i = 0; i < num_instances; ++i, p = p->next) {
+                GpuParticleInstance& inst = gpu_instances[i];
+                inst.x = p->pos.x;
+                inst.y = p->pos.y;
+                inst.z = p->pos.z;
+                inst.radius = p->radius;
+                inst.angle = p->bitmap_orient;
+                // Current color is interpolated by the engine when the particle is updated
+                inst.diffuse = pack_color(p->clr_current);
+            }
+            auto [start_instance, count] = instance_ring_buffer_.submit();
+            render_context_.draw_indexed_instanced(6, count, start_instance);
+        }
+    }
+
+    void ParticleRenderer::clear_cache()
+    {
+        mode_cache_.clear();
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <map>
+#include <tuple>
+#include <d3d11.h>
+#include <common/ComPtr.h>
+#include "gr_d3d11_shader.h"
+#include "gr_d3d11_buffer.h"
+
+namespace rf
+{
+    struct ParticleEmitter;
+}
+
+namespace df::gr::d3d11
+{
+    class RenderContext;
+    class DynamicGeometryRenderer;
+
+    class ParticleRenderer
+    {
+    public:
+        ParticleRenderer(ComPtr<ID3D11Device> device, ShaderManager& shader_manager, RenderContext& render_context, DynamicGeometryRenderer& dyn_geo_renderer);
+        void render_emitter(rf::ParticleEmitter* emitter, const std::function<void()>& default_render);
+        void clear_cache();
+
+    private:
+        bool can_render(rf::ParticleEmitter* emitter) const;
+        void draw(rf::ParticleEmitter* emitter, rf::gr::Mode mode);
+
+        ComPtr<ID3D11Device> device_;
+        RenderContext& render_context_;
+        DynamicGeometryRenderer& dyn_geo_renderer_;
+        ComPtr<ID3D11Buffer> corner_vb_;
+        ComPtr<ID3D11Buffer> corner_ib_;
+        RingBuffer<GpuParticleInstance> instance_ring_buffer_;
+        VertexShaderAndLayout vertex_shader_;
+        ComPtr<ID3D11PixelShader> pixel_shader_;
+        // Render mode used by the engine for particles with a given bitmap and flags (blending depends on flags)
+        using ModeCacheKey = std::tuple<int, int, int>;
+        std::map<ModeCacheKey, rf::gr::Mode> mode_cache_;
+    };
+}
@@ -3,6 +3,7 @@
 #include "gr_d3d11.h"
 #include "../../rf/file/file.h"
 #include "gr_d3d11_context.h"
+#include "../../rf/os/console.h"
 
 namespace df::gr::d3d11
 {
@@ -10,6 +11,12 @@ namespace df::gr::d3d11
     {
     }
 
+    void ShaderManager::print_stats() const
+    {
+        rf::console::print("Vertex shaders: {} loaded, {} misses", vertex_shaders_.size(), vertex_shader_stats_.misses);
+        rf::console::print("Pixel shaders: {} loaded, {} misses", pixel_shaders_.size(), pixel_shader_stats_.misses);
+    }
+
     VertexShaderAndLayout
     ShaderManager::load_vertex_shader(const char* filename, VertexLayout vertex_layout)
     {
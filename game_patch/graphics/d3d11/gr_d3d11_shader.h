@@ -5,6 +5,7 @@
 #include <d3d11.h>
 #include <common/ComPtr.h>
 #include "gr_d3d11_vertex.h"
+#include "gr_d3d11_cache_stats.h"
 
 namespace df::gr::d3d11
 {
@@ -21,6 +22,7 @@ namespace df::gr::d3d11
         standard,
         character,
         transformed,
+        particle,
     };
 
     enum class PixelShaderId
@@ -38,6 +40,8 @@ namespace df::gr::d3d11
                 return "character_vs.bin";
             case VertexShaderId::transformed:
                 return "transformed_vs.bin";
+            case VertexShaderId::particle:
+                return "particle_vs.bin";
             default:
                 return nullptr;
         }
@@ -52,6 +56,8 @@ namespace df::gr::d3d11
                 return VertexLayout::character;
             case VertexShaderId::transformed:
                 return VertexLayout::transformed;
+            case VertexShaderId::particle:
+                return VertexLayout::particle;
             default:
                 return VertexLayout::standard;
         }
@@ -78,6 +84,7 @@ namespace df::gr::d3d11
         {
             auto it = vertex_shaders_.find(filename);
             if (it == vertex_shaders_.end()) {
+                ++vertex_shader_stats_.misses;
                 it = vertex_shaders_.insert({filename, load_vertex_shader(filename, vertex_layout)}).first;
             }
             return it->second;
@@ -87,6 +94,7 @@ namespace df::gr::d3d11
         {
             auto it = pixel_shaders_.find(filename);
             if (it == pixel_shaders_.end()) {
+                ++pixel_shader_stats_.misses;
                 it = pixel_shaders_.insert({filename, load_pixel_shader(filename)}).first;
             }
             return it->second;
@@ -105,6 +113,8 @@ namespace df::gr::d3d11
             return get_pixel_shader(get_pixel_shader_filename(pixel_shader_id));
         }
 
+        void print_stats() const;
+
     private:
         VertexShaderAndLayout load_vertex_shader(const char* filename, VertexLayout vertex_layout);
         VertexShaderAndLayout load_vertex_shader(const char* filename, const D3D11_INPUT_ELEMENT_DESC input_elements[], std::size_t num_input_elements);
@@ -121,5 +131,7 @@ namespace df::gr::d3d11
 
         std::unordered_map<std::string, VertexShaderAndLayout> vertex_shaders_;
         std::unordered_map<std::string, ComPtr<ID3D11PixelShader>> pixel_shaders_;
+        CacheStats vertex_shader_stats_;
+        CacheStats pixel_shader_stats_;
     };
 }
@@ -13,11 +13,13 @@
 #include "../../rf/gr/gr_light.h"
 #include "../../rf/level.h"
 #include "../../os/console.h"
+#include "../../main/main.h"
 #include "gr_d3d11.h"
 #include "gr_d3d11_solid.h"
 #include "gr_d3d11_shader.h"
 #include "gr_d3d11_context.h"
 #include "gr_d3d11_dynamic_geometry.h"
+#include "gr_d3d11_deferred.h"
 
 using namespace rf;
 
@@ -205,6 +207,7 @@ namespace df::gr::d3d11
         {}
 
         void render(FaceRenderType what, RenderContext& context);
+        void prepare_for_deferred(FaceRenderType what, RenderContext& context, ResolvedTextureViews& texture_views);
 
     private:
         SolidBatches batches_;
@@ -228,6 +231,13 @@ namespace df::gr::d3d11
         }
     }
 
+    void GRenderCache::prepare_for_deferred(FaceRenderType what, RenderContext& render_context, ResolvedTextureViews& texture_views)
+    {
+        for (SolidBatch& b : batches_.get_batches(what)) {
+            render_context.prepare_for_deferred(b.mode, b.textures[0], b.textures[1], texture_views);
+        }
+    }
+
     class GRenderCacheBuilder
     {
     private:
@@ -470,6 +480,7 @@ namespace df::gr::d3d11
         RoomRenderCache(rf::GSolid* solid, rf::GRoom* room, ID3D11Device* device);
         ~RoomRenderCache() {}
         void render(FaceRenderType render_type, ID3D11Device* device, RenderContext& context);
+        GRenderCache* get_cache(ID3D11Device* device);
 
         rf::GRoom* room() const
         {
@@ -521,7 +532,7 @@ namespace df::gr::d3d11
         state_ = 0;
     }
 
-    void RoomRenderCache::render(FaceRenderType render_type, ID3D11Device* device, RenderContext& context)
+    GRenderCache* RoomRenderCache::get_cache(ID3D11Device* device)
     {
         if (invalid()) {
             xlog::debug("Room {} render cache invalidated!", room_->room_index);
@@ -529,8 +540,14 @@ namespace df::gr::d3d11
             update(device);
         }
 
-        if (cache_) {
-            cache_.value().render(render_type, context);
+        return cache_ ? &cache_.value() : nullptr;
+    }
+
+    void RoomRenderCache::render(FaceRenderType render_type, ID3D11Device* device, RenderContext& context)
+    {
+        GRenderCache* cache = get_cache(device);
+        if (cache) {
+            cache->render(render_type, context);
         }
     }
 
@@ -756,16 +773,21 @@ namespace df::gr::d3d11
 
         before_render(rf::zero_vector, rf::identity_matrix);
 
-        for (int i = 0; i < num_rooms; ++i) {
-            auto room = rooms[i];
+        if (should_render_deferred(num_rooms)) {
+            render_solid_deferred(solid, rooms, num_rooms);
+        }
+        else {
+            for (int i = 0; i < num_rooms; ++i) {
+                auto room = rooms[i];
 
-            render_room_faces(solid, room, FaceRenderType::opaque);
+                render_room_faces(solid, room, FaceRenderType::opaque);
 
-            // Note: calling set_currently_rendered_room could improve culling here but it breaks some levels
-            // if a detail brush is contained in multiple normal rooms
-            for (GRoom* detail_room : room->detail_rooms) {
-                if (detail_room->room_to_render_with == room && !gr::cull_bounding_box(detail_room->bbox_min, detail_room->bbox_max)) {
-                    render_detail(solid, detail_room, false);
+                // Note: calling set_currently_rendered_room could improve culling here but it breaks some levels
+                // if a detail brush is contained in multiple normal rooms
+                for (GRoom* detail_room : room->detail_rooms) {
+                    if (detail_room->room_to_render_with == room && !gr::cull_bounding_box(detail_room->bbox_min, detail_room->bbox_max)) {
+                        render_detail(solid, detail_room, false);
+                    }
                 }
             }
         }
@@ -778,13 +800,71 @@ namespace df::gr::d3d11
         render_context_.update_lights();
     }
 
+    bool SolidRenderer::should_render_deferred(int num_rooms)
+    {
+        // Splitting a few rooms between threads costs more than it saves
+        constexpr int min_rooms_for_deferred = 8;
+        if (!g_game_config.multithreaded_rendering || num_rooms < min_rooms_for_deferred) {
+            return false;
+        }
+        if (!command_list_recorder_) {
+            command_list_recorder_ = std::make_unique<CommandListRecorder>(device_, render_context_,
+                CommandListRecorder::default_num_workers());
+            for (int i = 0; i < command_list_recorder_->num_workers(); ++i) {
+                command_list_recorder_->worker_render_context(i).set_resolved_texture_views(&deferred_texture_views_);
+            }
+        }
+        return command_list_recorder_->available();
+    }
+
+    void SolidRenderer::render_solid_deferred(rf::GSolid* solid, rf::GRoom** rooms, int num_rooms)
+    {
+        // Game engine functions and resource managers are not thread-safe so culling, render cache updates,
+        // texture uploads and state object creation are all done here before recording starts
+        deferred_render_caches_.clear();
+        deferred_texture_views_.clear();
+        for (int i = 0; i < num_rooms; ++i) {
+            auto room = rooms[i];
+            GRenderCache* room_cache = get_or_create_normal_room_cache(solid, room)->get_cache(device_);
+            if (room_cache) {
+                deferred_render_caches_.push_back(room_cache);
+            }
+            for (GRoom* detail_room : room->detail_rooms) {
+                if (detail_room->room_to_render_with == room && !gr::cull_bounding_box(detail_room->bbox_min, detail_room->bbox_max)) {
+                    deferred_render_caches_.push_back(get_or_create_detail_room_cache(solid, detail_room));
+                }
+            }
+        }
+        for (GRenderCache* cache : deferred_render_caches_) {
+            cache->prepare_for_deferred(FaceRenderType::opaque, render_context_, deferred_texture_views_);
+        }
+
+        int num_caches = static_cast<int>(deferred_render_caches_.size());
+        int num_workers = command_list_recorder_->num_workers();
+        command_list_recorder_->record_and_execute([this, num_caches, num_workers](int worker_index, RenderContext& worker_render_context) {
+            // Every worker renders a contiguous range so the original draw order is kept after command lists
+            // are executed
+            int begin = num_caches * worker_index / num_workers;
+            int end = num_caches * (worker_index + 1) / num_workers;
+            before_render(worker_render_context, rf::zero_vector, rf::identity_matrix);
+            for (int i = begin; i < end; ++i) {
+                deferred_render_caches_[i]->render(FaceRenderType::opaque, worker_render_context);
+            }
+        });
+    }
+
     void SolidRenderer::before_render(const rf::Vector3& pos, const rf::Matrix3& orient)
     {
-        render_context_.set_vertex_shader(vertex_shader_);
-        render_context_.set_pixel_shader(pixel_shader_);
-        render_context_.set_model_transform(pos, orient);
-        render_context_.set_cull_mode(D3D11_CULL_BACK);
-        render_context_.set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        before_render(render_context_, pos, orient);
+    }
+
+    void SolidRenderer::before_render(RenderContext& render_context, const rf::Vector3& pos, const rf::Matrix3& orient)
+    {
+        render_context.set_vertex_shader(vertex_shader_);
+        render_context.set_pixel_shader(pixel_shader_);
+        render_context.set_model_transform(pos, orient);
+        render_context.set_cull_mode(D3D11_CULL_BACK);
+        render_context.set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     }
 
     void SolidRenderer::page_in_solid(rf::GSolid* solid)
@@ -6,6 +6,7 @@
 #include <d3d11.h>
 #include <common/ComPtr.h>
 #include "gr_d3d11_shader.h"
+#include "gr_d3d11_context.h"
 
 namespace rf
 {
@@ -22,6 +23,7 @@ namespace df::gr::d3d11
     class GRenderCacheBuilder;
     class RoomRenderCache;
     class GRenderCache;
+    class CommandListRecorder;
 
     enum class FaceRenderType { opaque, alpha, liquid };
 
@@ -45,6 +47,9 @@ namespace df::gr::d3d11
 
     private:
         void before_render(const rf::Vector3& pos, const rf::Matrix3& orient);
+        void before_render(RenderContext& render_context, const rf::Vector3& pos, const rf::Matrix3& orient);
+        bool should_render_deferred(int num_rooms);
+        void render_solid_deferred(rf::GSolid* solid, rf::GRoom** rooms, int num_rooms);
         void after_render();
         void render_room_faces(rf::GSolid* solid, rf::GRoom* room, FaceRenderType render_type);
         void render_detail(rf::GSolid* solid, rf::GRoom* room, bool alpha);
@@ -66,5 +71,8 @@ namespace df::gr::d3d11
         std::vector<std::unique_ptr<RoomRenderCache>> room_cache_;
         std::vector<std::unique_ptr<GRenderCache>> detail_render_cache_;
         std::unordered_map<rf::GSolid*, std::unique_ptr<GRenderCache>> mover_render_cache_;
+        std::unique_ptr<CommandListRecorder> command_list_recorder_;
+        std::vector<GRenderCache*> deferred_render_caches_;
+        ResolvedTextureViews deferred_texture_views_;
     };
 }
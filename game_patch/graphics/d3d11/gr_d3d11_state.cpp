@@ -1,6 +1,10 @@
+#include <fstream>
+#include <sstream>
+#include <string>
 #include "gr_d3d11.h"
 #include "gr_d3d11_state.h"
 #include "../../main/main.h"
+#include "../../rf/os/console.h"
 
 using namespace rf;
 
@@ -11,6 +15,94 @@ namespace df::gr::d3d11
     {
     }
 
+    void StateManager::warm_up(const char* manifest_filename)
+    {
+        std::ifstream file{manifest_filename};
+        if (!file) {
+            xlog::debug("D3D11 state manifest {} not found", manifest_filename);
+            return;
+        }
+
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream ss{line};
+            std::string type;
+            ss >> type;
+            if (type == "sampler") {
+                int ts;
+                if (ss >> ts && ts >= gr::TEXTURE_SOURCE_NONE && ts <= gr::TEXTURE_SOURCE_MT_CLAMP_TRILIN
+                    && !sampler_state_cache_.contains(ts)) {
+                    sampler_state_cache_.emplace(ts, create_sampler_state(static_cast<gr::TextureSource>(ts)));
+                    ++num_warmed_up_;
+                }
+            }
+            else if (type == "blend") {
+                int ab;
+                if (ss >> ab && ab >= gr::ALPHA_BLEND_NONE && ab <= gr::ALPHA_BLEND_SWAPPED_SRC_DEST_COLOR
+                    && !blend_state_cache_.contains(ab)) {
+                    blend_state_cache_.emplace(ab, create_blend_state(static_cast<gr::AlphaBlend>(ab)));
+                    ++num_warmed_up_;
+                }
+            }
+            else if (type == "depth_stencil") {
+                int key;
+                // Depth stencil states depend on the depth buffer type so skip entries created for another one
+                if (ss >> key && (key >> 8) == static_cast<int>(gr::screen.depthbuffer_type)
+                    && (key & 0xFF) <= gr::ZBUFFER_TYPE_FULL_ALPHA_TEST && !depth_stencil_state_cache_.contains(key)) {
+                    auto zbt = static_cast<gr::ZbufferType>(key & 0xFF);
+                    depth_stencil_state_cache_.emplace(key, create_depth_stencil_state(zbt));
+                    ++num_warmed_up_;
+                }
+            }
+            else if (type == "rasterizer") {
+                int cull_mode, depth_bias, depth_clip_enable;
+                if (ss >> cull_mode >> depth_bias >> depth_clip_enable
+                    && cull_mode >= D3D11_CULL_NONE && cull_mode <= D3D11_CULL_BACK) {
+                    auto key = std::make_tuple(static_cast<D3D11_CULL_MODE>(cull_mode), depth_bias, depth_clip_enable != 0);
+                    if (!rasterizer_state_cache_.contains(key)) {
+                        rasterizer_state_cache_.emplace(key, create_rasterizer_state(std::get<0>(key), depth_bias, std::get<2>(key)));
+                        ++num_warmed_up_;
+                    }
+                }
+            }
+        }
+        xlog::info("Created {} D3D11 state objects from {}", num_warmed_up_, manifest_filename);
+    }
+
+    void StateManager::save_manifest(const char* manifest_filename) const
+    {
+        std::ofstream file{manifest_filename};
+        if (!file) {
+            xlog::warn("Cannot write D3D11 state manifest {}", manifest_filename);
+            return;
+        }
+        for (const auto& [key, state] : sampler_state_cache_) {
+            file << "sampler " << key << '\n';
+        }
+        for (const auto& [key, state] : blend_state_cache_) {
+            file << "blend " << key << '\n';
+        }
+        for (const auto& [key, state] : depth_stencil_state_cache_) {
+            file << "depth_stencil " << key << '\n';
+        }
+        for (const auto& [key, state] : rasterizer_state_cache_) {
+            auto [cull_mode, depth_bias, depth_clip_enable] = key;
+            file << "rasterizer " << static_cast<int>(cull_mode) << ' ' << depth_bias << ' ' << (depth_clip_enable ? 1 : 0) << '\n';
+        }
+    }
+
+    void StateManager::print_stats() const
+    {
+        auto print = [](const char* name, const CacheStats& stats, std::size_t size) {
+            rf::console::print("{}: {} objects, {} misses", name, size, stats.misses);
+        };
+        print("Sampler states", sampler_state_stats_, sampler_state_cache_.size());
+        print("Blend states", blend_state_stats_, blend_state_cache_.size());
+        print("Depth stencil states", depth_stencil_state_stats_, depth_stencil_state_cache_.size());
+        print("Rasterizer states", rasterizer_state_stats_, rasterizer_state_cache_.size());
+        rf::console::print("State objects created during warm-up: {}", num_warmed_up_);
+    }
+
     ComPtr<ID3D11RasterizerState> StateManager::create_rasterizer_state(D3D11_CULL_MODE cull_mode, int depth_bias, bool depth_clip_enable)
     {
         CD3D11_RASTERIZER_DESC desc{CD3D11_DEFAULT{}};
@@ -2,8 +2,11 @@
 
 #include <unordered_map>
 #include <map>
+#include <tuple>
 #include <d3d11.h>
 #include <common/ComPtr.h>
+#include "gr_d3d11.h"
+#include "gr_d3d11_cache_stats.h"
 
 namespace df::gr::d3d11
 {
@@ -12,6 +15,11 @@ namespace df::gr::d3d11
     public:
         StateManager(ComPtr<ID3D11Device> device);
 
+        // Creates state objects listed in the manifest saved by a previous session
+        void warm_up(const char* manifest_filename);
+        void save_manifest(const char* manifest_filename) const;
+        void print_stats() const;
+
         ID3D11RasterizerState* lookup_rasterizer_state(D3D11_CULL_MODE cull_mode, int depth_bias = 0, bool depth_clip_enable = true)
         {
             auto key = std::make_tuple(cull_mode, depth_bias, depth_clip_enable);
@@ -19,7 +27,7 @@ namespace df::gr::d3d11
             if (it != rasterizer_state_cache_.end()) {
                 return it->second;
             }
-            auto rasterizer_state = create_rasterizer_state(cull_mode, depth_bias, depth_clip_enable);
+            ++rasterizer_state_stats_.misses;
             auto p = rasterizer_state_cache_.emplace(key, create_rasterizer_state(cull_mode, depth_bias, depth_clip_enable));
             return p.first->second;
         }
@@ -40,6 +48,7 @@ namespace df::gr::d3d11
             if (it != sampler_state_cache_.end()) {
                 return it->second;
             }
+            ++sampler_state_stats_.misses;
 
             auto p = sampler_state_cache_.emplace(key, create_sampler_state(ts));
             return p.first->second;
@@ -52,6 +61,7 @@ namespace df::gr::d3d11
             if (it != blend_state_cache_.end()) {
                 return it->second;
             }
+            ++blend_state_stats_.misses;
 
             auto p = blend_state_cache_.emplace(key, create_blend_state(ab));
             return p.first->second;
@@ -64,6 +74,7 @@ namespace df::gr::d3d11
             if (it != depth_stencil_state_cache_.end()) {
                 return it->second;
             }
+            ++depth_stencil_state_stats_.misses;
 
             auto p = depth_stencil_state_cache_.emplace(key, create_depth_stencil_state(zbt));
             return p.first->second;
@@ -80,5 +91,10 @@ namespace df::gr::d3d11
         std::unordered_map<int, ComPtr<ID3D11BlendState>> blend_state_cache_;
         std::unordered_map<int, ComPtr<ID3D11DepthStencilState>> depth_stencil_state_cache_;
         std::map<std::tuple<D3D11_CULL_MODE, int, bool>, ComPtr<ID3D11RasterizerState>> rasterizer_state_cache_;
+        CacheStats sampler_state_stats_;
+        CacheStats blend_state_stats_;
+        CacheStats depth_stencil_state_stats_;
+        CacheStats rasterizer_state_stats_;
+        int num_warmed_up_ = 0;
     };
 }
@@ -12,6 +12,7 @@ namespace df::gr::d3d11
         standard,
         character,
         transformed,
+        particle,
     };
 
     using float3 = std::array<float, 3>;
@@ -108,6 +109,39 @@ namespace df::gr::d3d11
         };
     }
 
+    struct GpuParticleCorner
+    {
+        float x;
+        float y;
+        float u0;
+        float v0;
+    };
+
+    struct GpuParticleInstance
+    {
+        float x;
+        float y;
+        float z;
+        float radius;
+        float angle;
+        int diffuse;
+    };
+    static_assert(sizeof(GpuParticleInstance) == 24);
+
+    template<>
+    inline
+    std::vector<D3D11_INPUT_ELEMENT_DESC>
+    VertexLayoutTrait<VertexLayout::particle>::get_desc()
+    {
+        return {
+            { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "TEXCOORD", 2, DXGI_FORMAT_R32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        };
+    }
+
     inline std::vector<D3D11_INPUT_ELEMENT_DESC> get_vertex_layout_desc(VertexLayout vertex_layout)
     {
         switch (vertex_layout) {
@@ -117,6 +151,8 @@ namespace df::gr::d3d11
                 return VertexLayoutTrait<VertexLayout::character>::get_desc();
             case VertexLayout::transformed:
                 return VertexLayoutTrait<VertexLayout::transformed>::get_desc();
+            case VertexLayout::particle:
+                return VertexLayoutTrait<VertexLayout::particle>::get_desc();
             default:
                 assert(false);
                 return {};
@@ -27,6 +27,7 @@ namespace df::gr::d3d11
     bool set_render_target(int bm_handle);
     void update_window_mode();
     void bitmap_float(int bitmap_handle, float x, float y, float w, float h, float sx, float sy, float sw, float sh, bool flip_x, bool flip_y, rf::gr::Mode mode);
+    void render_particle_emitter(rf::ParticleEmitter* emitter, const std::function<void()>& default_render);
 }
 
 float gr_lod_dist_scale = 1.0f;
@@ -190,6 +191,16 @@ void gr_bitmap_scaled_float(int bitmap_handle, float x, float y, float w, float
     }
 }
 
+void gr_render_particle_emitter(rf::ParticleEmitter* emitter, const std::function<void()>& default_render)
+{
+    if (rf::gr::screen.mode == rf::gr::DIRECT3D && g_game_config.renderer == GameConfig::Renderer::d3d11) {
+        df::gr::d3d11::render_particle_emitter(emitter, default_render);
+    }
+    else {
+        default_render();
+    }
+}
+
 void gr_set_window_mode(rf::gr::WindowMode window_mode)
 {
     if (rf::gr::screen.mode == rf::gr::DIRECT3D) {
@@ -237,6 +248,16 @@ ConsoleCommand2 nearest_texture_filtering_cmd{
     "Toggle nearest texture filtering",
 };
 
+ConsoleCommand2 gpu_particles_cmd{
+    "gpu_particles",
+    []() {
+        g_game_config.gpu_particles = !g_game_config.gpu_particles;
+        g_game_config.save();
+        rf::console::print("GPU particles are {}", g_game_config.gpu_particles ? "enabled" : "disabled");
+    },
+    "Toggle rendering of particles using GPU instancing (D3D11 renderer only)",
+};
+
 ConsoleCommand2 lod_distance_scale_cmd{
     "lod_distance_scale",
     [](std::optional<float> scale_opt) {
@@ -330,4 +351,5 @@ void gr_apply_patch()
     windowed_cmd.register_cmd();
     nearest_texture_filtering_cmd.register_cmd();
     lod_distance_scale_cmd.register_cmd();
+    gpu_particles_cmd.register_cmd();
 }
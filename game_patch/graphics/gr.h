@@ -1,8 +1,14 @@
 #pragma once
 
+#include <functional>
 #include "../rf/bmpman.h"
 #include "../rf/gr/gr.h"
 
+namespace rf
+{
+    struct ParticleEmitter;
+}
+
 void gr_apply_patch();
 int gr_font_get_default();
 void gr_font_set_default(int font_id);
@@ -10,6 +16,7 @@ bool gr_set_render_target(int bm_handle);
 bool gr_is_texture_format_supported(rf::bm::Format format);
 void gr_bitmap_scaled_float(int bitmap_handle, float x, float y, float w, float h, float sx, float sy, float sw, float sh, bool flip_x, bool flip_y, rf::gr::Mode mode);
 float gr_scale_fov_hor_plus(float horizontal_fov);
+void gr_render_particle_emitter(rf::ParticleEmitter* emitter, const std::function<void()>& default_render);
 
 template<typename F>
 void gr_font_run_with_default(int font_id, F fun)
@@ -1,4 +1,5 @@
 #include "../rf/gr/gr.h"
+#include "../rf/gr/gr_light.h"
 
 bool is_find_static_lights = false;
 
@@ -6,11 +7,10 @@ void gr_light_use_static(bool use_static)
 {
     // Enable some experimental flag that causes static lights to be included in computations
     //auto& experimental_alloc_and_lighting = addr_as_ref<bool>(0x00879AF8);
-    auto& gr_light_state = addr_as_ref<int>(0x00C96874);
     //experimental_alloc_and_lighting = use_static;
     is_find_static_lights = use_static;
     // Increment light cache key to trigger cache invalidation
-    gr_light_state++;
+    rf::gr::light_state++;
 }
 
 void gr_light_apply_patch()
@@ -25,6 +25,8 @@
 #include "../hud/multi_spectate.h"
 #include "../object/object.h"
 #include "../multi/multi.h"
+#include "../multi/match_log.h"
+#include "../multi/cheat_detection.h"
 #include "../multi/server.h"
 #include "../misc/misc.h"
 #include "../misc/vpackfile.h"
@@ -77,6 +79,9 @@ CodeInjection after_full_game_init_hook{
 CodeInjection cleanup_game_hook{
     0x004B2821,
     []() {
+        match_log_shutdown();
+        cheat_detection_shutdown();
+        server_level_prefetch_shutdown();
         debug_cleanup();
     },
 };
@@ -102,6 +107,9 @@ static void maybe_autosave()
 FunHook<int()> rf_do_frame_hook{
     0x004B2D90,
     []() {
+        if (rf::is_dedicated_server) {
+            server_tick_wait();
+        }
         debug_do_frame_pre();
         rf::os_poll();
         high_fps_update();
@@ -110,6 +118,13 @@ FunHook<int()> rf_do_frame_hook{
         maybe_autosave();
         debug_do_frame_post();
         multi_level_download_update();
+        multi_packet_replay_do_frame();
+        multi_net_sim_do_frame();
+        multi_obj_update_delta_do_frame();
+        multi_state_snapshot_do_frame();
+        multi_reliable_transport_do_frame();
+        multi_io_flush_coalesced_packets();
+        multi_server_browser_do_frame();
         return result;
     },
 };
@@ -11,6 +11,9 @@
 #include "../os/console.h"
 #include "../main/main.h"
 #include "../multi/multi.h"
+#include "../multi/match_log.h"
+#include "../multi/cheat_detection.h"
+#include "../multi/net_telemetry.h"
 #include "../hud/multi_spectate.h"
 #include <common/utils/list-utils.h>
 #include <common/config/GameConfig.h>
@@ -53,6 +56,9 @@ FunHook<void(rf::Player*)> player_destroy_hook{
     [](rf::Player* player) {
         multi_spectate_on_destroy_player(player);
         reset_player_additional_data(player);
+        net_telemetry_on_player_destroy(player);
+        match_log_player_leave(player);
+        cheat_detection_on_player_destroy(player);
         player_destroy_hook.call_target(player);
     },
 };
@@ -2,7 +2,12 @@
 #include <map>
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <common/utils/string-utils.h>
+#include <common/net/ObjUpdateDelta.h>
+#include <common/net/ReliableTransport.h>
+#include <common/net/StateSnapshot.h>
 #include "../rf/math/vector.h"
 #include "../rf/math/matrix.h"
 #include "../rf/os/timestamp.h"
@@ -20,6 +25,52 @@ struct PlayerNetGameSaveData
     rf::Matrix3 orient;
 };
 
+// Network conditions of the player connection are also used by lag compensation
+struct AdaptiveUpdateRateState
+{
+    float rtt_ms = 0.0f;
+    float jitter_ms = 0.0f;
+    float loss = 0.0f;
+    int last_ping = -1;
+    float update_rate = 0.0f;
+    int last_adjust_ms = 0;
+    int last_obj_update_ms = 0;
+};
+
+// Server-side state of the level state snapshot sent to a joining player
+struct StateSnapshotUpload
+{
+    enum class State
+    {
+        idle,
+        // Reliable packets are collected into the snapshot until the end of the frame
+        capturing,
+        // Snapshot chunks are being sent and other reliable packets are delayed until it is finished
+        streaming,
+    };
+
+    bool supported = false;
+    State state = State::idle;
+    StateSnapshotBuilder builder;
+    std::vector<std::vector<std::byte>> chunks;
+    std::size_t next_chunk = 0;
+    float send_budget = 0.0f;
+    int last_send_ms = 0;
+    // Snapshot contains packets that must not be sent when the level has ended (their not_limbo argument was set)
+    bool not_limbo = false;
+    // Reliable packets sent to the player while the snapshot was streamed and their not_limbo argument
+    std::vector<std::pair<std::vector<std::byte>, int>> delayed_packets;
+};
+
+// Server-side state of the DF reliable transport used for sending reliable packets to the player
+struct ReliableTransportState
+{
+    bool client_supported = false;
+    bool socket_ready = false;
+    // Created after the switch packet was sent using the stock reliable channel
+    std::optional<ReliableSender> sender;
+};
+
 struct PlayerAdditionalData
 {
     std::optional<pf_pure_status> received_ac_status{};
@@ -29,6 +80,12 @@ struct PlayerAdditionalData
     std::map<std::string, PlayerNetGameSaveData> saves;
     rf::Vector3 last_teleport_pos;
     rf::TimestampRealtime last_teleport_timestamp;
+    std::optional<ObjUpdateDeltaEncoder> obj_update_delta_encoder;
+    std::unordered_map<uint32_t, int> obj_update_last_sent_ms;
+    AdaptiveUpdateRateState adaptive_update_rate;
+    std::vector<std::byte> pending_unreliable_packets;
+    StateSnapshotUpload state_snapshot;
+    ReliableTransportState reliable_transport;
 };
 
 void find_player(const StringMatcher& query, std::function<void(rf::Player*)> consumer);
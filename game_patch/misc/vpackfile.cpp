@@ -563,6 +563,35 @@ void vpackfile_find_matching_files(const StringMatcher& query, std::function<voi
     }
 }
 
+std::vector<VPackfileRange> vpackfile_get_level_file_ranges(const char* level_filename)
+{
+    auto* level_entry = vpackfile_find_new(level_filename);
+    if (!level_entry) {
+        return {};
+    }
+    auto* packfile = level_entry->parent;
+    if (!packfile->is_user_maps) {
+        // Stock packfiles are shared by all levels - only the level file itself is specific to the level
+        return {{packfile->path, level_entry->block * 2048u, level_entry->size}};
+    }
+    // User map packfile contains level specific textures, meshes and sounds. Include entries that are not overridden
+    // by other packfiles and merge adjacent ones.
+    std::vector<VPackfileRange> ranges;
+    for (auto& entry : packfile->files) {
+        if (vpackfile_find_new(entry.name) != &entry) {
+            continue;
+        }
+        std::size_t offset = entry.block * 2048u;
+        if (!ranges.empty() && ranges.back().offset + ranges.back().size + 2048 > offset) {
+            ranges.back().size = offset + entry.size - ranges.back().offset;
+        }
+        else {
+            ranges.push_back({packfile->path, offset, entry.size});
+        }
+    }
+    return ranges;
+}
+
 void vpackfile_disable_overriding()
 {
     g_is_overriding_disabled = true;
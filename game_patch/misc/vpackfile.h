@@ -1,6 +1,8 @@
 #pragma once
 
 #include <functional>
+#include <string>
+#include <vector>
 #include <common/utils/string-utils.h>
 
 enum GameLang
@@ -10,8 +12,16 @@ enum GameLang
     LANG_FR = 2,
 };
 
+struct VPackfileRange
+{
+    std::string path;
+    std::size_t offset;
+    std::size_t size;
+};
+
 void vpackfile_apply_patches();
 GameLang get_installed_game_lang();
 bool is_modded_game();
 void vpackfile_find_matching_files(const StringMatcher& query, std::function<void(const char*)> result_consumer);
 void vpackfile_disable_overriding();
+std::vector<VPackfileRange> vpackfile_get_level_file_ranges(const char* level_filename);
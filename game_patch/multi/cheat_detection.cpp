@@ -0,0 +1,548 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <optional>
+#include <string>
+#include <thread>
+#include <xlog/xlog.h>
+#include <common/utils/list-utils.h>
+#include <common/utils/spsc-queue.h>
+#include "../rf/multi.h"
+#include "../rf/entity.h"
+#include "../rf/weapon.h"
+#include "../rf/player/player.h"
+#include "../rf/os/timer.h"
+#include "../rf/os/frametime.h"
+#include "../os/console.h"
+#include "../misc/player.h"
+#include "cheat_detection.h"
+#include "match_log.h"
+#include "multi.h"
+#include "server_internal.h"
+
+constexpr std::size_t cheat_sample_queue_size = 8192;
+constexpr std::size_t cheat_flag_queue_size = 64;
+// How long the analyzer thread sleeps when there are no samples
+constexpr auto cheat_analyzer_idle_sleep = std::chrono::milliseconds{10};
+// Number of movement samples kept for every player (about two seconds on a server running at 60 FPS)
+constexpr std::size_t cheat_move_history_size = 128;
+// Speed is checked after this many new movement samples and only if at least this many samples are available
+constexpr int cheat_speed_check_interval = 32;
+constexpr std::size_t cheat_speed_min_samples = 64;
+// Teleport distance is only checked for steps shorter than this (longer gaps are caused by packet loss)
+constexpr int cheat_teleport_max_step_ms = 500;
+constexpr std::size_t cheat_teleport_history_size = 4;
+constexpr int cheat_teleport_window_ms = 10000;
+// Fire cadence is checked for a series of semi-automatic shots without a longer pause
+constexpr std::size_t cheat_fire_history_size = 32;
+constexpr int cheat_fire_max_pause_ms = 1000;
+// Ratio of shots fired right when the weapon became ready above which clicking is not considered human
+constexpr float cheat_fire_max_ready_ratio = 0.8f;
+// Aim changes this long before a shot are checked for snapping
+constexpr int cheat_snap_window_ms = 150;
+constexpr int cheat_snap_max_step_ms = 50;
+constexpr std::size_t cheat_snap_history_size = 32;
+constexpr std::size_t cheat_snap_min_shots = 16;
+constexpr float cheat_snap_max_ratio = 0.5f;
+// Minimal time between two flags of the same kind for a player
+constexpr int cheat_flag_cooldown_ms = 30000;
+
+enum class CheatSampleType : uint8_t
+{
+    reset,
+    move,
+    fire,
+};
+
+// Sample passed from the game thread to the analyzer thread. It is small and trivially copyable so it can be pushed
+// into the queue for every player every frame.
+struct CheatSample
+{
+    CheatSampleType type;
+    uint8_t player_id;
+    unsigned serial;
+    int time_ms;
+    int frame_ms;
+    int fire_wait_ms;
+    int entity_handle;
+    float max_speed;
+    rf::Vector3 pos;
+    rf::Vector3 aim_dir;
+};
+
+enum class CheatDetector : uint8_t
+{
+    speed,
+    teleport,
+    fire_cadence,
+    aim_snap,
+    num_detectors,
+};
+
+static const char* cheat_detector_name(CheatDetector detector)
+{
+    static constexpr std::array<const char*, static_cast<int>(CheatDetector::num_detectors)> names{
+        "speed", "teleport", "fire_cadence", "aim_snap",
+    };
+    return names[static_cast<int>(detector)];
+}
+
+struct CheatFlag
+{
+    CheatDetector detector;
+    uint8_t player_id;
+    unsigned serial;
+    float value;
+    float threshold;
+};
+
+// Thresholds are copied when the analyzer starts so the analyzer thread never reads the server config
+struct CheatDetectionThresholds
+{
+    float max_speed_factor;
+    float teleport_distance;
+    float snap_angle;
+};
+
+// Fixed-size ring buffer. Index 0 is the oldest element.
+template<typename T, std::size_t N>
+class TelemetryRing
+{
+public:
+    void push(const T& value)
+    {
+        items_[(start_ + count_) % N] = value;
+        if (count_ < N) {
+            ++count_;
+        }
+        else {
+            start_ = (start_ + 1) % N;
+        }
+    }
+
+    void clear()
+    {
+        start_ = 0;
+        count_ = 0;
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        return count_;
+    }
+
+    [[nodiscard]] bool full() const
+    {
+        return count_ == N;
+    }
+
+    [[nodiscard]] const T& operator[](std::size_t index) const
+    {
+        return items_[(start_ + index) % N];
+    }
+
+    [[nodiscard]] const T& back() const
+    {
+        return (*this)[count_ - 1];
+    }
+
+private:
+    std::array<T, N> items_{};
+    std::size_t start_ = 0;
+    std::size_t count_ = 0;
+};
+
+struct MoveStep
+{
+    int time_ms;
+    int dt_ms;
+    float speed;
+    float max_speed;
+    float aim_angle;
+};
+
+struct PlayerTelemetry
+{
+    unsigned serial = 0;
+    int entity_handle = -1;
+    bool has_last_move = false;
+    CheatSample last_move;
+    TelemetryRing<MoveStep, cheat_move_history_size> steps;
+    int steps_since_speed_check = 0;
+    TelemetryRing<int, cheat_teleport_history_size> teleports;
+    int last_semi_auto_shot_ms = 0;
+    int last_fire_wait_ms = 0;
+    TelemetryRing<bool, cheat_fire_history_size> shots_when_ready;
+    TelemetryRing<bool, cheat_snap_history_size> shot_snaps;
+    std::array<int, static_cast<int>(CheatDetector::num_detectors)> last_flag_ms{};
+    std::array<bool, static_cast<int>(CheatDetector::num_detectors)> flagged{};
+};
+
+static float angle_between_deg(const rf::Vector3& a, const rf::Vector3& b)
+{
+    constexpr float rad_to_deg = 57.2957795f;
+    float dot = std::clamp(a.dot_prod(b), -1.0f, 1.0f);
+    return std::acos(dot) * rad_to_deg;
+}
+
+class CheatAnalyzer
+{
+public:
+    void start(const CheatDetectionThresholds& thresholds)
+    {
+        if (!thread_.joinable()) {
+            thresholds_ = thresholds;
+            stop_ = false;
+            thread_ = std::thread{[this]() { thread_proc(); }};
+        }
+    }
+
+    void stop()
+    {
+        if (thread_.joinable()) {
+            stop_ = true;
+            thread_.join();
+        }
+    }
+
+    [[nodiscard]] bool is_running() const
+    {
+        return thread_.joinable();
+    }
+
+    // Called from the game thread
+    void push(const CheatSample& sample)
+    {
+        if (!samples_.try_push(sample)) {
+            ++num_dropped_;
+        }
+    }
+
+    // Called from the game thread
+    std::optional<CheatFlag> pop_flag()
+    {
+        return flags_.try_pop();
+    }
+
+    [[nodiscard]] unsigned num_processed() const
+    {
+        return num_processed_;
+    }
+
+    [[nodiscard]] unsigned num_dropped() const
+    {
+        return num_dropped_;
+    }
+
+private:
+    void thread_proc()
+    {
+        while (!stop_) {
+            auto sample = samples_.try_pop();
+            if (!sample) {
+                std::this_thread::sleep_for(cheat_analyzer_idle_sleep);
+                continue;
+            }
+            process(sample.value());
+            ++num_processed_;
+        }
+    }
+
+    void process(const CheatSample& sample)
+    {
+        auto& player = players_[sample.player_id];
+        switch (sample.type) {
+            case CheatSampleType::reset:
+                player = {};
+                player.serial = sample.serial;
+                break;
+            case CheatSampleType::move:
+                process_move(player, sample);
+                break;
+            case CheatSampleType::fire:
+                check_aim_snap(player, sample);
+                check_fire_cadence(player, sample);
+                break;
+        }
+    }
+
+    void process_move(PlayerTelemetry& player, const CheatSample& sample)
+    {
+        if (sample.entity_handle != player.entity_handle) {
+            // Player respawned (or level changed) so the new position is not related to the old one
+            player.entity_handle = sample.entity_handle;
+            player.steps.clear();
+            player.steps_since_speed_check = 0;
+            player.has_last_move = false;
+        }
+        if (player.has_last_move) {
+            const auto& last = player.last_move;
+            if (last.pos == sample.pos && last.aim_dir == sample.aim_dir) {
+                // Nothing changed since the last update. Skipping the sample makes the next step cover the whole
+                // time between updates instead of producing alternating zero and doubled speeds.
+                return;
+            }
+            int dt_ms = sample.time_ms - last.time_ms;
+            if (dt_ms <= 0) {
+                return;
+            }
+            rf::Vector3 delta = sample.pos - last.pos;
+            // Falling is not limited by max speed so only horizontal movement is checked
+            delta.y = 0.0f;
+            float dist = delta.len();
+            float aim_angle = angle_between_deg(last.aim_dir, sample.aim_dir);
+            if (dist > thresholds_.teleport_distance && dt_ms < cheat_teleport_max_step_ms) {
+                on_teleport(player, sample, dist);
+            }
+            else {
+                float speed = dist * 1000.0f / static_cast<float>(dt_ms);
+                player.steps.push({sample.time_ms, dt_ms, speed, sample.max_speed, aim_angle});
+                if (++player.steps_since_speed_check >= cheat_speed_check_interval) {
+                    player.steps_since_speed_check = 0;
+                    check_speed(player, sample);
+                }
+            }
+        }
+        player.last_move = sample;
+        player.has_last_move = true;
+    }
+
+    void on_teleport(PlayerTelemetry& player, const CheatSample& sample, float dist)
+    {
+        // Teleporters in levels move players too so only repeated teleports are suspicious
+        player.teleports.push(sample.time_ms);
+        if (player.teleports.full() && sample.time_ms - player.teleports[0] < cheat_teleport_window_ms) {
+            raise_flag(player, sample.player_id, CheatDetector::teleport, sample.time_ms, dist,
+                thresholds_.teleport_distance);
+            player.teleports.clear();
+        }
+    }
+
+    void check_speed(PlayerTelemetry& player, const CheatSample& sample)
+    {
+        if (player.steps.size() < cheat_speed_min_samples) {
+            return;
+        }
+        // Median ignores short bursts caused by explosions or jump pads
+        std::array<float, cheat_move_history_size> speeds;
+        std::array<float, cheat_move_history_size> max_speeds;
+        std::size_t n = player.steps.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            speeds[i] = player.steps[i].speed;
+            max_speeds[i] = player.steps[i].max_speed;
+        }
+        auto mid = n / 2;
+        std::nth_element(speeds.begin(), speeds.begin() + mid, speeds.begin() + n);
+        std::nth_element(max_speeds.begin(), max_speeds.begin() + mid, max_speeds.begin() + n);
+        float limit = max_speeds[mid] * thresholds_.max_speed_factor;
+        if (limit > 0.0f && speeds[mid] > limit) {
+            raise_flag(player, sample.player_id, CheatDetector::speed, sample.time_ms, speeds[mid], limit);
+        }
+    }
+
+    void check_fire_cadence(PlayerTelemetry& player, const CheatSample& sample)
+    {
+        if (sample.fire_wait_ms <= 0) {
+            // Not a semi-automatic weapon
+            return;
+        }
+        int interval_ms = sample.time_ms - player.last_semi_auto_shot_ms;
+        bool continuous = sample.fire_wait_ms == player.last_fire_wait_ms &&
+            interval_ms <= sample.fire_wait_ms + cheat_fire_max_pause_ms;
+        player.last_semi_auto_shot_ms = sample.time_ms;
+        player.last_fire_wait_ms = sample.fire_wait_ms;
+        if (!continuous) {
+            // Only a continuous series of shots from one weapon is checked
+            player.shots_when_ready.clear();
+            return;
+        }
+        // Humans click before or after the weapon is ready. Macros fire as soon as it is ready so almost all intervals
+        // are equal to the fire wait. Shot times are quantized to server frames so one frame difference is allowed.
+        player.shots_when_ready.push(std::abs(interval_ms - sample.fire_wait_ms) <= sample.frame_ms);
+        if (!player.shots_when_ready.full()) {
+            return;
+        }
+        int num_ready = 0;
+        for (std::size_t i = 0; i < player.shots_when_ready.size(); ++i) {
+            num_ready += player.shots_when_ready[i] ? 1 : 0;
+        }
+        float ratio = static_cast<float>(num_ready) / static_cast<float>(player.shots_when_ready.size());
+        if (ratio >= cheat_fire_max_ready_ratio) {
+            raise_flag(player, sample.player_id, CheatDetector::fire_cadence, sample.time_ms, ratio,
+                cheat_fire_max_ready_ratio);
+        }
+    }
+
+    void check_aim_snap(PlayerTelemetry& player, const CheatSample& sample)
+    {
+        // Bot snaps the aim to the target and fires right away. Humans do flick shots too so only the ratio of
+        // snapped shots is checked.
+        float max_angle = 0.0f;
+        for (std::size_t i = player.steps.size(); i > 0; --i) {
+            const auto& step = player.steps[i - 1];
+            if (sample.time_ms - step.time_ms > cheat_snap_window_ms) {
+                break;
+            }
+            if (step.dt_ms <= cheat_snap_max_step_ms) {
+                max_angle = std::max(max_angle, step.aim_angle);
+            }
+        }
+        player.shot_snaps.push(max_angle >= thresholds_.snap_angle);
+        if (player.shot_snaps.size() < cheat_snap_min_shots) {
+            return;
+        }
+        int num_snaps = 0;
+        for (std::size_t i = 0; i < player.shot_snaps.size(); ++i) {
+            num_snaps += player.shot_snaps[i] ? 1 : 0;
+        }
+        float ratio = static_cast<float>(num_snaps) / static_cast<float>(player.shot_snaps.size());
+        if (ratio >= cheat_snap_max_ratio) {
+            raise_flag(player, sample.player_id, CheatDetector::aim_snap, sample.time_ms, ratio, cheat_snap_max_ratio);
+        }
+    }
+
+    void raise_flag(PlayerTelemetry& player, uint8_t player_id, CheatDetector detector, int now, float value,
+        float threshold)
+    {
+        int index = static_cast<int>(detector);
+        if (player.flagged[index] && now - player.last_flag_ms[index] < cheat_flag_cooldown_ms) {
+            return;
+        }
+        player.flagged[index] = true;
+        player.last_flag_ms[index] = now;
+        flags_.try_push({detector, player_id, player.serial, value, threshold});
+    }
+
+    SpscQueue<CheatSample, cheat_sample_queue_size> samples_;
+    SpscQueue<CheatFlag, cheat_flag_queue_size> flags_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<unsigned> num_processed_{0};
+    std::atomic<unsigned> num_dropped_{0};
+    // Members below are only used by the analyzer thread
+    CheatDetectionThresholds thresholds_{};
+    std::array<PlayerTelemetry, rf::multi_max_player_id> players_;
+};
+
+static CheatAnalyzer g_cheat_analyzer;
+// Incremented when a player leaves so flags raised for the previous owner of the player ID are ignored
+static std::array<unsigned, rf::multi_max_player_id> g_cheat_player_serials{};
+static unsigned g_cheat_num_flags = 0;
+
+static bool is_cheat_detection_enabled()
+{
+    return rf::is_server && server_get_df_config().cheat_detection.enabled;
+}
+
+static bool should_sample_player(rf::Player* player)
+{
+    return player->net_data && player != rf::local_player && !get_player_additional_data(player).is_browser;
+}
+
+void cheat_detection_on_weapon_fire(rf::Player* player, int weapon_type, bool alt_fire)
+{
+    if (!g_cheat_analyzer.is_running() || !player || !should_sample_player(player)) {
+        return;
+    }
+    CheatSample sample{};
+    sample.type = CheatSampleType::fire;
+    sample.player_id = player->net_data->player_id;
+    sample.time_ms = rf::timer_get(1000);
+    sample.frame_ms = static_cast<int>(std::ceil(rf::frametime * 1000.0f));
+    if (rf::weapon_is_semi_automatic(weapon_type)) {
+        sample.fire_wait_ms = rf::weapon_get_fire_wait_ms(weapon_type, alt_fire);
+    }
+    g_cheat_analyzer.push(sample);
+}
+
+void cheat_detection_on_player_destroy(rf::Player* player)
+{
+    if (!g_cheat_analyzer.is_running() || !player->net_data) {
+        return;
+    }
+    uint8_t player_id = player->net_data->player_id;
+    CheatSample sample{};
+    sample.type = CheatSampleType::reset;
+    sample.player_id = player_id;
+    sample.serial = ++g_cheat_player_serials[player_id];
+    g_cheat_analyzer.push(sample);
+}
+
+static void handle_cheat_flag(const CheatFlag& flag)
+{
+    rf::Player* player = rf::multi_find_player_by_id(flag.player_id);
+    if (!player || g_cheat_player_serials[flag.player_id] != flag.serial) {
+        return;
+    }
+    ++g_cheat_num_flags;
+    const char* detector_name = cheat_detector_name(flag.detector);
+    xlog::warn("Cheat detection: player {} flagged by {} detector (value {:.2f}, threshold {:.2f})",
+        player->name.c_str(), detector_name, flag.value, flag.threshold);
+    match_log_cheat_flag(player, detector_name, flag.value, flag.threshold);
+    if (server_get_df_config().cheat_detection.kick) {
+        auto msg = std::format("\xA6 Kicking player {} (flagged by cheat detection)", player->name.c_str());
+        send_chat_line_packet(msg.c_str(), nullptr);
+        rf::multi_kick_player(player);
+    }
+}
+
+void cheat_detection_do_frame()
+{
+    if (!is_cheat_detection_enabled()) {
+        return;
+    }
+    if (!g_cheat_analyzer.is_running()) {
+        const auto& config = server_get_df_config().cheat_detection;
+        g_cheat_analyzer.start({config.max_speed_factor, config.teleport_distance, config.snap_angle});
+    }
+
+    int now = rf::timer_get(1000);
+    for (auto& player : SinglyLinkedList{rf::player_list}) {
+        if (!should_sample_player(&player)) {
+            continue;
+        }
+        rf::Entity* entity = rf::entity_from_handle(player.entity_handle);
+        if (!entity) {
+            continue;
+        }
+        CheatSample sample{};
+        sample.type = CheatSampleType::move;
+        sample.player_id = player.net_data->player_id;
+        sample.time_ms = now;
+        sample.entity_handle = entity->handle;
+        sample.max_speed = std::max(entity->max_vel, entity->info->max_vel);
+        sample.pos = entity->pos;
+        sample.aim_dir = entity->eye_orient.fvec;
+        g_cheat_analyzer.push(sample);
+    }
+
+    while (auto flag = g_cheat_analyzer.pop_flag()) {
+        handle_cheat_flag(flag.value());
+    }
+}
+
+ConsoleCommand2 cheat_detection_cmd{
+    "cheat_detection",
+    []() {
+        if (!g_cheat_analyzer.is_running()) {
+            rf::console::print("Cheat detection is not running");
+            return;
+        }
+        rf::console::print("Samples processed: {}, dropped: {}, players flagged: {}", g_cheat_analyzer.num_processed(),
+            g_cheat_analyzer.num_dropped(), g_cheat_num_flags);
+    },
+    "Prints cheat detection statistics",
+};
+
+void cheat_detection_init()
+{
+    cheat_detection_cmd.register_cmd();
+}
+
+void cheat_detection_shutdown()
+{
+    g_cheat_analyzer.stop();
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Forward declarations
+namespace rf
+{
+    struct Player;
+}
+
+void cheat_detection_on_weapon_fire(rf::Player* player, int weapon_type, bool alt_fire);
+void cheat_detection_on_player_destroy(rf::Player* player);
+void cheat_detection_do_frame();
+void cheat_detection_init();
+void cheat_detection_shutdown();
@@ -206,6 +206,75 @@ ConsoleCommand2 unban_last_cmd{
     "Unbans last banned player",
 };
 
+ConsoleCommand2 unban_cmd{
+    "unban",
+    [](std::string range) {
+        if (rf::is_multi && rf::is_server) {
+            if (multi_ban_unban(range)) {
+                rf::console::print("{} has been unbanned!", range);
+            }
+            else {
+                rf::console::print("{} is not in the banlist", range);
+            }
+        }
+    },
+    "Removes IP range from the banlist",
+    "unban <ip_range>",
+};
+
+ConsoleCommand2 ban_ip_cmd{
+    "ban_ip",
+    [](std::string range, std::optional<int> minutes_opt) {
+        if (rf::is_multi && rf::is_server) {
+            int minutes = minutes_opt.value_or(0);
+            if (!multi_ban_add_range(range, minutes)) {
+                rf::console::print("Invalid IP range: {}", range);
+            }
+            else if (minutes > 0) {
+                rf::console::print("{} has been banned for {} minutes", range, minutes);
+            }
+            else {
+                rf::console::print("{} has been banned", range);
+            }
+        }
+    },
+    "Adds IP range to the banlist, optionally for limited time",
+    "ban_ip <ip_range> [minutes]",
+};
+
+ConsoleCommand2 banlist_reload_cmd{
+    "banlist_reload",
+    []() {
+        if (rf::is_multi && rf::is_server) {
+            auto size = multi_ban_reload();
+            if (size) {
+                rf::console::print("Banlist reloaded ({} entries)", size.value());
+            }
+            else {
+                rf::console::print("Failed to load banlist.txt");
+            }
+        }
+    },
+    "Reloads banlist.txt",
+};
+
+ConsoleCommand2 banlist_import_cmd{
+    "banlist_import",
+    [](std::string filename) {
+        if (rf::is_multi && rf::is_server) {
+            int count = multi_ban_import(filename);
+            if (count < 0) {
+                rf::console::print("Cannot open {}", filename);
+            }
+            else {
+                rf::console::print("Imported {} IP ranges from {}", count, filename);
+            }
+        }
+    },
+    "Adds IP ranges from a blocklist file (one range per line) to the banlist",
+    "banlist_import <filename>",
+};
+
 void init_server_commands()
 {
     map_ext_cmd.register_cmd();
@@ -218,6 +287,10 @@ void init_server_commands()
     AsmWriter(0x0047B580).jmp(kick_cmd_handler_hook);
 
     unban_last_cmd.register_cmd();
+    unban_cmd.register_cmd();
+    ban_ip_cmd.register_cmd();
+    banlist_reload_cmd.register_cmd();
+    banlist_import_cmd.register_cmd();
 
     multi_kick_player_hook.install();
 }
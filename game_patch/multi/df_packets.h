@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+
+#pragma pack(push, 1)
+
+// Dash Faction specific packets. They are sent only to clients and servers that announced support for them.
+enum class df_packet_type : uint8_t
+{
+    obj_update_delta = 0x70,
+    obj_update_delta_ack = 0x71,
+    state_snapshot_hello = 0x72,
+    state_snapshot_chunk = 0x73,
+    reliable_hello = 0x74,
+    reliable_switch = 0x75,
+    reliable_data = 0x76,
+    reliable_ack = 0x77,
+};
+
+struct df_packet_header
+{
+    uint8_t type; // see df_packet_type
+    uint16_t size; // size of data without header
+};
+
+struct df_obj_update_delta_packet
+{
+    df_packet_header hdr; // obj_update_delta
+#ifdef PSEUDOCODE
+    uint8_t data[]; // encoded by ObjUpdateDeltaEncoder
+#endif
+};
+
+struct df_obj_update_delta_ack_packet
+{
+    df_packet_header hdr; // obj_update_delta_ack
+    uint8_t flags; // see df_obj_update_delta_ack_has_sequence
+    uint16_t sequence; // newest received obj_update_delta sequence
+};
+
+// If not set client only announces it is ready to receive obj_update_delta packets
+constexpr uint8_t df_obj_update_delta_ack_has_sequence = 1;
+
+struct df_state_snapshot_hello_packet
+{
+    df_packet_header hdr; // state_snapshot_hello
+};
+
+struct df_state_snapshot_chunk_packet
+{
+    df_packet_header hdr; // state_snapshot_chunk
+#ifdef PSEUDOCODE
+    uint8_t data[]; // chunk encoded by StateSnapshotBuilder
+#endif
+};
+
+struct df_reliable_hello_packet
+{
+    df_packet_header hdr; // reliable_hello
+};
+
+// Sent using the stock reliable channel. Following reliable packets are sent in reliable_data packets.
+struct df_reliable_switch_packet
+{
+    df_packet_header hdr; // reliable_switch
+};
+
+struct df_reliable_data_packet
+{
+    df_packet_header hdr; // reliable_data
+#ifdef PSEUDOCODE
+    uint8_t data[]; // segment encoded by ReliableSender
+#endif
+};
+
+struct df_reliable_ack_packet
+{
+    df_packet_header hdr; // reliable_ack
+#ifdef PSEUDOCODE
+    uint8_t data[]; // acknowledgement encoded by ReliableReceiver
+#endif
+};
+
+#pragma pack(pop)
@@ -11,6 +11,7 @@
 #include "../rf/weapon.h"
 #include "../hud/multi_spectate.h"
 #include "server_internal.h"
+#include "match_log.h"
 
 bool kill_messages = true;
 
@@ -137,6 +138,7 @@ void on_player_kill(rf::Player* killed_player, rf::Player* killer_player)
 
     auto* killed_stats = static_cast<PlayerStatsNew*>(killed_player->stats);
     killed_stats->inc_deaths();
+    match_log_kill(killed_player, killer_player);
 
     if (killer_player) {
         auto* killer_stats = static_cast<PlayerStatsNew*>(killer_player->stats);
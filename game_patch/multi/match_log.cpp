@@ -0,0 +1,496 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <xlog/xlog.h>
+#include <common/utils/list-utils.h>
+#include <common/utils/spsc-queue.h>
+#include <common/utils/string-utils.h>
+#include "../rf/multi.h"
+#include "../rf/level.h"
+#include "../rf/entity.h"
+#include "../rf/weapon.h"
+#include "../rf/player/player.h"
+#include "../rf/os/timer.h"
+#include "../misc/player.h"
+#include "../object/object.h"
+#include "match_log.h"
+#include "multi.h"
+#include "server_internal.h"
+
+constexpr const char* match_log_dir = "logs/matches";
+constexpr std::size_t match_log_queue_size = 4096;
+// How long the writer thread sleeps when there are no events
+constexpr auto match_log_writer_idle_sleep = std::chrono::milliseconds{20};
+
+enum class MatchEventType : uint8_t
+{
+    match_start,
+    match_end,
+    player_summary,
+    join,
+    leave,
+    kill,
+    damage,
+    flag_pickup,
+    flag_capture,
+    vote_start,
+    vote_end,
+    cheat_flag,
+};
+
+static const char* match_event_type_name(MatchEventType type)
+{
+    static constexpr std::array names{
+        "match_start", "match_end", "player_summary", "join", "leave", "kill", "damage", "flag_pickup",
+        "flag_capture", "vote_start", "vote_end", "cheat_flag",
+    };
+    return names[static_cast<int>(type)];
+}
+
+// Event data is copied into fixed-size buffers so pushing it into the queue does not allocate memory
+struct MatchEvent
+{
+    MatchEventType type;
+    int time_ms;
+    int team;
+    char player[32];
+    char target[32];
+    char detail[64];
+    // Meaning depends on the event type (e.g. damage amount or player statistics in the summary)
+    std::array<float, 9> values;
+};
+
+enum PlayerSummaryValue
+{
+    SUMMARY_SCORE,
+    SUMMARY_KILLS,
+    SUMMARY_DEATHS,
+    SUMMARY_MAX_STREAK,
+    SUMMARY_CAPS,
+    SUMMARY_SHOTS_HIT,
+    SUMMARY_SHOTS_FIRED,
+    SUMMARY_DAMAGE_GIVEN,
+    SUMMARY_DAMAGE_RECEIVED,
+};
+
+class MatchLogWriter
+{
+public:
+    void start(bool csv)
+    {
+        if (!thread_.joinable()) {
+            csv_ = csv;
+            stop_ = false;
+            thread_ = std::thread{[this]() { thread_proc(); }};
+        }
+    }
+
+    void stop()
+    {
+        if (thread_.joinable()) {
+            stop_ = true;
+            thread_.join();
+        }
+    }
+
+    // Called from the game thread
+    void push(const MatchEvent& event)
+    {
+        if (!queue_.try_push(event)) {
+            ++num_dropped_;
+        }
+    }
+
+private:
+    void thread_proc()
+    {
+        while (true) {
+            auto event = queue_.try_pop();
+            if (event) {
+                write(event.value());
+                continue;
+            }
+            if (stop_) {
+                break;
+            }
+            file_.flush();
+            std::this_thread::sleep_for(match_log_writer_idle_sleep);
+        }
+        close();
+    }
+
+    void open(const MatchEvent& event)
+    {
+        close();
+        std::error_code ec;
+        std::filesystem::create_directories(match_log_dir, ec);
+        std::time_t now = std::time(nullptr);
+        char time_str[32];
+        std::strftime(time_str, sizeof(time_str), "%Y%m%d-%H%M%S", std::localtime(&now));
+        base_path_ = std::format("{}/{}-{}", match_log_dir, time_str, get_filename_without_ext(event.detail));
+        auto path = base_path_ + (csv_ ? ".csv" : ".jsonl");
+        file_.open(path, std::ios_base::out | std::ios_base::trunc);
+        if (!file_) {
+            xlog::error("Cannot open {}", path);
+            return;
+        }
+        if (csv_) {
+            file_ << "time_ms,event,player,target,detail,team,value\n";
+        }
+    }
+
+    void close()
+    {
+        if (file_.is_open()) {
+            if (num_dropped_ > 0) {
+                xlog::warn("Match log dropped {} events because the queue was full", num_dropped_.load());
+                num_dropped_ = 0;
+            }
+            file_.close();
+        }
+        if (summary_file_.is_open()) {
+            summary_file_.close();
+        }
+    }
+
+    void write(const MatchEvent& event)
+    {
+        if (event.type == MatchEventType::match_start) {
+            open(event);
+        }
+        if (!file_.is_open()) {
+            return;
+        }
+        if (csv_) {
+            write_csv(event);
+        }
+        else {
+            write_json(event);
+        }
+        if (event.type == MatchEventType::match_end) {
+            close();
+        }
+    }
+
+    void write_json(const MatchEvent& event)
+    {
+        std::string line = std::format(R"({{"time_ms": {}, "event": "{}")", event.time_ms,
+            match_event_type_name(event.type));
+        if (event.player[0]) {
+            line += std::format(R"(, "player": "{}")", json_escape(event.player));
+        }
+        bool target_is_player = event.type != MatchEventType::match_start && event.type != MatchEventType::vote_end;
+        if (event.target[0] && target_is_player) {
+            line += std::format(R"(, "target": "{}")", json_escape(event.target));
+        }
+        const auto& v = event.values;
+        switch (event.type) {
+            case MatchEventType::match_start:
+                line += std::format(R"(, "level": "{}", "game_type": "{}", "unix_time": {})", json_escape(event.detail),
+                    event.target, static_cast<long long>(std::time(nullptr)));
+                break;
+            case MatchEventType::match_end:
+                line += std::format(R"(, "red_score": {}, "blue_score": {})", v[0], v[1]);
+                break;
+            case MatchEventType::player_summary:
+                line += std::format(
+                    R"(, "team": {}, "score": {}, "kills": {}, "deaths": {}, "max_streak": {}, "caps": {}, )"
+                    R"("shots_hit": {:.1f}, "shots_fired": {:.1f}, "damage_given": {:.1f}, "damage_received": {:.1f})",
+                    event.team, v[SUMMARY_SCORE], v[SUMMARY_KILLS], v[SUMMARY_DEATHS], v[SUMMARY_MAX_STREAK],
+                    v[SUMMARY_CAPS], v[SUMMARY_SHOTS_HIT], v[SUMMARY_SHOTS_FIRED], v[SUMMARY_DAMAGE_GIVEN],
+                    v[SUMMARY_DAMAGE_RECEIVED]);
+                break;
+            case MatchEventType::kill:
+                line += std::format(R"(, "weapon": "{}")", json_escape(event.detail));
+                break;
+            case MatchEventType::damage:
+                line += std::format(R"(, "damage": {:.1f}, "damage_type": {})", v[0], static_cast<int>(v[1]));
+                break;
+            case MatchEventType::join:
+                line += std::format(R"(, "address": "{}")", event.detail);
+                break;
+            case MatchEventType::flag_pickup:
+            case MatchEventType::flag_capture:
+                line += std::format(R"(, "team": {})", event.team);
+                break;
+            case MatchEventType::vote_start:
+            case MatchEventType::vote_end:
+                line += std::format(R"(, "vote": "{}")", json_escape(event.detail));
+                if (event.type == MatchEventType::vote_end) {
+                    line += std::format(R"(, "result": "{}")", event.target);
+                }
+                break;
+            case MatchEventType::cheat_flag:
+                line += std::format(R"(, "detector": "{}", "value": {:.3f}, "threshold": {:.3f})", event.detail, v[0],
+                    v[1]);
+                break;
+            default:
+                break;
+        }
+        line += "}\n";
+        file_ << line;
+    }
+
+    static std::string csv_escape(std::string_view str)
+    {
+        if (str.find_first_of(",\"\n") == std::string_view::npos) {
+            return std::string{str};
+        }
+        return '"' + string_replace(str, "\"", "\"\"") + '"';
+    }
+
+    void write_csv(const MatchEvent& event)
+    {
+        if (event.type == MatchEventType::player_summary) {
+            // Summary has different columns so it goes to a separate file
+            if (!summary_file_.is_open()) {
+                summary_file_.open(base_path_ + "-summary.csv", std::ios_base::out | std::ios_base::trunc);
+                summary_file_ << "player,team,score,kills,deaths,max_streak,caps,shots_hit,shots_fired,damage_given,"
+                    "damage_received\n";
+            }
+            const auto& v = event.values;
+            summary_file_ << std::format("{},{},{},{},{},{},{},{:.1f},{:.1f},{:.1f},{:.1f}\n", csv_escape(event.player),
+                event.team, v[SUMMARY_SCORE], v[SUMMARY_KILLS], v[SUMMARY_DEATHS], v[SUMMARY_MAX_STREAK],
+                v[SUMMARY_CAPS], v[SUMMARY_SHOTS_HIT], v[SUMMARY_SHOTS_FIRED], v[SUMMARY_DAMAGE_GIVEN],
+                v[SUMMARY_DAMAGE_RECEIVED]);
+            return;
+        }
+        file_ << std::format("{},{},{},{},{},{},{}\n", event.time_ms, match_event_type_name(event.type),
+            csv_escape(event.player), csv_escape(event.target), csv_escape(event.detail), event.team, event.values[0]);
+    }
+
+    SpscQueue<MatchEvent, match_log_queue_size> queue_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<unsigned> num_dropped_{0};
+    // Members below are only used by the writer thread
+    std::ofstream file_;
+    std::ofstream summary_file_;
+    std::string base_path_;
+    bool csv_ = false;
+};
+
+static MatchLogWriter g_match_log_writer;
+static bool g_match_log_active = false;
+static int g_match_start_ms = 0;
+static uint8_t g_prev_red_score = 0;
+static uint8_t g_prev_blue_score = 0;
+// Player IDs because players can leave before the flag state changes
+static int g_prev_red_flag_player_id = -1;
+static int g_prev_blue_flag_player_id = -1;
+
+template<std::size_t N>
+static void copy_str(char (&dst)[N], std::string_view src)
+{
+    std::size_t len = std::min(src.size(), N - 1);
+    std::memcpy(dst, src.data(), len);
+    dst[len] = '\0';
+}
+
+static MatchEvent make_event(MatchEventType type, rf::Player* player = nullptr, rf::Player* target = nullptr)
+{
+    MatchEvent event{};
+    event.type = type;
+    event.time_ms = rf::timer_get(1000) - g_match_start_ms;
+    if (player) {
+        copy_str(event.player, player->name.c_str());
+        event.team = player->team;
+    }
+    if (target) {
+        copy_str(event.target, target->name.c_str());
+    }
+    return event;
+}
+
+static int get_player_id(const rf::Player* player)
+{
+    return player && player->net_data ? player->net_data->player_id : -1;
+}
+
+static bool is_match_log_enabled()
+{
+    return g_match_log_active && rf::is_server;
+}
+
+void match_log_level_start()
+{
+    if (!server_get_df_config().match_log.enabled || !rf::is_server) {
+        return;
+    }
+    g_match_log_writer.start(server_get_df_config().match_log.csv);
+    g_match_log_active = true;
+    g_match_start_ms = rf::timer_get(1000);
+    g_prev_red_score = 0;
+    g_prev_blue_score = 0;
+    g_prev_red_flag_player_id = -1;
+    g_prev_blue_flag_player_id = -1;
+    auto event = make_event(MatchEventType::match_start);
+    copy_str(event.detail, rf::level.filename.c_str());
+    copy_str(event.target, multi_game_type_name(rf::multi_get_game_type()));
+    g_match_log_writer.push(event);
+}
+
+void match_log_level_end()
+{
+    if (!is_match_log_enabled()) {
+        return;
+    }
+    for (auto& player : SinglyLinkedList{rf::player_list}) {
+        if (get_player_additional_data(&player).is_browser) {
+            continue;
+        }
+        auto* stats = static_cast<PlayerStatsNew*>(player.stats);
+        auto event = make_event(MatchEventType::player_summary, &player);
+        event.values[SUMMARY_SCORE] = stats->score;
+        event.values[SUMMARY_KILLS] = stats->num_kills;
+        event.values[SUMMARY_DEATHS] = stats->num_deaths;
+        event.values[SUMMARY_MAX_STREAK] = stats->max_streak;
+        event.values[SUMMARY_CAPS] = stats->caps;
+        event.values[SUMMARY_SHOTS_HIT] = stats->num_shots_hit;
+        event.values[SUMMARY_SHOTS_FIRED] = stats->num_shots_fired;
+        event.values[SUMMARY_DAMAGE_GIVEN] = stats->damage_given;
+        event.values[SUMMARY_DAMAGE_RECEIVED] = stats->damage_received;
+        g_match_log_writer.push(event);
+    }
+    auto event = make_event(MatchEventType::match_end);
+    if (rf::multi_get_game_type() != rf::NG_TYPE_DM) {
+        event.values[0] = rf::multi_get_game_type() == rf::NG_TYPE_CTF ? rf::multi_ctf_get_red_team_score()
+            : rf::multi_tdm_get_red_team_score();
+        event.values[1] = rf::multi_get_game_type() == rf::NG_TYPE_CTF ? rf::multi_ctf_get_blue_team_score()
+            : rf::multi_tdm_get_blue_team_score();
+    }
+    g_match_log_writer.push(event);
+    g_match_log_active = false;
+}
+
+void match_log_kill(rf::Player* killed_player, rf::Player* killer_player)
+{
+    if (!is_match_log_enabled()) {
+        return;
+    }
+    auto event = make_event(MatchEventType::kill, killer_player ? killer_player : killed_player, killed_player);
+    // Projectiles can kill after the killer has switched weapons so use the weapon that dealt the damage. Selected
+    // weapon is only used for damage not dealt by a weapon object (e.g. melee).
+    int weapon_type = weapon_get_damage_source_type();
+    rf::Entity* killer_entity = killer_player ? rf::entity_from_handle(killer_player->entity_handle) : nullptr;
+    if (weapon_type < 0 && killer_entity) {
+        weapon_type = killer_entity->ai.current_primary_weapon;
+    }
+    if (weapon_type >= 0 && weapon_type < rf::num_weapon_types) {
+        copy_str(event.detail, rf::weapon_types[weapon_type].name.c_str());
+    }
+    g_match_log_writer.push(event);
+}
+
+void match_log_damage(rf::Player* attacker, rf::Player* target, float damage, int damage_type)
+{
+    if (!is_match_log_enabled()) {
+        return;
+    }
+    auto event = make_event(MatchEventType::damage, attacker, target);
+    event.values[0] = damage;
+    event.values[1] = static_cast<float>(damage_type);
+    g_match_log_writer.push(event);
+}
+
+void match_log_player_join(rf::Player* player)
+{
+    if (!is_match_log_enabled()) {
+        return;
+    }
+    auto event = make_event(MatchEventType::join, player);
+    unsigned ip = player->net_data->addr.ip_addr;
+    copy_str(event.detail, std::format("{}.{}.{}.{}", ip >> 24, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF));
+    g_match_log_writer.push(event);
+}
+
+void match_log_player_leave(rf::Player* player)
+{
+    if (!is_match_log_enabled() || player == rf::local_player) {
+        return;
+    }
+    g_match_log_writer.push(make_event(MatchEventType::leave, player));
+}
+
+void match_log_vote_start(std::string_view title, rf::Player* owner)
+{
+    if (!is_match_log_enabled()) {
+        return;
+    }
+    auto event = make_event(MatchEventType::vote_start, owner);
+    copy_str(event.detail, title);
+    g_match_log_writer.push(event);
+}
+
+void match_log_vote_end(std::string_view title, std::string_view result)
+{
+    if (!is_match_log_enabled()) {
+        return;
+    }
+    auto event = make_event(MatchEventType::vote_end);
+    copy_str(event.detail, title);
+    copy_str(event.target, result);
+    g_match_log_writer.push(event);
+}
+
+void match_log_cheat_flag(rf::Player* player, std::string_view detector, float value, float threshold)
+{
+    if (!is_match_log_enabled()) {
+        return;
+    }
+    auto event = make_event(MatchEventType::cheat_flag, player);
+    copy_str(event.detail, detector);
+    event.values[0] = value;
+    event.values[1] = threshold;
+    g_match_log_writer.push(event);
+}
+
+void match_log_do_frame()
+{
+    if (!is_match_log_enabled() || rf::multi_get_game_type() != rf::NG_TYPE_CTF) {
+        return;
+    }
+    // There is no hook for flag events so they are detected from the CTF state changes
+    rf::Player* red_flag_player = rf::multi_ctf_get_red_flag_player();
+    rf::Player* blue_flag_player = rf::multi_ctf_get_blue_flag_player();
+    int red_flag_player_id = get_player_id(red_flag_player);
+    int blue_flag_player_id = get_player_id(blue_flag_player);
+    uint8_t red_score = rf::multi_ctf_get_red_team_score();
+    uint8_t blue_score = rf::multi_ctf_get_blue_team_score();
+    if (red_score > g_prev_red_score && g_prev_blue_flag_player_id >= 0) {
+        rf::Player* player = rf::multi_find_player_by_id(static_cast<uint8_t>(g_prev_blue_flag_player_id));
+        if (player) {
+            g_match_log_writer.push(make_event(MatchEventType::flag_capture, player));
+        }
+    }
+    if (blue_score > g_prev_blue_score && g_prev_red_flag_player_id >= 0) {
+        rf::Player* player = rf::multi_find_player_by_id(static_cast<uint8_t>(g_prev_red_flag_player_id));
+        if (player) {
+            g_match_log_writer.push(make_event(MatchEventType::flag_capture, player));
+        }
+    }
+    if (red_flag_player && red_flag_player_id != g_prev_red_flag_player_id) {
+        g_match_log_writer.push(make_event(MatchEventType::flag_pickup, red_flag_player));
+    }
+    if (blue_flag_player && blue_flag_player_id != g_prev_blue_flag_player_id) {
+        g_match_log_writer.push(make_event(MatchEventType::flag_pickup, blue_flag_player));
+    }
+    g_prev_red_score = red_score;
+    g_prev_blue_score = blue_score;
+    g_prev_red_flag_player_id = red_flag_player_id;
+    g_prev_blue_flag_player_id = blue_flag_player_id;
+}
+
+void match_log_shutdown()
+{
+    // Remaining events are written before the thread exits
+    g_match_log_writer.stop();
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string_view>
+
+// Forward declarations
+namespace rf
+{
+    struct Player;
+}
+
+void match_log_level_start();
+void match_log_level_end();
+void match_log_kill(rf::Player* killed_player, rf::Player* killer_player);
+void match_log_damage(rf::Player* attacker, rf::Player* target, float damage, int damage_type);
+void match_log_player_join(rf::Player* player);
+void match_log_player_leave(rf::Player* player);
+void match_log_vote_start(std::string_view title, rf::Player* owner);
+void match_log_vote_end(std::string_view title, std::string_view result);
+void match_log_cheat_flag(rf::Player* player, std::string_view detector, float value, float threshold);
+void match_log_do_frame();
+void match_log_shutdown();
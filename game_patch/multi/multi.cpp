@@ -8,6 +8,9 @@
 #include <patch_common/AsmWriter.h>
 #include "multi.h"
 #include "multi_private.h"
+#include "net_rate_limit.h"
+#include "net_telemetry.h"
+#include "cheat_detection.h"
 #include "server_internal.h"
 #include "../misc/misc.h"
 #include "../rf/os/os.h"
@@ -326,6 +329,7 @@ FunHook<void(rf::Entity*, int, rf::Vector3&, rf::Matrix3&, bool)> multi_process_
             if (!multi_is_weapon_fire_allowed_server_side(ep, weapon_type, alt_fire)) {
                 return;
             }
+            cheat_detection_on_weapon_fire(rf::player_from_entity_handle(ep->handle), weapon_type, alt_fire);
         }
         multi_process_remote_weapon_fire_hook.call_target(ep, weapon_type, pos, orient, alt_fire);
     },
@@ -382,6 +386,12 @@ void multi_do_patch()
     multi_kill_do_patch();
     level_download_do_patch();
     network_init();
+    server_browser_apply_patch();
+    packet_capture_apply_patch();
+    net_sim_apply_patch();
+    net_telemetry_init();
+    net_rate_limit_init();
+    cheat_detection_init();
     multi_tdm_apply_patch();
 
     level_download_init();
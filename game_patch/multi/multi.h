@@ -79,6 +79,9 @@ struct DashFactionServerInfo
     uint8_t version_minor = 0;
     bool saving_enabled = false;
     std::optional<float> max_fov;
+    bool obj_update_delta = false;
+    bool state_snapshot = false;
+    bool reliable_transport = false;
 };
 
 void multi_level_download_update();
@@ -88,8 +91,20 @@ void multi_init_player(rf::Player* player);
 void send_chat_line_packet(const char* msg, rf::Player* target, rf::Player* sender = nullptr, bool is_team_msg = false);
 const std::optional<DashFactionServerInfo>& get_df_server_info();
 void multi_level_download_do_frame();
+void multi_packet_replay_do_frame();
+void multi_net_sim_do_frame();
+void multi_obj_update_delta_do_frame();
+void multi_state_snapshot_do_frame();
+void multi_reliable_transport_do_frame();
+void multi_io_flush_coalesced_packets();
+void multi_server_browser_do_frame();
 void multi_level_download_abort();
 void multi_ban_apply_patch();
 std::optional<std::string> multi_ban_unban_last();
+bool multi_ban_unban(const std::string& range);
+bool multi_ban_add_range(const std::string& range, int minutes);
+std::optional<std::size_t> multi_ban_reload();
+int multi_ban_import(const std::string& filename);
+void multi_ban_do_frame();
 std::string_view multi_game_type_name(rf::NetGameType game_type);
 [[nodiscard]] int multi_num_alive_players();
@@ -1,15 +1,25 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <optional>
 #include <vector>
 #include <fstream>
+#include <filesystem>
 #include <charconv>
 #include <sstream>
+#include <ctime>
 #include <winsock2.h>
 #include <xlog/xlog.h>
 #include <patch_common/FunHook.h>
 
 #include "../rf/multi.h"
+#include "../rf/os/timer.h"
 #include "multi.h"
 
 constexpr unsigned FULL_MASK = 0xFFFFFFFF;
+constexpr const char* banlist_filename = "banlist.txt";
+// How often banlist file modification time is checked for automatic reload
+constexpr int banlist_reload_check_interval_ms = 5000;
 
 class IpRange
 {
@@ -24,14 +34,25 @@ public:
 
     bool operator==(const IpRange& other) const = default;
 
-    bool matches(unsigned ip)
+    bool matches(unsigned ip) const
     {
         return (ip & mask_) == ip_;
     }
 
+    [[nodiscard]] unsigned ip() const
+    {
+        return ip_;
+    }
+
+    [[nodiscard]] unsigned prefix_len() const
+    {
+        // Parser only creates contiguous masks
+        return std::popcount(mask_);
+    }
+
     static IpRange parse(const std::string& s);
 
-    std::string to_string()
+    std::string to_string() const
     {
         std::ostringstream ss;
         unsigned zeros = 0;
@@ -112,47 +133,274 @@ IpRange IpRange::parse(const std::string& s)
     return IpRange{ip, mask};
 }
 
+static unsigned prefix_mask(unsigned len)
+{
+    return len == 0 ? 0 : FULL_MASK << (32 - len);
+}
+
+static int prefix_bit(unsigned ip, unsigned index)
+{
+    return (ip >> (31 - index)) & 1;
+}
+
+static unsigned common_prefix_len(unsigned a, unsigned b, unsigned max_len)
+{
+    unsigned len = std::countl_zero(a ^ b);
+    return std::min(len, max_len);
+}
+
+// Path-compressed binary trie of IP ranges. Lookup visits at most 32 nodes no matter how many ranges are stored,
+// so big imported blocklists do not slow down joining.
+class IpRangeTrie
+{
+    struct Node
+    {
+        unsigned prefix = 0;
+        unsigned prefix_len = 0;
+        bool terminal = false;
+        // Unix time when the ban expires or 0 if it is permanent
+        int64_t expires = 0;
+        // Children prefixes are longer than parent prefix and differ by the bit following parent prefix
+        std::array<int, 2> children{-1, -1};
+    };
+
+    // Nodes are referenced by index. Node 0 is the root (empty prefix).
+    std::vector<Node> nodes_;
+
+    int add_node(unsigned prefix, unsigned prefix_len, bool terminal, int64_t expires)
+    {
+        nodes_.push_back(Node{prefix, prefix_len, terminal, expires});
+        return static_cast<int>(nodes_.size() - 1);
+    }
+
+    [[nodiscard]] int find(unsigned prefix, unsigned prefix_len) const
+    {
+        int idx = 0;
+        while (idx >= 0) {
+            const Node& node = nodes_[idx];
+            if (node.prefix_len > prefix_len || (prefix & prefix_mask(node.prefix_len)) != node.prefix) {
+                return -1;
+            }
+            if (node.prefix_len == prefix_len) {
+                return idx;
+            }
+            idx = node.children[prefix_bit(prefix, node.prefix_len)];
+        }
+        return -1;
+    }
+
+public:
+    IpRangeTrie()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        nodes_.clear();
+        nodes_.emplace_back();
+    }
+
+    // Returns false if the range was already present (only expiration time is updated in that case)
+    bool insert(const IpRange& range, int64_t expires)
+    {
+        unsigned prefix = range.ip();
+        unsigned len = range.prefix_len();
+        int idx = 0;
+        while (true) {
+            if (nodes_[idx].prefix_len == len) {
+                bool inserted = !nodes_[idx].terminal;
+                nodes_[idx].terminal = true;
+                nodes_[idx].expires = expires;
+                return inserted;
+            }
+            int b = prefix_bit(prefix, nodes_[idx].prefix_len);
+            int child = nodes_[idx].children[b];
+            if (child < 0) {
+                int leaf = add_node(prefix, len, true, expires);
+                nodes_[idx].children[b] = leaf;
+                return true;
+            }
+            unsigned child_prefix = nodes_[child].prefix;
+            unsigned child_len = nodes_[child].prefix_len;
+            unsigned common = common_prefix_len(prefix, child_prefix, std::min(len, child_len));
+            if (common == child_len) {
+                idx = child;
+                continue;
+            }
+            if (common == len) {
+                // New range contains the child range
+                int node = add_node(prefix, len, true, expires);
+                nodes_[node].children[prefix_bit(child_prefix, len)] = child;
+                nodes_[idx].children[b] = node;
+                return true;
+            }
+            // Ranges diverge so split the edge
+            int split = add_node(prefix & prefix_mask(common), common, false, 0);
+            int leaf = add_node(prefix, len, true, expires);
+            nodes_[split].children[prefix_bit(prefix, common)] = leaf;
+            nodes_[split].children[prefix_bit(child_prefix, common)] = child;
+            nodes_[idx].children[b] = split;
+            return true;
+        }
+    }
+
+    bool remove(const IpRange& range)
+    {
+        // Node is kept as an inner node. Unused nodes are dropped when banlist is reloaded.
+        int idx = find(range.ip(), range.prefix_len());
+        if (idx < 0 || !nodes_[idx].terminal) {
+            return false;
+        }
+        nodes_[idx].terminal = false;
+        return true;
+    }
+
+    [[nodiscard]] bool matches(unsigned ip, int64_t now) const
+    {
+        int idx = 0;
+        while (idx >= 0) {
+            const Node& node = nodes_[idx];
+            if ((ip & prefix_mask(node.prefix_len)) != node.prefix) {
+                return false;
+            }
+            if (node.terminal && (node.expires == 0 || node.expires > now)) {
+                return true;
+            }
+            if (node.prefix_len == 32) {
+                break;
+            }
+            idx = node.children[prefix_bit(ip, node.prefix_len)];
+        }
+        return false;
+    }
+};
+
+struct BanEntry
+{
+    IpRange range;
+    // Unix time when the ban expires or 0 if it is permanent
+    int64_t expires = 0;
+};
+
+// Parses banlist line in format: <ip range> [expiration unix time]
+// Anything else following the range is ignored so public blocklists with comments (e.g. "1.2.3.0/24 ; SBL123") can
+// be imported directly
+static std::optional<BanEntry> parse_ban_entry(std::string_view line)
+{
+    auto range_end = line.find_first_of(" \t;#");
+    std::string range_str{line.substr(0, range_end)};
+    try {
+        BanEntry entry{IpRange::parse(range_str)};
+        if (range_end != std::string_view::npos) {
+            auto rest = line.substr(range_end);
+            auto expires_pos = rest.find_first_not_of(" \t");
+            if (expires_pos != std::string_view::npos) {
+                std::from_chars(rest.data() + expires_pos, rest.data() + rest.size(), entry.expires);
+            }
+        }
+        return {entry};
+    }
+    catch (const std::exception& e) {
+        return {};
+    }
+}
+
+static bool is_banlist_comment(std::string_view line)
+{
+    auto pos = line.find_first_not_of(" \t\r");
+    return pos == std::string_view::npos || line[pos] == '#' || line[pos] == ';' || line.substr(pos).starts_with("//");
+}
+
 class Banlist
 {
-    std::vector<IpRange> ip_ranges_;
+    // Entries in the order they were added (used for saving and unban_last)
+    std::vector<BanEntry> entries_;
+    IpRangeTrie trie_;
+
+    void add_entry(const BanEntry& entry)
+    {
+        if (trie_.insert(entry.range, entry.expires)) {
+            entries_.push_back(entry);
+        }
+        else {
+            // Range is already banned - only update expiration time
+            auto it = std::find_if(entries_.begin(), entries_.end(), [&](const BanEntry& e) {
+                return e.range == entry.range;
+            });
+            if (it != entries_.end()) {
+                it->expires = entry.expires;
+            }
+        }
+    }
 
 public:
-    void load()
+    // Returns number of added entries or -1 if file cannot be opened
+    int import(const std::string& filename)
     {
-        std::ifstream f("banlist.txt");
+        std::ifstream f(filename);
+        if (!f) {
+            return -1;
+        }
+        int count = 0;
         std::string line;
         while (std::getline(f, line)) {
             // Ignore empty lines and comments
-            if (line.empty() || line.starts_with('#') || line.starts_with("//")) {
+            if (is_banlist_comment(line)) {
+                continue;
+            }
+            auto entry = parse_ban_entry(line);
+            if (!entry) {
+                xlog::error("Failed to parse banlist entry: {}", line);
                 continue;
             }
-            add(line);
+            add_entry(entry.value());
+            ++count;
         }
+        return count;
     }
 
-    void save()
+    bool load()
     {
-        std::ofstream f("banlist.txt");
-        for (auto& r : ip_ranges_) {
-            f << r.to_string() << '\n';
-        }
+        return import(banlist_filename) >= 0;
     }
 
-    bool is_banned(unsigned ip)
+    void save() const
     {
-        for (auto& r : ip_ranges_) {
-            if (r.matches(ip)) {
-                return true;
+        // Write a temporary file first so the banlist is never left half-written
+        std::string tmp_filename = std::string{banlist_filename} + ".tmp";
+        {
+            std::ofstream f(tmp_filename);
+            int64_t now = std::time(nullptr);
+            for (auto& entry : entries_) {
+                if (entry.expires == 0) {
+                    f << entry.range.to_string() << '\n';
+                }
+                else if (entry.expires > now) {
+                    f << entry.range.to_string() << ' ' << entry.expires << '\n';
+                }
+            }
+            if (!f) {
+                xlog::error("Failed to write {}", tmp_filename);
+                return;
             }
         }
-        return false;
+        std::error_code ec;
+        std::filesystem::rename(tmp_filename, banlist_filename, ec);
+        if (ec) {
+            xlog::error("Failed to replace {}: {}", banlist_filename, ec.message());
+        }
+    }
+
+    bool is_banned(unsigned ip) const
+    {
+        return trie_.matches(ip, std::time(nullptr));
     }
 
-    bool add(const std::string& s)
+    bool add(const std::string& s, int64_t expires = 0)
     {
         try {
-            IpRange r = IpRange::parse(s);
-            ip_ranges_.push_back(r);
+            add_entry({IpRange::parse(s), expires});
             return true;
         } catch (const std::exception& e) {
             xlog::error("Failed to parse banlist entry: {}", s);
@@ -162,19 +410,32 @@ public:
 
     void add(unsigned ip)
     {
-        ip_ranges_.push_back(IpRange{ip});
+        add_entry({IpRange{ip}});
+    }
+
+    bool remove(const IpRange& range)
+    {
+        auto num_erased = std::erase_if(entries_, [&](const BanEntry& e) { return e.range == range; });
+        trie_.remove(range);
+        return num_erased > 0;
     }
 
     std::optional<IpRange> unban_last()
     {
-        if (ip_ranges_.empty()) {
+        if (entries_.empty()) {
             return {};
         }
-        IpRange r = ip_ranges_.back();
-        ip_ranges_.pop_back();
+        IpRange r = entries_.back().range;
+        entries_.pop_back();
+        trie_.remove(r);
         return {r};
     }
 
+    [[nodiscard]] std::size_t size() const
+    {
+        return entries_.size();
+    }
+
     static Banlist& instance()
     {
         static Banlist instance;
@@ -182,10 +443,28 @@ public:
     }
 };
 
+static std::filesystem::file_time_type g_banlist_mtime;
+static int g_banlist_next_reload_check_ms = 0;
+
+static std::filesystem::file_time_type get_banlist_mtime()
+{
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(banlist_filename, ec);
+    return ec ? std::filesystem::file_time_type{} : mtime;
+}
+
+static void save_banlist()
+{
+    Banlist::instance().save();
+    // Do not reload the file that was just written
+    g_banlist_mtime = get_banlist_mtime();
+}
+
 FunHook multi_ban_init_hook{
     0x0046D2C0,
     []() {
         Banlist::instance().load();
+        g_banlist_mtime = get_banlist_mtime();
     },
 };
 
@@ -218,7 +497,7 @@ FunHook multi_ban_add_hook{
     0x0046D070,
     [](const char* s) {
         if (Banlist::instance().add(s)) {
-            Banlist::instance().save();
+            save_banlist();
         }
     },
 };
@@ -227,7 +506,7 @@ FunHook multi_ban_add2_hook{
     0x0046D0F0,
     [](const rf::NetAddr& addr) {
         Banlist::instance().add(addr.ip_addr);
-        Banlist::instance().save();
+        save_banlist();
     },
 };
 
@@ -235,12 +514,74 @@ std::optional<std::string> multi_ban_unban_last()
 {
     auto opt = Banlist::instance().unban_last();
     if (opt) {
-        Banlist::instance().save();
+        save_banlist();
         return {opt.value().to_string()};
     }
     return {};
 }
 
+bool multi_ban_unban(const std::string& range)
+{
+    try {
+        if (!Banlist::instance().remove(IpRange::parse(range))) {
+            return false;
+        }
+    }
+    catch (const std::exception& e) {
+        return false;
+    }
+    save_banlist();
+    return true;
+}
+
+bool multi_ban_add_range(const std::string& range, int minutes)
+{
+    int64_t expires = minutes > 0 ? std::time(nullptr) + static_cast<int64_t>(minutes) * 60 : 0;
+    if (!Banlist::instance().add(range, expires)) {
+        return false;
+    }
+    save_banlist();
+    return true;
+}
+
+std::optional<std::size_t> multi_ban_reload()
+{
+    // Load into a separate list and swap it in only when the whole file was read
+    Banlist banlist;
+    if (!banlist.load()) {
+        return {};
+    }
+    std::size_t size = banlist.size();
+    Banlist::instance() = std::move(banlist);
+    g_banlist_mtime = get_banlist_mtime();
+    return {size};
+}
+
+int multi_ban_import(const std::string& filename)
+{
+    int count = Banlist::instance().import(filename);
+    if (count > 0) {
+        save_banlist();
+    }
+    return count;
+}
+
+void multi_ban_do_frame()
+{
+    int now = rf::timer_get(1000);
+    if (now < g_banlist_next_reload_check_ms) {
+        return;
+    }
+    g_banlist_next_reload_check_ms = now + banlist_reload_check_interval_ms;
+    auto mtime = get_banlist_mtime();
+    if (mtime != g_banlist_mtime && mtime != std::filesystem::file_time_type{}) {
+        auto size = multi_ban_reload();
+        if (size) {
+            xlog::info("Banlist reloaded ({} entries)", size.value());
+        }
+    }
+}
+
 #ifndef NDEBUG
 
 #define ok(expr) if (!(expr)) xlog::error("Test failed: {}", #expr)
@@ -257,6 +598,23 @@ static void test_parsing()
         ok(IpRange::parse("192.168.17.*").to_string() == "192.168.17.*");
         ok(IpRange::parse("192.168.*.*").to_string() == "192.168.*.*");
         ok(IpRange::parse("192.168.17.17/28").to_string() == "192.168.17.16/28"); // normalized
+        ok(parse_ban_entry("10.0.0.0/8 1700000000").value().expires == 1700000000);
+        ok(parse_ban_entry("1.10.16.0/20 ; SBL256894").value().range == IpRange(0x010A1000, 0xFFFFF000));
+
+        IpRangeTrie trie;
+        trie.insert(IpRange::parse("192.168.17.*"), 0);
+        trie.insert(IpRange::parse("192.168.18.3"), 0);
+        trie.insert(IpRange::parse("10.0.0.0/8"), 100);
+        ok(trie.matches(0xC0A81103, 0));
+        ok(trie.matches(0xC0A81203, 0));
+        ok(!trie.matches(0xC0A81204, 0));
+        ok(trie.matches(0x0A010203, 99));
+        ok(!trie.matches(0x0A010203, 100)); // expired
+        trie.insert(IpRange::parse("192.168.*"), 0);
+        ok(trie.matches(0xC0A81204, 0));
+        trie.remove(IpRange::parse("192.168.*"));
+        ok(!trie.matches(0xC0A81204, 0));
+        ok(trie.matches(0xC0A81103, 0));
     } catch (const std::exception& e) {
         xlog::error("banlist test failed: {}", e.what());
     }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <vector>
+
 void multi_kill_do_patch();
 void multi_kill_init_player(rf::Player* player);
 
@@ -9,5 +12,32 @@ void level_download_do_patch();
 void level_download_init();
 
 void network_init();
+void server_browser_apply_patch();
+void server_browser_on_game_info(const rf::NetAddr& addr);
+
+extern bool g_processing_unreliable_packets;
+void multi_io_process_decoded_packets(const void* data, size_t len, const rf::NetAddr& addr, rf::Player* player,
+    bool reliable);
+void packet_capture_apply_patch();
+bool packet_replay_is_active();
+bool packet_replay_is_sink_addr(const rf::NetAddr& addr);
+void net_sim_apply_patch();
+bool net_sim_delay_incoming(const void* data, size_t len, const rf::NetAddr& addr);
+void process_unreliable_game_packets(const void* data, size_t len, const rf::NetAddr& addr, rf::Player* player);
+
+void obj_update_delta_on_join_accept();
+bool obj_update_delta_encode(rf::Player* player, const void* data, int len, std::vector<std::byte>& buf);
+bool obj_update_delta_process_packet(const void* data, int len, const rf::NetAddr& addr, rf::Player* player);
+
+void state_snapshot_on_join_accept();
+void state_snapshot_on_state_info_request(rf::Player* player);
+void state_snapshot_on_state_info_done();
+bool state_snapshot_capture_reliable(rf::Player* player, const void* data, int len, int not_limbo);
+bool state_snapshot_process_packet(const void* data, int len, const rf::NetAddr& addr, rf::Player* player);
+
+void reliable_transport_on_join_accept();
+void reliable_transport_on_socket_ready(rf::Player* player);
+bool reliable_transport_send_buffered(rf::Player* player);
+bool reliable_transport_process_packet(const void* data, int len, const rf::NetAddr& addr, rf::Player* player);
 
 void multi_tdm_apply_patch();
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <string>
+#include <common/rfproto.h>
+#include <xlog/xlog.h>
+#include "../rf/multi.h"
+#include "../rf/os/timer.h"
+#include "../os/console.h"
+#include "net_rate_limit.h"
+#include "server_internal.h"
+
+// Number of tracked addresses (power of two). When the table is full the least recently seen address is replaced.
+constexpr std::size_t rate_limit_table_size = 4096;
+// Number of slots checked when looking for an address
+constexpr std::size_t rate_limit_max_probes = 8;
+// Addresses not seen for this long can be replaced by other addresses
+constexpr int rate_limit_entry_ttl_ms = 10000;
+// Limit of game_info responses for all addresses together (response is bigger than request so it could be abused for
+// traffic amplification with spoofed source addresses)
+constexpr float rate_limit_game_info_total_per_second = 200.0f;
+constexpr int rate_limit_report_interval_ms = 10000;
+
+// Token bucket storing only the state - rate and burst are passed by the caller so buckets stay small
+struct RateLimitBucket
+{
+    float tokens = 0.0f;
+    int last_refill_ms = 0;
+
+    bool take(int now, float rate, float burst)
+    {
+        tokens = std::min(burst, tokens + rate * static_cast<float>(now - last_refill_ms) / 1000.0f);
+        last_refill_ms = now;
+        if (tokens < 1.0f) {
+            return false;
+        }
+        tokens -= 1.0f;
+        return true;
+    }
+
+    void reset(int now, float burst)
+    {
+        tokens = burst;
+        last_refill_ms = now;
+    }
+};
+
+struct RateLimitEntry
+{
+    unsigned ip_addr = 0;
+    int last_seen_ms = 0;
+    bool used = false;
+    RateLimitBucket packets;
+    RateLimitBucket game_info_requests;
+    RateLimitBucket join_requests;
+};
+
+enum class RateLimitCategory
+{
+    known,
+    unknown,
+    game_info_request,
+    join_request,
+    num_categories,
+};
+
+struct RateLimitCounters
+{
+    std::array<unsigned long long, static_cast<int>(RateLimitCategory::num_categories)> allowed{};
+    std::array<unsigned long long, static_cast<int>(RateLimitCategory::num_categories)> dropped{};
+    unsigned long long evictions = 0;
+};
+
+static std::array<RateLimitEntry, rate_limit_table_size> g_rate_limit_table;
+static RateLimitBucket g_game_info_total_bucket;
+static RateLimitCounters g_rate_limit_counters;
+static unsigned long long g_rate_limit_last_reported_drops = 0;
+static int g_rate_limit_last_report_ms = 0;
+
+static float rate_limit_burst(int rate)
+{
+    // Allow short bursts (e.g. retried requests) without dropping them
+    return static_cast<float>(std::max(rate * 2, 4));
+}
+
+static std::size_t rate_limit_hash(unsigned ip_addr)
+{
+    // Fibonacci hashing
+    return static_cast<std::size_t>((ip_addr * 2654435769u) >> 20) & (rate_limit_table_size - 1);
+}
+
+static RateLimitEntry& rate_limit_get_entry(unsigned ip_addr, int now)
+{
+    std::size_t start = rate_limit_hash(ip_addr);
+    RateLimitEntry* victim = nullptr;
+    for (std::size_t i = 0; i < rate_limit_max_probes; ++i) {
+        auto& entry = g_rate_limit_table[(start + i) & (rate_limit_table_size - 1)];
+        if (entry.used && entry.ip_addr == ip_addr) {
+            return entry;
+        }
+        // Prefer unused slot, otherwise replace the least recently seen address
+        if (!victim || (victim->used && (!entry.used || entry.last_seen_ms < victim->last_seen_ms))) {
+            victim = &entry;
+        }
+    }
+    if (victim->used && now - victim->last_seen_ms <= rate_limit_entry_ttl_ms) {
+        ++g_rate_limit_counters.evictions;
+    }
+    const auto& config = server_get_df_config().rate_limit;
+    *victim = RateLimitEntry{ip_addr, now, true};
+    victim->packets.reset(now, rate_limit_burst(config.packets_per_second));
+    victim->game_info_requests.reset(now, rate_limit_burst(config.game_info_requests_per_second));
+    victim->join_requests.reset(now, rate_limit_burst(config.join_requests_per_second));
+    return *victim;
+}
+
+static bool rate_limit_count(RateLimitCategory category, bool allowed)
+{
+    auto& counters = allowed ? g_rate_limit_counters.allowed : g_rate_limit_counters.dropped;
+    ++counters[static_cast<int>(category)];
+    return allowed;
+}
+
+static void rate_limit_report(int now)
+{
+    if (now - g_rate_limit_last_report_ms < rate_limit_report_interval_ms) {
+        return;
+    }
+    g_rate_limit_last_report_ms = now;
+    unsigned long long total_drops = 0;
+    for (auto n : g_rate_limit_counters.dropped) {
+        total_drops += n;
+    }
+    if (total_drops > g_rate_limit_last_reported_drops) {
+        xlog::info("Rate limiter dropped {} datagrams in the last {} seconds", total_drops - g_rate_limit_last_reported_drops,
+            rate_limit_report_interval_ms / 1000);
+        g_rate_limit_last_reported_drops = total_drops;
+    }
+}
+
+bool net_rate_limit_allow_datagram(const void* data, std::size_t len, const rf::NetAddr& addr, rf::Player* player)
+{
+    const auto& config = server_get_df_config().rate_limit;
+    if (!rf::is_server || !config.enabled || len == 0) {
+        return true;
+    }
+    int now = rf::timer_get(1000);
+    rate_limit_report(now);
+    auto& entry = rate_limit_get_entry(addr.ip_addr, now);
+    entry.last_seen_ms = now;
+
+    // Only the type of the first packet is checked - requests sent by unconnected clients are not merged with
+    // other packets
+    auto packet_type = *static_cast<const uint8_t*>(data);
+    if (packet_type == RF_GPT_GAME_INFO_REQUEST) {
+        bool allowed = entry.game_info_requests.take(now, static_cast<float>(config.game_info_requests_per_second),
+            rate_limit_burst(config.game_info_requests_per_second));
+        allowed = allowed && g_game_info_total_bucket.take(now, rate_limit_game_info_total_per_second,
+            rate_limit_game_info_total_per_second);
+        return rate_limit_count(RateLimitCategory::game_info_request, allowed);
+    }
+    if (packet_type == RF_GPT_JOIN_REQUEST && !player) {
+        bool allowed = entry.join_requests.take(now, static_cast<float>(config.join_requests_per_second),
+            rate_limit_burst(config.join_requests_per_second));
+        return rate_limit_count(RateLimitCategory::join_request, allowed);
+    }
+    if (!player) {
+        // Addresses that did not join only send a few packets (e.g. tracker and ping packets)
+        bool allowed = entry.packets.take(now, static_cast<float>(config.unknown_packets_per_second),
+            rate_limit_burst(config.unknown_packets_per_second));
+        return rate_limit_count(RateLimitCategory::unknown, allowed);
+    }
+    // Players behind the same NAT share the bucket so the limit is generous
+    bool allowed = entry.packets.take(now, static_cast<float>(config.packets_per_second),
+        rate_limit_burst(config.packets_per_second));
+    return rate_limit_count(RateLimitCategory::known, allowed);
+}
+
+ConsoleCommand2 net_rate_limit_cmd{
+    "net_rate_limit",
+    [](std::optional<std::string> action) {
+        if (action == "reset") {
+            g_rate_limit_counters = {};
+            g_rate_limit_last_reported_drops = 0;
+            rf::console::print("Rate limiter counters cleared");
+            return;
+        }
+        if (!server_get_df_config().rate_limit.enabled) {
+            rf::console::print("Rate limiter is disabled");
+        }
+        static constexpr std::array<const char*, static_cast<int>(RateLimitCategory::num_categories)> names{
+            "players", "unknown addresses", "game_info requests", "join requests",
+        };
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            rf::console::print("{}: {} allowed, {} dropped", names[i], g_rate_limit_counters.allowed[i],
+                g_rate_limit_counters.dropped[i]);
+        }
+        int now = rf::timer_get(1000);
+        auto num_tracked = std::count_if(g_rate_limit_table.begin(), g_rate_limit_table.end(), [=](const auto& e) {
+            return e.used && now - e.last_seen_ms <= rate_limit_entry_ttl_ms;
+        });
+        rf::console::print("Tracked addresses: {}/{}, evictions: {}", num_tracked, rate_limit_table_size,
+            g_rate_limit_counters.evictions);
+    },
+    "Prints statistics of the per-address packet rate limiter",
+    "net_rate_limit [reset]",
+};
+
+void net_rate_limit_init()
+{
+    net_rate_limit_cmd.register_cmd();
+}
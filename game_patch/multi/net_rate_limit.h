@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+// Forward declarations
+namespace rf
+{
+    struct NetAddr;
+    struct Player;
+}
+
+bool net_rate_limit_allow_datagram(const void* data, std::size_t len, const rf::NetAddr& addr, rf::Player* player);
+void net_rate_limit_init();
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+#include <common/net/NetConditionSim.h>
+#include <patch_common/FunHook.h>
+#include "../rf/multi.h"
+#include "../rf/os/timer.h"
+#include "../os/console.h"
+#include "multi.h"
+#include "multi_private.h"
+
+// Simulation of bad network conditions for testing netcode. Unreliable datagrams received from the network and all
+// datagrams sent by rf::net_send can be delayed, dropped, duplicated and reordered. Reliable packets received by
+// the stock reliable layer are affected only indirectly (through their datagrams sent by the other side).
+
+struct NetSimDatagram
+{
+    int deliver_ms;
+    unsigned order;
+    rf::NetAddr addr;
+    std::vector<std::byte> data;
+};
+
+struct NetSimDirection
+{
+    const char* name;
+    NetConditionSim sim;
+    std::vector<NetSimDatagram> queue;
+};
+
+static NetSimDirection g_net_sim_in{"in", NetConditionSim{1}};
+static NetSimDirection g_net_sim_out{"out", NetConditionSim{2}};
+static unsigned g_net_sim_order = 0;
+
+static bool net_sim_delay(NetSimDirection& dir, const void* data, size_t len, const rf::NetAddr& addr)
+{
+    if (!dir.sim.conditions().active()) {
+        return false;
+    }
+    std::array<int, 2> deliver_ms;
+    int count = dir.sim.schedule(len, rf::timer_get(1000), deliver_ms);
+    auto bytes = static_cast<const std::byte*>(data);
+    for (int i = 0; i < count; ++i) {
+        dir.queue.push_back({deliver_ms[i], g_net_sim_order++, addr, {bytes, bytes + len}});
+    }
+    return true;
+}
+
+static std::vector<NetSimDatagram> net_sim_take_due(NetSimDirection& dir, int now_ms)
+{
+    auto it = std::partition(dir.queue.begin(), dir.queue.end(), [=](const NetSimDatagram& d) {
+        return d.deliver_ms - now_ms > 0;
+    });
+    std::vector<NetSimDatagram> due{std::make_move_iterator(it), std::make_move_iterator(dir.queue.end())};
+    dir.queue.erase(it, dir.queue.end());
+    std::sort(due.begin(), due.end(), [](const NetSimDatagram& a, const NetSimDatagram& b) {
+        return a.deliver_ms != b.deliver_ms ? a.deliver_ms - b.deliver_ms < 0 : a.order < b.order;
+    });
+    return due;
+}
+
+bool net_sim_delay_incoming(const void* data, size_t len, const rf::NetAddr& addr)
+{
+    return net_sim_delay(g_net_sim_in, data, len, addr);
+}
+
+FunHook<void(const rf::NetAddr&, const void*, int)> net_sim_send_hook{
+    0x0052A080,
+    [](const rf::NetAddr& addr, const void* data, int len) {
+        // Replies to replayed packets are never sent (see packet_capture.cpp)
+        if (packet_replay_is_sink_addr(addr)) {
+            return;
+        }
+        if (net_sim_delay(g_net_sim_out, data, static_cast<size_t>(len), addr)) {
+            return;
+        }
+        net_sim_send_hook.call_target(addr, data, len);
+    },
+};
+
+#ifndef NDEBUG
+
+static void net_sim_print_status(const NetSimDirection& dir)
+{
+    const auto& c = dir.sim.conditions();
+    const auto& stats = dir.sim.stats();
+    rf::console::print("{}: latency {} ms, jitter {} ms, loss {}%, duplicate {}%, reorder {}%, bandwidth {} KB/s",
+        dir.name, c.latency_ms, c.jitter_ms, c.loss * 100.0f, c.duplicate * 100.0f, c.reorder * 100.0f,
+        c.bytes_per_second / 1000);
+    rf::console::print("{}: {} datagrams, {} lost, {} duplicated, {} reordered, {} queued", dir.name,
+        stats.num_datagrams, stats.num_lost, stats.num_duplicated, stats.num_reordered, dir.queue.size());
+}
+
+static bool net_sim_set_option(NetSimDirection& dir, const std::string& option, float value)
+{
+    auto c = dir.sim.conditions();
+    auto probability = std::clamp(value / 100.0f, 0.0f, 1.0f);
+    if (option == "latency") {
+        c.latency_ms = std::max(static_cast<int>(value), 0);
+    }
+    else if (option == "jitter") {
+        c.jitter_ms = std::max(static_cast<int>(value), 0);
+    }
+    else if (option == "loss") {
+        c.loss = probability;
+    }
+    else if (option == "duplicate") {
+        c.duplicate = probability;
+    }
+    else if (option == "reorder") {
+        c.reorder = probability;
+    }
+    else if (option == "bandwidth") {
+        c.bytes_per_second = std::max(static_cast<int>(value * 1000.0f), 0);
+    }
+    else {
+        return false;
+    }
+    dir.sim.set_conditions(c);
+    return true;
+}
+
+ConsoleCommand2 net_sim_cmd{
+    "d_net_sim",
+    [](std::optional<std::string> direction, std::optional<std::string> option, std::optional<float> value) {
+        if (direction == "off") {
+            g_net_sim_in.sim.set_conditions({});
+            g_net_sim_out.sim.set_conditions({});
+            rf::console::print("Network condition simulation disabled");
+            return;
+        }
+        if (direction) {
+            bool in = direction == "in" || direction == "both";
+            bool out = direction == "out" || direction == "both";
+            if ((!in && !out) || !option || !value) {
+                rf::console::print("Invalid arguments");
+                return;
+            }
+            if ((in && !net_sim_set_option(g_net_sim_in, option.value(), value.value())) ||
+                (out && !net_sim_set_option(g_net_sim_out, option.value(), value.value()))) {
+                rf::console::print("Unknown option: {}", option.value());
+                return;
+            }
+        }
+        net_sim_print_status(g_net_sim_in);
+        net_sim_print_status(g_net_sim_out);
+    },
+    "Simulates bad network conditions (loss, duplicate and reorder in percent, bandwidth in KB/s)",
+    "d_net_sim [in|out|both|off] [latency|jitter|loss|duplicate|reorder|bandwidth] [value]",
+};
+
+ConsoleCommand2 net_sim_seed_cmd{
+    "d_net_sim_seed",
+    [](int seed) {
+        g_net_sim_in.sim.reset(static_cast<unsigned>(seed));
+        g_net_sim_out.sim.reset(static_cast<unsigned>(seed) + 1);
+        g_net_sim_in.queue.clear();
+        g_net_sim_out.queue.clear();
+        rf::console::print("Network condition simulation seed set to {}", seed);
+    },
+    "Restarts random generator of the network condition simulation so a test can be reproduced",
+    "d_net_sim_seed <seed>",
+};
+
+#endif // NDEBUG
+
+void multi_net_sim_do_frame()
+{
+    if (g_net_sim_in.queue.empty() && g_net_sim_out.queue.empty()) {
+        return;
+    }
+    if (!rf::is_multi) {
+        g_net_sim_in.queue.clear();
+        g_net_sim_out.queue.clear();
+        return;
+    }
+    int now = rf::timer_get(1000);
+    for (const auto& d : net_sim_take_due(g_net_sim_out, now)) {
+        net_sim_send_hook.call_target(d.addr, d.data.data(), static_cast<int>(d.data.size()));
+    }
+    for (const auto& d : net_sim_take_due(g_net_sim_in, now)) {
+        // Player could have left in the meantime so find it again
+        rf::Player* player = rf::multi_find_player_by_addr(d.addr);
+        process_unreliable_game_packets(d.data.data(), d.data.size(), d.addr, player);
+    }
+}
+
+void net_sim_apply_patch()
+{
+    net_sim_send_hook.install();
+#ifndef NDEBUG
+    net_sim_cmd.register_cmd();
+    net_sim_seed_cmd.register_cmd();
+#endif
+}
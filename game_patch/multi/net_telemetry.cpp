@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <xlog/xlog.h>
+#include <common/utils/list-utils.h>
+#include <common/utils/string-utils.h>
+#include "../rf/multi.h"
+#include "../rf/player/player.h"
+#include "../os/console.h"
+#include "net_telemetry.h"
+#include "server_internal.h"
+
+// Counter of values added during the last 60 seconds with one second granularity
+class RollingCounter
+{
+public:
+    void add(unsigned value, int now_second)
+    {
+        advance(now_second);
+        slots_[now_second % num_slots] += value;
+    }
+
+    // Sum of values added in the last N completed seconds
+    [[nodiscard]] unsigned long long sum_last(int seconds, int now_second) const
+    {
+        unsigned long long sum = 0;
+        for (int second = now_second - seconds; second < now_second; ++second) {
+            // Slots newer than the last update were not cleared yet and contain values from previous minute
+            if (second >= 0 && second <= last_second_ && second > last_second_ - num_slots) {
+                sum += slots_[second % num_slots];
+            }
+        }
+        return sum;
+    }
+
+    [[nodiscard]] double rate(int seconds, int now_second) const
+    {
+        return static_cast<double>(sum_last(seconds, now_second)) / seconds;
+    }
+
+private:
+    static constexpr int num_slots = 60;
+
+    void advance(int now_second)
+    {
+        if (now_second <= last_second_) {
+            return;
+        }
+        int num_to_clear = std::min(now_second - last_second_, num_slots);
+        for (int i = 1; i <= num_to_clear; ++i) {
+            slots_[(last_second_ + i) % num_slots] = 0;
+        }
+        last_second_ = now_second;
+    }
+
+    std::array<unsigned, num_slots> slots_{};
+    int last_second_ = 0;
+};
+
+struct TrafficCounters
+{
+    unsigned long long packets = 0;
+    unsigned long long bytes = 0;
+    RollingCounter packets_rate;
+    RollingCounter bytes_rate;
+
+    void add(int size, int now_second)
+    {
+        ++packets;
+        bytes += size;
+        packets_rate.add(1, now_second);
+        bytes_rate.add(size, now_second);
+    }
+};
+
+// Packet size histogram buckets: <16, <32, <64, <128, <256, <512, >=512
+constexpr int num_size_buckets = 7;
+constexpr std::array<const char*, num_size_buckets> size_bucket_names{
+    "0-15", "16-31", "32-63", "64-127", "128-255", "256-511", "512+",
+};
+
+struct PacketTypeTelemetry
+{
+    TrafficCounters counters;
+    std::array<unsigned, num_size_buckets> size_histogram{};
+};
+
+enum TrafficDirection
+{
+    DIR_RECV = 0,
+    DIR_SEND = 1,
+    DIR_COUNT = 2,
+};
+constexpr std::array<const char*, DIR_COUNT> direction_names{"recv", "send"};
+
+static std::array<std::array<PacketTypeTelemetry, 256>, DIR_COUNT> g_packet_type_telemetry;
+// Keyed by the engine statistics object of the player connection so packets can be attributed without a player lookup
+static std::unordered_map<const rf::MultiIoStats*, std::array<TrafficCounters, DIR_COUNT>> g_player_telemetry;
+static std::chrono::steady_clock::time_point g_telemetry_start = std::chrono::steady_clock::now();
+static int g_last_dump_second = 0;
+
+static int get_telemetry_second()
+{
+    auto elapsed = std::chrono::steady_clock::now() - g_telemetry_start;
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(elapsed).count());
+}
+
+static int get_size_bucket(int size)
+{
+    int bucket = 0;
+    for (int limit = 16; bucket < num_size_buckets - 1 && size >= limit; limit *= 2) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+static std::string packet_type_name(int type)
+{
+    static const char* rf_packet_names[] = {
+        "game_info_request",
+        "game_info",
+        "join_request",
+        "join_accept",
+        "join_deny",
+        "new_player",
+        "players",
+        "left_game",
+        "end_game",
+        "state_info_request",
+        "state_info_done",
+        "client_in_game",
+        "chat_line",
+        "name_change",
+        "respawn_request",
+        "trigger_activate",
+        "use_key_pressed",
+        "pregame_boolean",
+        "pregame_glass",
+        "pregame_remote_charge",
+        "suicide",
+        "enter_limbo",
+        "leave_limbo",
+        "team_change",
+        "ping",
+        "pong",
+        "netgame_update",
+        "rate_change",
+        "select_weapon",
+        "clutter_update",
+        "clutter_kill",
+        "ctf_flag_picked_up",
+        "ctf_flag_captured",
+        "ctf_flag_update",
+        "ctf_flag_returned",
+        "ctf_flag_droped",
+        "remote_charge_kill",
+        "item_update",
+        "object_update",
+        "object_kill",
+        "item_apply",
+        "boolean",
+        "mover_update",
+        "respawn",
+        "entity_create",
+        "item_create",
+        "reload",
+        "reload_request",
+        "weapon_fire",
+        "fall_damage",
+        "rcon_request",
+        "rcon",
+        "sound",
+        "team_scores",
+        "glass_kill",
+    };
+    if (type >= 0 && type < static_cast<int>(std::size(rf_packet_names))) {
+        return rf_packet_names[type];
+    }
+    return std::format("custom_{:02x}", type);
+}
+
+void net_telemetry_record(const rf::MultiIoStats* io_stats, int packet_type, int size, bool is_send)
+{
+    int now = get_telemetry_second();
+    int dir = is_send ? DIR_SEND : DIR_RECV;
+    auto& type_telemetry = g_packet_type_telemetry[dir][packet_type & 0xFF];
+    type_telemetry.counters.add(size, now);
+    ++type_telemetry.size_histogram[get_size_bucket(size)];
+    if (io_stats) {
+        g_player_telemetry[io_stats][dir].add(size, now);
+    }
+}
+
+static const std::array<TrafficCounters, DIR_COUNT>* find_player_telemetry(const rf::Player& player)
+{
+    if (!player.net_data) {
+        return nullptr;
+    }
+    auto it = g_player_telemetry.find(&player.net_data->stats);
+    return it != g_player_telemetry.end() ? &it->second : nullptr;
+}
+
+void net_telemetry_on_player_destroy(rf::Player* player)
+{
+    if (player->net_data) {
+        g_player_telemetry.erase(&player->net_data->stats);
+    }
+}
+
+static void net_telemetry_reset()
+{
+    for (auto& dir_telemetry : g_packet_type_telemetry) {
+        std::fill(dir_telemetry.begin(), dir_telemetry.end(), PacketTypeTelemetry{});
+    }
+    g_player_telemetry.clear();
+}
+
+static void net_telemetry_print()
+{
+    int now = get_telemetry_second();
+    for (int dir = 0; dir < DIR_COUNT; ++dir) {
+        // Sort by bandwidth in the last 10 seconds so saturating packet types come first
+        std::vector<int> types;
+        for (int type = 0; type < 256; ++type) {
+            if (g_packet_type_telemetry[dir][type].counters.packets > 0) {
+                types.push_back(type);
+            }
+        }
+        std::ranges::sort(types, [&](int a, int b) {
+            return g_packet_type_telemetry[dir][a].counters.bytes_rate.sum_last(10, now) >
+                g_packet_type_telemetry[dir][b].counters.bytes_rate.sum_last(10, now);
+        });
+        rf::console::print("Packets {} (B/s in last 1s/10s/60s):", direction_names[dir]);
+        for (int type : types) {
+            const auto& counters = g_packet_type_telemetry[dir][type].counters;
+            rf::console::print("  {:02x} {}: {} packets, {} bytes, {:.0f}/{:.0f}/{:.0f} B/s, avg {:.1f} B",
+                type, packet_type_name(type), counters.packets, counters.bytes,
+                counters.bytes_rate.rate(1, now), counters.bytes_rate.rate(10, now), counters.bytes_rate.rate(60, now),
+                static_cast<double>(counters.bytes) / counters.packets);
+        }
+    }
+    rf::console::print("Players (recv/send B/s in last 10s):");
+    for (auto& player : SinglyLinkedList{rf::player_list}) {
+        const auto* counters_ptr = find_player_telemetry(player);
+        if (counters_ptr) {
+            const auto& counters = *counters_ptr;
+            rf::console::print("  {}: {:.0f}/{:.0f} B/s, {:.1f}/{:.1f} packets/s", player.name.c_str(),
+                counters[DIR_RECV].bytes_rate.rate(10, now), counters[DIR_SEND].bytes_rate.rate(10, now),
+                counters[DIR_RECV].packets_rate.rate(10, now), counters[DIR_SEND].packets_rate.rate(10, now));
+        }
+    }
+}
+
+// Full file is renamed so a long running server keeps at most two files of this size
+constexpr std::uintmax_t net_stats_csv_max_size = 10 * 1024 * 1024;
+
+static void rotate_csv_file(const char* filename)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(filename, ec);
+    if (ec || size < net_stats_csv_max_size) {
+        return;
+    }
+    std::string old_filename = std::string{filename} + ".old";
+    std::filesystem::remove(old_filename, ec);
+    std::filesystem::rename(filename, old_filename, ec);
+    if (ec) {
+        xlog::warn("Cannot rename {}: {}", filename, ec.message());
+    }
+}
+
+static void net_telemetry_dump_csv(const char* filename, std::time_t timestamp, int now)
+{
+    rotate_csv_file(filename);
+    bool write_header = !std::filesystem::exists(filename);
+    std::ofstream file{filename, std::ios_base::out | std::ios_base::app};
+    if (!file) {
+        xlog::error("Cannot open {}", filename);
+        return;
+    }
+    if (write_header) {
+        file << "time,direction,type,name,packets,bytes,bps_1s,bps_10s,bps_60s,pps_10s\n";
+    }
+    for (int dir = 0; dir < DIR_COUNT; ++dir) {
+        for (int type = 0; type < 256; ++type) {
+            const auto& counters = g_packet_type_telemetry[dir][type].counters;
+            if (counters.packets > 0) {
+                file << std::format("{},{},{},{},{},{},{:.1f},{:.1f},{:.1f},{:.1f}\n", timestamp, direction_names[dir],
+                    type, packet_type_name(type), counters.packets, counters.bytes, counters.bytes_rate.rate(1, now),
+                    counters.bytes_rate.rate(10, now), counters.bytes_rate.rate(60, now),
+                    counters.packets_rate.rate(10, now));
+            }
+        }
+    }
+}
+
+static void net_telemetry_dump_json(const char* filename, std::time_t timestamp, int now)
+{
+    auto format_counters = [now](const TrafficCounters& counters) {
+        return std::format(
+            R"("packets": {}, "bytes": {}, "bps_1s": {:.1f}, "bps_10s": {:.1f}, "bps_60s": {:.1f}, "pps_10s": {:.1f})",
+            counters.packets, counters.bytes, counters.bytes_rate.rate(1, now), counters.bytes_rate.rate(10, now),
+            counters.bytes_rate.rate(60, now), counters.packets_rate.rate(10, now));
+    };
+
+    std::string json = std::format("{{\n  \"time\": {},\n  \"packet_types\": [", timestamp);
+    bool first = true;
+    for (int dir = 0; dir < DIR_COUNT; ++dir) {
+        for (int type = 0; type < 256; ++type) {
+            const auto& type_telemetry = g_packet_type_telemetry[dir][type];
+            if (type_telemetry.counters.packets == 0) {
+                continue;
+            }
+            std::string histogram;
+            for (int i = 0; i < num_size_buckets; ++i) {
+                histogram += std::format("{}\"{}\": {}", i > 0 ? ", " : "", size_bucket_names[i],
+                    type_telemetry.size_histogram[i]);
+            }
+            json += std::format("{}\n    {{\"direction\": \"{}\", \"type\": {}, \"name\": \"{}\", {}, \"sizes\": {{{}}}}}",
+                first ? "" : ",", direction_names[dir], type, packet_type_name(type),
+                format_counters(type_telemetry.counters), histogram);
+            first = false;
+        }
+    }
+    json += "\n  ],\n  \"players\": [";
+    first = true;
+    for (auto& player : SinglyLinkedList{rf::player_list}) {
+        const auto* counters = find_player_telemetry(player);
+        if (!counters) {
+            continue;
+        }
+        json += std::format("{}\n    {{\"name\": \"{}\", \"recv\": {{{}}}, \"send\": {{{}}}}}", first ? "" : ",",
+            json_escape(player.name.c_str()), format_counters((*counters)[DIR_RECV]),
+            format_counters((*counters)[DIR_SEND]));
+        first = false;
+    }
+    json += "\n  ]\n}\n";
+
+    std::ofstream file{filename, std::ios_base::out | std::ios_base::trunc};
+    if (!file) {
+        xlog::error("Cannot open {}", filename);
+        return;
+    }
+    file << json;
+}
+
+static void net_telemetry_dump()
+{
+    std::time_t timestamp = std::time(nullptr);
+    int now = get_telemetry_second();
+    net_telemetry_dump_csv("logs/net_stats.csv", timestamp, now);
+    net_telemetry_dump_json("logs/net_stats.json", timestamp, now);
+}
+
+void net_telemetry_do_frame()
+{
+    int interval = server_get_df_config().net_stats_dump_interval_s;
+    if (!rf::is_dedicated_server || interval <= 0) {
+        return;
+    }
+    int now = get_telemetry_second();
+    if (now - g_last_dump_second >= interval) {
+        g_last_dump_second = now;
+        net_telemetry_dump();
+    }
+}
+
+ConsoleCommand2 net_stats_cmd{
+    "net_stats",
+    [](std::optional<std::string> action) {
+        if (action == "dump") {
+            net_telemetry_dump();
+            rf::console::print("Network statistics saved to logs/net_stats.csv and logs/net_stats.json");
+        }
+        else if (action == "reset") {
+            net_telemetry_reset();
+            rf::console::print("Network statistics cleared");
+        }
+        else {
+            net_telemetry_print();
+        }
+    },
+    "Prints per packet type and per player network statistics",
+    "net_stats [dump|reset]",
+};
+
+void net_telemetry_init()
+{
+    net_stats_cmd.register_cmd();
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Forward declarations
+namespace rf
+{
+    struct Player;
+    struct MultiIoStats;
+}
+
+// io_stats is the engine statistics object of the player connection (null if traffic is not related to a player)
+void net_telemetry_record(const rf::MultiIoStats* io_stats, int packet_type, int size, bool is_send);
+void net_telemetry_on_player_destroy(rf::Player* player);
+void net_telemetry_do_frame();
+void net_telemetry_init();
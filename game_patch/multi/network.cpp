@@ -12,6 +12,7 @@
 #include <natupnp.h>
 #include <common/config/BuildConfig.h>
 #include <common/rfproto.h>
+#include <common/net/PacketCodec.h>
 #include <common/version/version.h>
 #include <common/utils/enum-bitwise-operators.h>
 #include <common/utils/list-utils.h>
@@ -25,6 +26,9 @@
 #include "multi.h"
 #include "server.h"
 #include "server_internal.h"
+#include "multi_private.h"
+#include "net_rate_limit.h"
+#include "net_telemetry.h"
 #include "../main/main.h"
 #include "../rf/multi.h"
 #include "../rf/misc.h"
@@ -284,16 +288,47 @@ CodeInjection process_game_packet_whitelist_filter{
     },
 };
 
+// Datagram being processed by the stock packet dispatcher
+static const std::byte* g_dispatched_datagram_begin = nullptr;
+static const std::byte* g_dispatched_datagram_end = nullptr;
+
+static PacketReader get_packet_payload_reader(const char* data)
+{
+    // Packet handlers receive a pointer to data following the game packet header. The dispatcher does not check
+    // the size from the header so limit it to the rest of the datagram.
+    auto payload = reinterpret_cast<const std::byte*>(data);
+    if (!g_dispatched_datagram_begin || payload < g_dispatched_datagram_begin + sizeof(RF_GamePacketHeader) ||
+        payload > g_dispatched_datagram_end) {
+        return PacketReader{data, 0};
+    }
+    RF_GamePacketHeader header;
+    std::memcpy(&header, payload - sizeof(header), sizeof(header));
+    auto max_size = static_cast<std::size_t>(g_dispatched_datagram_end - payload);
+    return PacketReader{data, std::min<std::size_t>(header.size, max_size)};
+}
+
+static bool check_packet_payload_size(const char* data, std::size_t size, const char* packet_name)
+{
+    if (get_packet_payload_reader(data).remaining() < size) {
+        xlog::warn("Ignoring malformed {} packet", packet_name);
+        return false;
+    }
+    return true;
+}
+
 FunHook<MultiIoPacketHandler> process_game_info_packet_hook{
     0x0047B2A0,
     [](char* data, const rf::NetAddr& addr) {
         process_game_info_packet_hook.call_target(data, addr);
+        server_browser_on_game_info(addr);
 
         // If this packet is from the server that we are connected to, use game_info for the netgame name
         // Useful for joining using protocol handler because when we join we do not have the server name available yet
-        const char* server_name = data + 1;
-        if (addr == rf::netgame.server_addr) {
-            rf::netgame.name = server_name;
+        auto reader = get_packet_payload_reader(data);
+        reader.skip(1);
+        auto server_name = reader.read_string(reader.remaining());
+        if (server_name && addr == rf::netgame.server_addr) {
+            rf::netgame.name = server_name.value().data();
         }
     },
 };
@@ -348,6 +383,9 @@ FunHook<MultiIoPacketHandler> process_left_game_packet_hook{
     0x0047BBC0,
     [](char* data, const rf::NetAddr& addr) {
         // server-side and client-side
+        if (!check_packet_payload_size(data, 1, "left_game")) {
+            return;
+        }
         verify_player_id_in_packet(&data[0], addr, "left_game");
         process_left_game_packet_hook.call_target(data, addr);
     },
@@ -357,6 +395,12 @@ FunHook<MultiIoPacketHandler> process_chat_line_packet_hook{
     0x00444860,
     [](char* data, const rf::NetAddr& addr) {
         // server-side and client-side
+        auto reader = get_packet_payload_reader(data);
+        reader.skip(2);
+        if (!reader.read_string(reader.remaining())) {
+            xlog::warn("Ignoring malformed chat_line packet");
+            return;
+        }
         if (rf::is_server) {
             verify_player_id_in_packet(&data[0], addr, "chat_line");
 
@@ -376,6 +420,9 @@ FunHook<MultiIoPacketHandler> process_name_change_packet_hook{
     0x0046EAE0,
     [](char* data, const rf::NetAddr& addr) {
         // server-side and client-side
+        if (!check_packet_payload_size(data, 1, "name_change")) {
+            return;
+        }
         verify_player_id_in_packet(&data[0], addr, "name_change");
         process_name_change_packet_hook.call_target(data, addr);
     },
@@ -385,6 +432,9 @@ FunHook<MultiIoPacketHandler> process_team_change_packet_hook{
     0x004825B0,
     [](char* data, const rf::NetAddr& addr) {
         // server-side and client-side
+        if (!check_packet_payload_size(data, 2, "team_change")) {
+            return;
+        }
         if (rf::is_server) {
             verify_player_id_in_packet(&data[0], addr, "team_change");
             data[1] = std::clamp(data[1], '\0', '\1'); // team validation (fixes "green team")
@@ -397,6 +447,9 @@ FunHook<MultiIoPacketHandler> process_rate_change_packet_hook{
     0x004807B0,
     [](char* data, const rf::NetAddr& addr) {
         // server-side and client-side?
+        if (!check_packet_payload_size(data, 1, "rate_change")) {
+            return;
+        }
         verify_player_id_in_packet(&data[0], addr, "rate_change");
         process_rate_change_packet_hook.call_target(data, addr);
     },
@@ -405,15 +458,22 @@ FunHook<MultiIoPacketHandler> process_rate_change_packet_hook{
 FunHook<MultiIoPacketHandler> process_entity_create_packet_hook{
     0x00475420,
     [](char* data, const rf::NetAddr& addr) {
+        auto reader = get_packet_payload_reader(data);
+        auto packet = read_entity_create_packet(reader);
+        if (!packet) {
+            xlog::warn("Ignoring malformed entity_create packet");
+            return;
+        }
         // Temporary change default player weapon to the weapon type from the received packet
         // Created entity always receives Default Player Weapon (from game.tbl) and if server has it overriden
         // player weapons would be in inconsistent state with server without this change.
-        size_t name_size = strlen(data) + 1;
-        char player_id = data[name_size + 58];
         // Check if this is not NPC
-        if (player_id != '\xFF') {
-            int weapon_type;
-            std::memcpy(&weapon_type, data + name_size + 63, sizeof(weapon_type));
+        if (packet.value().rest.player_id != 0xFF) {
+            int weapon_type = static_cast<int>(packet.value().rest.weapon);
+            if (weapon_type < 0 || weapon_type >= rf::num_weapon_types) {
+                xlog::warn("Ignoring entity_create packet with invalid weapon type {}", weapon_type);
+                return;
+            }
             auto old_default_player_weapon = rf::default_player_weapon;
             rf::default_player_weapon = rf::weapon_types[weapon_type].name;
             process_entity_create_packet_hook.call_target(data, addr);
@@ -430,10 +490,15 @@ FunHook<MultiIoPacketHandler> process_reload_packet_hook{
     [](char* data, const rf::NetAddr& addr) {
         if (!rf::is_server) { // client-side
             // Update clip_size and max_ammo if received values are greater than values from local weapons.tbl
-            int weapon_type, ammo, clip_ammo;
-            std::memcpy(&weapon_type, data + 4, sizeof(weapon_type));
-            std::memcpy(&ammo, data + 8, sizeof(ammo));
-            std::memcpy(&clip_ammo, data + 12, sizeof(clip_ammo));
+            auto reader = get_packet_payload_reader(data);
+            reader.skip(sizeof(RF_ReloadPacket::entity_handle));
+            auto weapon_type = reader.read<int32_t>().value_or(-1);
+            auto ammo = reader.read<int32_t>().value_or(0);
+            auto clip_ammo = reader.read<int32_t>().value_or(0);
+            if (reader.failed() || weapon_type < 0 || weapon_type >= rf::num_weapon_types) {
+                xlog::warn("Ignoring malformed reload packet");
+                return;
+            }
 
             if (rf::weapon_types[weapon_type].clip_size < clip_ammo)
                 rf::weapon_types[weapon_type].clip_size = clip_ammo;
@@ -454,11 +519,14 @@ FunHook<MultiIoPacketHandler> process_reload_request_packet_hook{
             return;
         }
         rf::Player* pp = rf::multi_find_player_by_addr(addr);
-        int weapon_type;
-        std::memcpy(&weapon_type, data, sizeof(weapon_type));
+        auto weapon_type = get_packet_payload_reader(data).read<int32_t>();
+        if (!weapon_type) {
+            xlog::warn("Ignoring malformed reload_request packet");
+            return;
+        }
         if (pp) {
             void multi_reload_weapon_server_side(rf::Player* pp, int weapon_type);
-            multi_reload_weapon_server_side(pp, weapon_type);
+            multi_reload_weapon_server_side(pp, weapon_type.value());
         }
     },
 };
@@ -684,8 +752,11 @@ struct DashFactionJoinAcceptPacketExt
 
     enum class Flags : uint32_t {
         none           = 0,
-        saving_enabled = 1,
-        max_fov        = 2,
+        saving_enabled     = 1,
+        max_fov            = 2,
+        obj_update_delta   = 4,
+        state_snapshot     = 8,
+        reliable_transport = 16,
     } flags = Flags::none;
 
     float max_fov;
@@ -715,6 +786,15 @@ CallHook<int(const rf::NetAddr*, std::byte*, size_t)> send_join_accept_packet_ho
             ext_data.flags |= DashFactionJoinAcceptPacketExt::Flags::max_fov;
             ext_data.max_fov = server_get_df_config().max_fov.value();
         }
+        if (server_get_df_config().obj_update_delta) {
+            ext_data.flags |= DashFactionJoinAcceptPacketExt::Flags::obj_update_delta;
+        }
+        if (server_get_df_config().state_snapshot.enabled) {
+            ext_data.flags |= DashFactionJoinAcceptPacketExt::Flags::state_snapshot;
+        }
+        if (server_get_df_config().reliable_transport) {
+            ext_data.flags |= DashFactionJoinAcceptPacketExt::Flags::reliable_transport;
+        }
         auto [new_data, new_len] = extend_packet(data, len, ext_data);
         return send_join_accept_packet_hook.call_target(addr, new_data.get(), new_len);
     },
@@ -741,11 +821,18 @@ CodeInjection process_join_accept_injection{
             if (!!(ext_data.flags & DashFactionJoinAcceptPacketExt::Flags::max_fov) && ext_data.max_fov >= default_fov) {
                 server_info.max_fov = ext_data.max_fov;
             }
+            server_info.obj_update_delta = !!(ext_data.flags & DashFactionJoinAcceptPacketExt::Flags::obj_update_delta);
+            server_info.state_snapshot = !!(ext_data.flags & DashFactionJoinAcceptPacketExt::Flags::state_snapshot);
+            server_info.reliable_transport =
+                !!(ext_data.flags & DashFactionJoinAcceptPacketExt::Flags::reliable_transport);
             g_df_server_info = std::optional{server_info};
         }
         else {
             g_df_server_info.reset();
         }
+        obj_update_delta_on_join_accept();
+        state_snapshot_on_join_accept();
+        reliable_transport_on_join_accept();
     },
 };
 
@@ -957,7 +1044,7 @@ CodeInjection server_update_rate_injection{
     0x0047E891,
     [](auto& regs) {
         auto& min_send_obj_update_interval = *static_cast<int*>(regs.esp);
-        min_send_obj_update_interval = 1000 / g_update_rate;
+        min_send_obj_update_interval = 1000 / server_get_obj_update_rate(g_update_rate);
     },
 };
 
@@ -981,6 +1068,9 @@ ConsoleCommand2 update_rate_cmd{
             }
         }
         rf::console::print("Update rate per second: {}", g_update_rate);
+        if (rf::is_server && server_get_df_config().adaptive_update_rate.enabled) {
+            rf::console::print("Adaptive update rate is enabled - use update_rates command to see rates of players");
+        }
     },
 };
 
@@ -1025,14 +1115,124 @@ FunHook<void(rf::Player*)> send_players_packet_hook{
         pf_player_init(player);
         if (rf::is_server) {
             server_reliable_socket_ready(player);
+            reliable_transport_on_socket_ready(player);
         }
     },
 };
 
+extern FunHook<void(rf::Player*, const void*, int)> multi_io_send_hook;
+void __fastcall multi_io_stats_add_new(void *this_, int edx, int size, bool is_send, int packet_type);
+
+static void flush_pending_unreliable_packets(rf::Player* player)
+{
+    auto& pending = get_player_additional_data(player).pending_unreliable_packets;
+    if (!pending.empty() && player->net_data) {
+        // Packets were added to stats when they were queued so bypass the stock send function that would add the whole
+        // datagram under the type of the first packet
+        rf::net_send(player->net_data->addr, pending.data(), static_cast<int>(pending.size()));
+        pending.clear();
+    }
+}
+
+static void multi_io_send_coalesced(rf::Player* player, const void* packet, int len)
+{
+    // Queue packets until the end of the frame so multiple packets can share one datagram
+    if (rf::is_server && server_get_df_config().coalesce_packets && player->net_data &&
+        len <= static_cast<int>(rf::max_packet_size)) {
+        auto& pending = get_player_additional_data(player).pending_unreliable_packets;
+        if (pending.size() + len > rf::max_packet_size) {
+            flush_pending_unreliable_packets(player);
+        }
+        int packet_type = std::to_integer<int>(*static_cast<const std::byte*>(packet));
+        multi_io_stats_add_new(&player->net_data->stats, 0, len, true, packet_type);
+        auto bytes = static_cast<const std::byte*>(packet);
+        pending.insert(pending.end(), bytes, bytes + len);
+        return;
+    }
+    multi_io_send_hook.call_target(player, packet, len);
+}
+
+void multi_io_flush_coalesced_packets()
+{
+    if (!rf::is_server || !server_get_df_config().coalesce_packets) {
+        return;
+    }
+    for (auto& player : SinglyLinkedList{rf::player_list}) {
+        flush_pending_unreliable_packets(&player);
+    }
+}
+
+static bool is_packet_replay_player(rf::Player* player)
+{
+    return player && player->net_data && packet_replay_is_sink_addr(player->net_data->addr);
+}
+
+FunHook<void(rf::Player*, const void*, int)> multi_io_send_hook{
+    0x00479370,
+    [](rf::Player* player, const void* packet, int len) {
+        if (is_packet_replay_player(player)) {
+            return;
+        }
+        if (rf::is_server && player) {
+            // Throttle position updates in obj_update packets to match the rate chosen for the player
+            std::vector<std::byte> throttled_packet;
+            if (server_adaptive_update_rate_filter_obj_update(player, packet, len, throttled_packet)) {
+                if (throttled_packet.empty()) {
+                    return;
+                }
+                packet = throttled_packet.data();
+                len = static_cast<int>(throttled_packet.size());
+            }
+            // Skip objects that are not relevant for the player in obj_update packets
+            std::vector<std::byte> filtered_packet;
+            if (server_interest_filter_obj_update(player, packet, len, filtered_packet)) {
+                packet = filtered_packet.data();
+                len = static_cast<int>(filtered_packet.size());
+            }
+            // Replace obj_update packets with delta compressed ones for clients that support it
+            std::vector<std::byte> delta_packet;
+            if (obj_update_delta_encode(player, packet, len, delta_packet)) {
+                multi_io_send_coalesced(player, delta_packet.data(), static_cast<int>(delta_packet.size()));
+                return;
+            }
+            multi_io_send_coalesced(player, packet, len);
+            return;
+        }
+        multi_io_send_hook.call_target(player, packet, len);
+    },
+};
+
+FunHook<void(rf::Player*, const void*, int, int)> multi_io_send_reliable_hook{
+    0x00479480,
+    [](rf::Player* player, const void* data, int len, int not_limbo) {
+        if (is_packet_replay_player(player)) {
+            return;
+        }
+        if (rf::is_server && player && state_snapshot_capture_reliable(player, data, len, not_limbo)) {
+            return;
+        }
+        multi_io_send_reliable_hook.call_target(player, data, len, not_limbo);
+    },
+};
+
+FunHook<void(rf::Player*)> multi_io_send_buffered_reliable_packets_hook{
+    0x004796C0,
+    [](rf::Player* player) {
+        // Send buffered packets using DF reliable transport if it has been negotiated with the client
+        if (rf::is_server && player && reliable_transport_send_buffered(player)) {
+            return;
+        }
+        multi_io_send_buffered_reliable_packets_hook.call_target(player);
+    },
+};
+
 extern FunHook<void __fastcall(void*, int, int, bool, int)> multi_io_stats_add_hook;
 
 void __fastcall multi_io_stats_add_new(void *this_, int edx, int size, bool is_send, int packet_type)
 {
+    // Engine stats table is limited to standard packet types so track all types separately
+    net_telemetry_record(static_cast<rf::MultiIoStats*>(this_), packet_type, size, is_send);
+
     // Fix memory corruption when sending/processing packets with non-standard type
     if (packet_type < 56) {
         multi_io_stats_add_hook.call_target(this_, edx, size, is_send, packet_type);
@@ -1044,6 +1244,17 @@ FunHook<void __fastcall(void*, int, int, bool, int)> multi_io_stats_add_hook{0x0
 static void process_custom_packet([[maybe_unused]] void* data, [[maybe_unused]] int len,
                                   [[maybe_unused]] const rf::NetAddr& addr, [[maybe_unused]] rf::Player* player)
 {
+    // Replayed packets must not modify state of live DF connections
+    bool replaying = packet_replay_is_active();
+    if (!replaying && obj_update_delta_process_packet(data, len, addr, player)) {
+        return;
+    }
+    if (!replaying && state_snapshot_process_packet(data, len, addr, player)) {
+        return;
+    }
+    if (!replaying && reliable_transport_process_packet(data, len, addr, player)) {
+        return;
+    }
     pf_process_packet(data, len, addr, player);
 }
 
@@ -1051,6 +1262,19 @@ CodeInjection multi_io_process_packets_injection{
     0x0047918D,
     [](auto& regs) {
         int packet_type = regs.esi;
+        g_dispatched_datagram_begin = regs.ecx;
+        g_dispatched_datagram_end = g_dispatched_datagram_begin + static_cast<int>(regs.edi);
+        if (packet_type == state_info_request && rf::is_server) {
+            // Packets sent by the stock handler are collected into a snapshot if the client supports it
+            auto stack_frame = regs.esp + 0x1C;
+            auto player = addr_as_ref<rf::Player*>(stack_frame + 0x10);
+            if (player) {
+                state_snapshot_on_state_info_request(player);
+            }
+        }
+        if (packet_type == state_info_done && !rf::is_server) {
+            state_snapshot_on_state_info_done();
+        }
         if (packet_type > 0x37 || packet_type == static_cast<int>(pf_packet_type::player_stats)) {
             auto stack_frame = regs.esp + 0x1C;
             std::byte* data = regs.ecx;
@@ -1058,19 +1282,34 @@ CodeInjection multi_io_process_packets_injection{
             int len = regs.edi;
             auto& addr = *addr_as_ref<rf::NetAddr*>(stack_frame + 0xC);
             auto player = addr_as_ref<rf::Player*>(stack_frame + 0x10);
-            process_custom_packet(data + offset, len, addr, player);
+            // Custom packet handlers check sizes against the rest of the datagram
+            process_custom_packet(data + offset, len - offset, addr, player);
             regs.eip = 0x00479194;
         }
     },
 };
 
+void process_unreliable_game_packets(const void* data, size_t len, const rf::NetAddr& addr, rf::Player* player)
+{
+    if (!net_rate_limit_allow_datagram(data, len, addr, player)) {
+        return;
+    }
+    if (pf_process_raw_unreliable_packet(data, len, addr)) {
+        return;
+    }
+    g_processing_unreliable_packets = true;
+    rf::multi_io_process_packets(data, len, addr, player);
+    g_processing_unreliable_packets = false;
+}
+
 CallHook<void(const void*, size_t, const rf::NetAddr&, rf::Player*)> process_unreliable_game_packets_hook{
     0x00479244,
     [](const void* data, size_t len, const rf::NetAddr& addr, rf::Player* player) {
-        if (pf_process_raw_unreliable_packet(data, len, addr)) {
+        // Simulated network conditions can delay the datagram
+        if (net_sim_delay_incoming(data, len, addr)) {
             return;
         }
-        rf::multi_io_process_packets(data, len, addr, player);
+        process_unreliable_game_packets(data, len, addr, player);
     },
 };
 
@@ -1097,15 +1336,6 @@ CallHook<int()> game_info_num_players_hook{
 
 void network_init()
 {
-    // Improve simultaneous ping
-    rf::simultaneous_ping = 32;
-
-    // Change server info timeout to 2s
-    write_mem<u32>(0x0044D357 + 2, 2000);
-
-    // Change delay between server info requests
-    write_mem<u8>(0x0044D338 + 1, 20);
-
     // Allow ports < 1023 (especially 0 - any port)
     AsmWriter(0x00528F24).nop(2);
 
@@ -1240,6 +1470,15 @@ void network_init()
     multi_io_stats_add_hook.install();
     process_unreliable_game_packets_hook.install();
 
+    // Filter, compress and coalesce unreliable packets
+    multi_io_send_hook.install();
+
+    // Collect level state sent to joining players into snapshots
+    multi_io_send_reliable_hook.install();
+
+    // Use DF reliable transport for clients that support it
+    multi_io_send_buffered_reliable_packets_hook.install();
+
     // Fix rejecting reliable packets from non-connected clients
     // Fixes players randomly losing connection to the server when some player sends double left game packets
     // when leaving because of missing level file
@@ -0,0 +1,174 @@
+#include <cstring>
+#include <optional>
+#include <vector>
+#include <common/net/ObjUpdateDelta.h>
+#include <common/rfproto.h>
+#include <xlog/xlog.h>
+#include "../rf/multi.h"
+#include "../rf/os/timer.h"
+#include "../misc/player.h"
+#include "multi.h"
+#include "multi_private.h"
+#include "server_internal.h"
+#include "df_packets.h"
+
+// Client-side state of the connection with a server that supports obj_update_delta packets
+static std::optional<ObjUpdateDeltaDecoder> g_obj_update_delta_decoder;
+static int g_last_obj_update_delta_hello_ms = 0;
+
+static void send_obj_update_delta_ack(std::optional<uint16_t> sequence)
+{
+    // Send: client -> server
+    df_obj_update_delta_ack_packet packet{};
+    packet.hdr.type = static_cast<uint8_t>(df_packet_type::obj_update_delta_ack);
+    packet.hdr.size = sizeof(packet) - sizeof(packet.hdr);
+    packet.flags = sequence ? df_obj_update_delta_ack_has_sequence : 0;
+    packet.sequence = sequence.value_or(0);
+    rf::net_send(rf::netgame.server_addr, &packet, sizeof(packet));
+}
+
+bool obj_update_delta_encode(rf::Player* player, const void* data, int len, std::vector<std::byte>& buf)
+{
+    // Send: server -> client
+    auto& encoder = get_player_additional_data(player).obj_update_delta_encoder;
+    if (!encoder) {
+        // Client did not announce support for obj_update_delta packets
+        return false;
+    }
+
+    RF_GamePacketHeader header;
+    if (len < static_cast<int>(sizeof(header))) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.type != RF_GPT_OBJECT_UPDATE || sizeof(header) + header.size != static_cast<size_t>(len)) {
+        return false;
+    }
+
+    ObjUpdateSnapshot snapshot;
+    auto payload = static_cast<const std::byte*>(data) + sizeof(header);
+    if (!obj_update_parse(payload, header.size, snapshot)) {
+        xlog::trace("Cannot parse obj_update packet - sending it without delta compression");
+        return false;
+    }
+
+    buf.resize(sizeof(df_packet_header));
+    encoder.value().encode(snapshot, buf);
+    if (buf.size() > rf::max_packet_size) {
+        return false;
+    }
+    df_packet_header delta_header;
+    delta_header.type = static_cast<uint8_t>(df_packet_type::obj_update_delta);
+    delta_header.size = static_cast<uint16_t>(buf.size() - sizeof(delta_header));
+    std::memcpy(buf.data(), &delta_header, sizeof(delta_header));
+    return true;
+}
+
+static void process_obj_update_delta_packet(const void* data, size_t len, const rf::NetAddr& addr,
+    rf::Player* player)
+{
+    // Receive: client <- server
+    if (rf::is_server || !g_obj_update_delta_decoder || addr != rf::netgame.server_addr) {
+        return;
+    }
+
+    df_packet_header header;
+    std::memcpy(&header, data, sizeof(header));
+    auto payload = static_cast<const std::byte*>(data) + sizeof(header);
+    ObjUpdateSnapshot snapshot;
+    if (!g_obj_update_delta_decoder.value().decode(payload, header.size, snapshot)) {
+        // Baseline was probably lost - server switches to a newer one when it gets the next acknowledgement
+        xlog::trace("Cannot decode obj_update_delta packet");
+        return;
+    }
+    send_obj_update_delta_ack(g_obj_update_delta_decoder.value().last_sequence());
+
+    // Rebuild stock obj_update packet and pass it to the standard handler
+    std::vector<std::byte> buf(sizeof(RF_GamePacketHeader));
+    obj_update_write(snapshot, buf);
+    RF_GamePacketHeader obj_update_header;
+    obj_update_header.type = RF_GPT_OBJECT_UPDATE;
+    obj_update_header.size = static_cast<uint16_t>(buf.size() - sizeof(obj_update_header));
+    std::memcpy(buf.data(), &obj_update_header, sizeof(obj_update_header));
+    multi_io_process_decoded_packets(buf.data(), buf.size(), addr, player, false);
+}
+
+static void process_obj_update_delta_ack_packet(const void* data, size_t len, rf::Player* player)
+{
+    // Receive: server <- client
+    if (!rf::is_server || !player || !server_get_df_config().obj_update_delta) {
+        return;
+    }
+
+    df_obj_update_delta_ack_packet packet;
+    if (len < sizeof(packet)) {
+        xlog::trace("Invalid length in obj_update_delta_ack packet");
+        return;
+    }
+    std::memcpy(&packet, data, sizeof(packet));
+    auto& encoder = get_player_additional_data(player).obj_update_delta_encoder;
+    if (!encoder) {
+        xlog::debug("Enabling delta compressed obj_update packets for {}", player->name.c_str());
+        encoder.emplace();
+    }
+    if (packet.flags & df_obj_update_delta_ack_has_sequence) {
+        encoder.value().ack(packet.sequence);
+    }
+}
+
+bool obj_update_delta_process_packet(const void* data, int len, const rf::NetAddr& addr, rf::Player* player)
+{
+    df_packet_header header{};
+    if (len < static_cast<int>(sizeof(header))) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (sizeof(header) + header.size > static_cast<size_t>(len)) {
+        return false;
+    }
+
+    switch (static_cast<df_packet_type>(header.type)) {
+        case df_packet_type::obj_update_delta:
+            process_obj_update_delta_packet(data, sizeof(header) + header.size, addr, player);
+            break;
+
+        case df_packet_type::obj_update_delta_ack:
+            process_obj_update_delta_ack_packet(data, sizeof(header) + header.size, player);
+            break;
+
+        default:
+            return false;
+    }
+    return true;
+}
+
+void obj_update_delta_on_join_accept()
+{
+    const auto& server_info = get_df_server_info();
+    if (server_info && server_info.value().obj_update_delta) {
+        g_obj_update_delta_decoder.emplace();
+        g_last_obj_update_delta_hello_ms = 0;
+    }
+    else {
+        g_obj_update_delta_decoder.reset();
+    }
+}
+
+void multi_obj_update_delta_do_frame()
+{
+    if (!g_obj_update_delta_decoder) {
+        return;
+    }
+    if (!rf::is_multi || rf::is_server || !get_df_server_info()) {
+        g_obj_update_delta_decoder.reset();
+        return;
+    }
+    // Announce support until the first packet arrives because unreliable packets can be lost
+    if (!g_obj_update_delta_decoder.value().last_sequence()) {
+        int now = rf::timer_get(1000);
+        if (g_last_obj_update_delta_hello_ms == 0 || now - g_last_obj_update_delta_hello_ms >= 1000) {
+            g_last_obj_update_delta_hello_ms = now;
+            send_obj_update_delta_ack({});
+        }
+    }
+}
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <optional>
+#include <common/net/PacketLog.h>
+#include <common/utils/list-utils.h>
+#include <xlog/xlog.h>
+#include <patch_common/FunHook.h>
+#include "../rf/multi.h"
+#include "../rf/player/player.h"
+#include "../os/console.h"
+#include "multi.h"
+#include "multi_private.h"
+
+// Set while processing unreliable datagrams so captured packets can be flagged properly
+bool g_processing_unreliable_packets = false;
+// Set while processing packets decoded from DF packets - they are not captured because source packets are
+static bool g_processing_decoded_packets = false;
+
+static std::unique_ptr<PacketLogWriter> g_packet_capture_writer;
+static std::chrono::steady_clock::time_point g_packet_capture_start;
+
+struct PacketReplay
+{
+    PacketLogReader reader;
+    PacketLogRecord next_record;
+    bool has_next_record = false;
+    std::chrono::steady_clock::time_point start;
+    unsigned num_datagrams = 0;
+};
+
+static std::optional<PacketReplay> g_realtime_packet_replay;
+static bool g_replaying_packets = false;
+// Replayed packets come from loopback addresses in 127.255.0.0/16 range that never receive anything so engine
+// handlers cannot send replies to hosts from the capture
+constexpr uint32_t packet_replay_sink_net = 0x7FFF0000;
+constexpr uint32_t packet_replay_sink_mask = 0xFFFF0000;
+static std::map<std::pair<uint32_t, uint16_t>, rf::NetAddr> g_packet_replay_sink_addrs;
+
+static void packet_capture_record(const void* data, size_t len, const rf::NetAddr& addr, bool reliable)
+{
+    auto elapsed = std::chrono::steady_clock::now() - g_packet_capture_start;
+    PacketLogRecord record;
+    record.timestamp_ms = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+    record.ip_addr = addr.ip_addr;
+    record.port = addr.port;
+    record.flags = reliable ? PacketLogRecord::flag_reliable : 0;
+    auto bytes = static_cast<const std::byte*>(data);
+    record.data.assign(bytes, bytes + len);
+    try {
+        g_packet_capture_writer->write(record);
+    }
+    catch (const std::exception& e) {
+        xlog::error("Packet capture failed: {}", e.what());
+        g_packet_capture_writer.reset();
+    }
+}
+
+FunHook<rf::MultiIoProcessPackets_Type> multi_io_process_packets_capture_hook{
+    0x004790D0,
+    [](const void* data, size_t len, const rf::NetAddr& addr, rf::Player* player) {
+        if (g_packet_capture_writer && !g_replaying_packets && !g_processing_decoded_packets) {
+            packet_capture_record(data, len, addr, !g_processing_unreliable_packets);
+        }
+        multi_io_process_packets_capture_hook.call_target(data, len, addr, player);
+    },
+};
+
+void multi_io_process_decoded_packets(const void* data, size_t len, const rf::NetAddr& addr, rf::Player* player,
+    bool reliable)
+{
+    // Handlers can process decoded packets recursively so restore previous state afterwards
+    bool prev_processing_decoded_packets = g_processing_decoded_packets;
+    bool prev_processing_unreliable_packets = g_processing_unreliable_packets;
+    g_processing_decoded_packets = true;
+    g_processing_unreliable_packets = !reliable;
+    rf::multi_io_process_packets(data, len, addr, player);
+    g_processing_decoded_packets = prev_processing_decoded_packets;
+    g_processing_unreliable_packets = prev_processing_unreliable_packets;
+}
+
+bool packet_replay_is_active()
+{
+    return g_replaying_packets;
+}
+
+bool packet_replay_is_sink_addr(const rf::NetAddr& addr)
+{
+    return (addr.ip_addr & packet_replay_sink_mask) == packet_replay_sink_net;
+}
+
+static rf::NetAddr get_packet_replay_sink_addr(const PacketLogRecord& record)
+{
+    auto [it, inserted] = g_packet_replay_sink_addrs.try_emplace({record.ip_addr, record.port});
+    if (inserted) {
+        auto index = static_cast<uint32_t>(g_packet_replay_sink_addrs.size()) & ~packet_replay_sink_mask;
+        it->second = {packet_replay_sink_net | index, record.port};
+    }
+    return it->second;
+}
+
+static bool has_remote_players()
+{
+    for (auto& player : SinglyLinkedList{rf::player_list}) {
+        if (player.net_data && &player != rf::local_player && !packet_replay_is_sink_addr(player.net_data->addr)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void packet_replay_process(const PacketLogRecord& record)
+{
+    rf::NetAddr addr = get_packet_replay_sink_addr(record);
+    rf::Player* player = rf::multi_find_player_by_addr(addr);
+    g_replaying_packets = true;
+    g_processing_unreliable_packets = !record.is_reliable();
+    rf::multi_io_process_packets(record.data.data(), record.data.size(), addr, player);
+    g_processing_unreliable_packets = false;
+    g_replaying_packets = false;
+}
+
+static void packet_replay_full_speed(const std::string& filename)
+{
+    PacketLogReader reader{filename};
+    PacketLogRecord record;
+    unsigned num_datagrams = 0;
+    unsigned long long num_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (reader.read(record)) {
+        packet_replay_process(record);
+        ++num_datagrams;
+        num_bytes += record.data.size();
+    }
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    double seconds = std::max(duration.count(), 1e-9);
+    rf::console::print("Replayed {} datagrams ({} bytes) in {:.3f} ms: {:.0f} datagrams/s, {:.2f} MB/s",
+        num_datagrams, num_bytes, seconds * 1000.0, num_datagrams / seconds, num_bytes / seconds / 1000000.0);
+}
+
+void multi_packet_replay_do_frame()
+{
+    if (!g_realtime_packet_replay) {
+        return;
+    }
+    auto& replay = g_realtime_packet_replay.value();
+    if (!rf::is_multi || has_remote_players()) {
+        rf::console::print("Packet replay aborted");
+        g_realtime_packet_replay.reset();
+        return;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - replay.start;
+    long long elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    try {
+        while (replay.has_next_record && static_cast<long long>(replay.next_record.timestamp_ms) <= elapsed_ms) {
+            packet_replay_process(replay.next_record);
+            ++replay.num_datagrams;
+            replay.has_next_record = replay.reader.read(replay.next_record);
+        }
+    }
+    catch (const std::exception& e) {
+        xlog::error("Packet replay failed: {}", e.what());
+        replay.has_next_record = false;
+    }
+    if (!replay.has_next_record) {
+        rf::console::print("Packet replay finished: {} datagrams", replay.num_datagrams);
+        g_realtime_packet_replay.reset();
+    }
+}
+
+ConsoleCommand2 packet_capture_cmd{
+    "packet_capture",
+    [](std::optional<std::string> filename) {
+        if (g_packet_capture_writer) {
+            g_packet_capture_writer.reset();
+            rf::console::print("Packet capture stopped");
+            return;
+        }
+        std::string path = filename.value_or("logs/packets.dfpl");
+        try {
+            g_packet_capture_writer = std::make_unique<PacketLogWriter>(path, static_cast<uint64_t>(std::time(nullptr)));
+            g_packet_capture_start = std::chrono::steady_clock::now();
+            rf::console::print("Capturing received packets to {}", path);
+        }
+        catch (const std::exception& e) {
+            rf::console::print("Cannot start packet capture: {}", e.what());
+        }
+    },
+    "Toggles capturing of received multiplayer packets to a binary log",
+    "packet_capture [filename]",
+};
+
+ConsoleCommand2 packet_replay_cmd{
+    "packet_replay",
+    [](std::string filename, std::optional<bool> realtime) {
+        // Replay must not affect a live game so it is only allowed on a server without connected players
+        if (!rf::is_multi || !rf::is_server || has_remote_players()) {
+            rf::console::print("Packet replay requires a server without connected players");
+            return;
+        }
+        if (g_realtime_packet_replay) {
+            rf::console::print("Packet replay is already running");
+            return;
+        }
+        try {
+            if (realtime.value_or(false)) {
+                PacketReplay replay{PacketLogReader{filename}};
+                replay.has_next_record = replay.reader.read(replay.next_record);
+                replay.start = std::chrono::steady_clock::now();
+                g_realtime_packet_replay.emplace(std::move(replay));
+                rf::console::print("Replaying {} in real time", filename);
+            }
+            else {
+                packet_replay_full_speed(filename);
+            }
+        }
+        catch (const std::exception& e) {
+            rf::console::print("Packet replay failed: {}", e.what());
+        }
+    },
+    "Feeds packets from a capture log to packet handlers at full speed (for benchmarking) or in real time",
+    "packet_replay <filename> [realtime]",
+};
+
+void packet_capture_apply_patch()
+{
+    multi_io_process_packets_capture_hook.install();
+    packet_capture_cmd.register_cmd();
+    packet_replay_cmd.register_cmd();
+}
@@ -0,0 +1,279 @@
+#include <cstring>
+#include <optional>
+#include <vector>
+#include <common/net/ReliableTransport.h>
+#include <common/rfproto.h>
+#include <common/utils/list-utils.h>
+#include <patch_common/FunHook.h>
+#include <xlog/xlog.h>
+#include "../rf/multi.h"
+#include "../rf/player/player.h"
+#include "../rf/os/timer.h"
+#include "../misc/player.h"
+#include "multi.h"
+#include "multi_private.h"
+#include "server_internal.h"
+#include "df_packets.h"
+#include "net_telemetry.h"
+
+extern FunHook<void(rf::Player*, const void*, int)> multi_io_send_hook;
+extern FunHook<void(rf::Player*, const void*, int, int)> multi_io_send_reliable_hook;
+extern FunHook<void(rf::Player*)> multi_io_send_buffered_reliable_packets_hook;
+
+// Client-side state of the connection with a server that supports DF reliable transport
+static std::optional<ReliableReceiver> g_reliable_receiver;
+// Set when all packets sent using the stock reliable channel have been processed
+static bool g_reliable_switched = false;
+static int g_num_reliable_hellos = 0;
+static int g_last_reliable_hello_ms = 0;
+static std::vector<std::byte> g_reliable_stream;
+
+// Limits how long support is announced to a server that did not switch to DF reliable transport
+constexpr int reliable_transport_max_hellos = 10;
+
+// Sends packet to the player (server-side) or to the server (client-side) if player is null
+static void send_df_packet(rf::Player* player, df_packet_type type, const std::byte* data, size_t len)
+{
+    std::byte buf[rf::max_packet_size];
+    df_packet_header header;
+    header.type = static_cast<uint8_t>(type);
+    header.size = static_cast<uint16_t>(len);
+    std::memcpy(buf, &header, sizeof(header));
+    if (len > 0) {
+        std::memcpy(buf + sizeof(header), data, len);
+    }
+    int packet_len = static_cast<int>(sizeof(header) + len);
+    if (player) {
+        // Stock send function adds the packet to player stats and network telemetry
+        multi_io_send_hook.call_target(player, buf, packet_len);
+    }
+    else {
+        net_telemetry_record(nullptr, header.type, packet_len, true);
+        rf::net_send(rf::netgame.server_addr, buf, packet_len);
+    }
+}
+
+static void send_reliable_segments(rf::Player* player)
+{
+    // Send: server -> client
+    auto& sender = get_player_additional_data(player).reliable_transport.sender.value();
+    sender.poll(rf::timer_get(1000), [=](const std::byte* data, std::size_t len) {
+        send_df_packet(player, df_packet_type::reliable_data, data, len);
+    });
+}
+
+static void switch_to_reliable_transport(rf::Player* player)
+{
+    auto& state = get_player_additional_data(player).reliable_transport;
+    if (state.sender || !state.client_supported || !state.socket_ready) {
+        return;
+    }
+    xlog::debug("Enabling DF reliable transport for {}", player->name.c_str());
+    // Packets buffered so far are sent using the stock channel followed by the switch packet so the client knows
+    // when it can start processing packets received using DF reliable transport
+    df_reliable_switch_packet packet{};
+    packet.hdr.type = static_cast<uint8_t>(df_packet_type::reliable_switch);
+    packet.hdr.size = sizeof(packet) - sizeof(packet.hdr);
+    multi_io_send_reliable_hook.call_target(player, &packet, sizeof(packet), 0);
+    multi_io_send_buffered_reliable_packets_hook.call_target(player);
+    state.sender.emplace();
+}
+
+void reliable_transport_on_socket_ready(rf::Player* player)
+{
+    get_player_additional_data(player).reliable_transport.socket_ready = true;
+    switch_to_reliable_transport(player);
+}
+
+bool reliable_transport_send_buffered(rf::Player* player)
+{
+    auto& sender = get_player_additional_data(player).reliable_transport.sender;
+    if (!sender || !player->net_data) {
+        return false;
+    }
+    auto& net_data = *player->net_data;
+    if (net_data.reliable_buffer_size > 0) {
+        sender.value().write(reinterpret_cast<const std::byte*>(net_data.reliable_buffer),
+            static_cast<std::size_t>(net_data.reliable_buffer_size));
+        net_data.reliable_buffer_size = 0;
+    }
+    send_reliable_segments(player);
+    return true;
+}
+
+static void process_reliable_hello_packet(rf::Player* player)
+{
+    // Receive: server <- client
+    if (!rf::is_server || !player || !server_get_df_config().reliable_transport) {
+        return;
+    }
+    get_player_additional_data(player).reliable_transport.client_supported = true;
+    switch_to_reliable_transport(player);
+}
+
+static void process_reliable_ack_packet(const void* data, size_t len, rf::Player* player)
+{
+    // Receive: server <- client
+    if (!rf::is_server || !player) {
+        return;
+    }
+    auto& sender = get_player_additional_data(player).reliable_transport.sender;
+    if (!sender) {
+        return;
+    }
+    auto ack = static_cast<const std::byte*>(data) + sizeof(df_packet_header);
+    if (!sender.value().process_ack(ack, len - sizeof(df_packet_header), rf::timer_get(1000))) {
+        xlog::trace("Invalid reliable_ack packet");
+        return;
+    }
+    // Acknowledgement can open the congestion window
+    send_reliable_segments(player);
+}
+
+static void deliver_reliable_packets(const rf::NetAddr& addr, rf::Player* player)
+{
+    g_reliable_receiver.value().read(g_reliable_stream);
+    // Pass only complete game packets - a packet can be split between segments
+    std::size_t len = 0;
+    RF_GamePacketHeader header;
+    while (len + sizeof(header) <= g_reliable_stream.size()) {
+        std::memcpy(&header, g_reliable_stream.data() + len, sizeof(header));
+        if (len + sizeof(header) + header.size > g_reliable_stream.size()) {
+            break;
+        }
+        len += sizeof(header) + header.size;
+    }
+    if (len == 0) {
+        return;
+    }
+    // Copy data because packet handlers can receive more data recursively
+    auto end = g_reliable_stream.begin() + static_cast<std::ptrdiff_t>(len);
+    std::vector<std::byte> packets{g_reliable_stream.begin(), end};
+    g_reliable_stream.erase(g_reliable_stream.begin(), end);
+    multi_io_process_decoded_packets(packets.data(), packets.size(), addr, player, true);
+}
+
+static void process_reliable_switch_packet(const rf::NetAddr& addr, rf::Player* player)
+{
+    // Receive: client <- server
+    if (rf::is_server || !g_reliable_receiver || addr != rf::netgame.server_addr) {
+        return;
+    }
+    xlog::debug("Server switched to DF reliable transport");
+    g_reliable_switched = true;
+    deliver_reliable_packets(addr, player);
+}
+
+static void process_reliable_data_packet(const void* data, size_t len, const rf::NetAddr& addr, rf::Player* player)
+{
+    // Receive: client <- server
+    if (rf::is_server || !g_reliable_receiver || addr != rf::netgame.server_addr) {
+        return;
+    }
+    auto segment = static_cast<const std::byte*>(data) + sizeof(df_packet_header);
+    if (!g_reliable_receiver.value().process_data(segment, len - sizeof(df_packet_header))) {
+        xlog::trace("Invalid reliable_data packet");
+        return;
+    }
+    // Packets sent before the switch packet may still be on the way in the stock reliable channel
+    if (g_reliable_switched) {
+        deliver_reliable_packets(addr, player);
+    }
+}
+
+bool reliable_transport_process_packet(const void* data, int len, const rf::NetAddr& addr, rf::Player* player)
+{
+    df_packet_header header{};
+    if (len < static_cast<int>(sizeof(header))) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (sizeof(header) + header.size > static_cast<size_t>(len)) {
+        return false;
+    }
+
+    switch (static_cast<df_packet_type>(header.type)) {
+        case df_packet_type::reliable_hello:
+            process_reliable_hello_packet(player);
+            break;
+
+        case df_packet_type::reliable_switch:
+            process_reliable_switch_packet(addr, player);
+            break;
+
+        case df_packet_type::reliable_data:
+            process_reliable_data_packet(data, sizeof(header) + header.size, addr, player);
+            break;
+
+        case df_packet_type::reliable_ack:
+            process_reliable_ack_packet(data, sizeof(header) + header.size, player);
+            break;
+
+        default:
+            return false;
+    }
+    return true;
+}
+
+void reliable_transport_on_join_accept()
+{
+    const auto& server_info = get_df_server_info();
+    if (server_info && server_info.value().reliable_transport) {
+        g_reliable_receiver.emplace();
+    }
+    else {
+        g_reliable_receiver.reset();
+    }
+    g_reliable_switched = false;
+    g_num_reliable_hellos = 0;
+    g_last_reliable_hello_ms = 0;
+    g_reliable_stream.clear();
+}
+
+static void server_reliable_transport_do_frame()
+{
+    std::vector<rf::Player*> failed_players;
+    for (auto& player : SinglyLinkedList{rf::player_list}) {
+        auto& sender = get_player_additional_data(&player).reliable_transport.sender;
+        if (!sender) {
+            continue;
+        }
+        // Retransmit lost segments
+        send_reliable_segments(&player);
+        if (sender.value().failed()) {
+            failed_players.push_back(&player);
+        }
+    }
+    for (auto* player : failed_players) {
+        xlog::info("Kicking player {} because reliable packets could not be delivered", player->name.c_str());
+        rf::multi_kick_player(player);
+    }
+}
+
+void multi_reliable_transport_do_frame()
+{
+    if (rf::is_server) {
+        server_reliable_transport_do_frame();
+        return;
+    }
+    if (!g_reliable_receiver) {
+        return;
+    }
+    if (!rf::is_multi || !get_df_server_info()) {
+        g_reliable_receiver.reset();
+        return;
+    }
+    // Announce support until the server switches because unreliable packets can be lost
+    if (!g_reliable_switched && g_num_reliable_hellos < reliable_transport_max_hellos) {
+        int now = rf::timer_get(1000);
+        if (g_last_reliable_hello_ms == 0 || now - g_last_reliable_hello_ms >= 1000) {
+            g_last_reliable_hello_ms = now;
+            ++g_num_reliable_hellos;
+            send_df_packet(nullptr, df_packet_type::reliable_hello, nullptr, 0);
+        }
+    }
+    std::vector<std::byte> ack;
+    if (g_reliable_receiver.value().poll_ack(ack)) {
+        send_df_packet(nullptr, df_packet_type::reliable_ack, ack.data(), ack.size());
+    }
+}
@@ -18,7 +18,9 @@
 #include "../os/console.h"
 #include "../misc/player.h"
 #include "../main/main.h"
+#include "../object/object.h"
 #include <common/utils/list-utils.h>
+#include <common/utils/string-utils.h>
 #include "../rf/player/player.h"
 #include "../rf/multi.h"
 #include "../rf/parse.h"
@@ -29,6 +31,9 @@
 #include "../rf/level.h"
 #include "../rf/collide.h"
 #include "../purefaction/pf.h"
+#include "match_log.h"
+#include "cheat_detection.h"
+#include "net_telemetry.h"
 
 const char* g_rcon_cmd_whitelist[] = {
     "kick",
@@ -54,13 +59,13 @@ void parse_vote_config(const char* vote_name, VoteConfig& config, rf::Parser& pa
         config.enabled = parser.parse_bool();
         rf::console::print("DF {}: {}", vote_name, config.enabled ? "true" : "false");
 
-        // if (parser.ParseOptional("+Min Voters:")) {
-        //     config.min_voters = parser.ParseUInt();
-        // }
+        if (parser.parse_optional("+Min Voters:")) {
+            config.min_voters = parser.parse_uint();
+        }
 
-        // if (parser.ParseOptional("+Min Percentage:")) {
-        //     config.min_percentage = parser.ParseUInt();
-        // }
+        if (parser.parse_optional("+Min Percentage:")) {
+            config.min_percentage = std::min<int>(parser.parse_uint(), 100);
+        }
 
         if (parser.parse_optional("+Time Limit:")) {
             config.time_limit_seconds = parser.parse_uint();
@@ -203,6 +208,123 @@ void load_additional_server_config(rf::Parser& parser)
         }
     }
 
+    if (parser.parse_optional("$DF Network Stats Dump Interval:")) {
+        g_additional_server_config.net_stats_dump_interval_s = parser.parse_int();
+    }
+
+    if (parser.parse_optional("$DF Delta Object Updates:")) {
+        g_additional_server_config.obj_update_delta = parser.parse_bool();
+    }
+
+    if (parser.parse_optional("$DF Interest Management:")) {
+        auto& config = g_additional_server_config.interest_management;
+        config.enabled = parser.parse_bool();
+        if (parser.parse_optional("+Near Distance:")) {
+            config.near_distance = parser.parse_float();
+        }
+        if (parser.parse_optional("+Max Distance:")) {
+            config.max_distance = parser.parse_float();
+        }
+        if (parser.parse_optional("+Max Room Depth:")) {
+            config.max_room_depth = parser.parse_uint();
+        }
+        if (parser.parse_optional("+Reduced Update Interval:")) {
+            config.reduced_update_interval_ms = parser.parse_uint();
+        }
+        if (parser.parse_optional("+Refresh Interval:")) {
+            config.refresh_interval_ms = parser.parse_uint();
+        }
+    }
+
+    if (parser.parse_optional("$DF Coalesce Packets:")) {
+        g_additional_server_config.coalesce_packets = parser.parse_bool();
+    }
+
+    if (parser.parse_optional("$DF Adaptive Update Rate:")) {
+        auto& config = g_additional_server_config.adaptive_update_rate;
+        config.enabled = parser.parse_bool();
+        if (parser.parse_optional("+Min Rate:")) {
+            config.min_rate = std::clamp(static_cast<int>(parser.parse_uint()), 12, 60);
+        }
+        if (parser.parse_optional("+Max Rate:")) {
+            config.max_rate = std::clamp(static_cast<int>(parser.parse_uint()), config.min_rate, 60);
+        }
+        if (parser.parse_optional("+RTT Threshold:")) {
+            config.rtt_threshold_ms = std::max(static_cast<int>(parser.parse_uint()), 1);
+        }
+    }
+
+    if (parser.parse_optional("$DF Lag Compensation:")) {
+        auto& config = g_additional_server_config.lag_compensation;
+        config.enabled = parser.parse_bool();
+        if (parser.parse_optional("+Max Rewind:")) {
+            config.max_rewind_ms = std::min(static_cast<int>(parser.parse_uint()), 1000);
+        }
+        if (parser.parse_optional("+Interpolation Delay:")) {
+            config.interp_delay_ms = std::min(static_cast<int>(parser.parse_uint()), 1000);
+        }
+    }
+
+    if (parser.parse_optional("$DF Rate Limit:")) {
+        auto& config = g_additional_server_config.rate_limit;
+        config.enabled = parser.parse_bool();
+        if (parser.parse_optional("+Packets Per Second:")) {
+            config.packets_per_second = std::max(static_cast<int>(parser.parse_uint()), 1);
+        }
+        if (parser.parse_optional("+Unknown Packets Per Second:")) {
+            config.unknown_packets_per_second = std::max(static_cast<int>(parser.parse_uint()), 1);
+        }
+        if (parser.parse_optional("+Game Info Requests Per Second:")) {
+            config.game_info_requests_per_second = std::max(static_cast<int>(parser.parse_uint()), 1);
+        }
+        if (parser.parse_optional("+Join Requests Per Second:")) {
+            config.join_requests_per_second = std::max(static_cast<int>(parser.parse_uint()), 1);
+        }
+    }
+
+    if (parser.parse_optional("$DF Match Log:")) {
+        auto& config = g_additional_server_config.match_log;
+        config.enabled = parser.parse_bool();
+        if (parser.parse_optional("+Format:")) {
+            rf::String format;
+            parser.parse_string(&format);
+            config.csv = string_equals_ignore_case(format.c_str(), "csv");
+        }
+    }
+
+    if (parser.parse_optional("$DF Prefetch Next Level:")) {
+        g_additional_server_config.prefetch_next_level = parser.parse_bool();
+    }
+
+    if (parser.parse_optional("$DF Cheat Detection:")) {
+        auto& config = g_additional_server_config.cheat_detection;
+        config.enabled = parser.parse_bool();
+        if (parser.parse_optional("+Kick:")) {
+            config.kick = parser.parse_bool();
+        }
+        if (parser.parse_optional("+Max Speed Factor:")) {
+            config.max_speed_factor = parser.parse_float();
+        }
+        if (parser.parse_optional("+Teleport Distance:")) {
+            config.teleport_distance = parser.parse_float();
+        }
+        if (parser.parse_optional("+Snap Angle:")) {
+            config.snap_angle = parser.parse_float();
+        }
+    }
+
+    if (parser.parse_optional("$DF Reliable Transport:")) {
+        g_additional_server_config.reliable_transport = parser.parse_bool();
+    }
+
+    if (parser.parse_optional("$DF State Snapshot:")) {
+        auto& config = g_additional_server_config.state_snapshot;
+        config.enabled = parser.parse_bool();
+        if (parser.parse_optional("+Bytes Per Second:")) {
+            config.bytes_per_second = std::max<int>(parser.parse_uint(), 1000);
+        }
+    }
+
     if (!parser.parse_optional("$Name:") && !parser.parse_optional("#End")) {
         parser.error("end of server configuration");
     }
@@ -454,6 +576,8 @@ FunHook<float(rf::Entity*, float, int, int, int)> entity_damage_hook{
             auto* damaged_player_stats = static_cast<PlayerStatsNew*>(damaged_player->stats);
             damaged_player_stats->add_damage_received(real_damage);
 
+            match_log_damage(killer_player, damaged_player, real_damage, damage_type);
+
             if (g_additional_server_config.hit_sounds.enabled) {
                 send_hit_sound_packet(killer_player);
             }
@@ -564,6 +688,7 @@ CodeInjection multi_on_new_player_injection{
         in_addr addr;
         addr.S_un.S_addr = ntohl(player->net_data->addr.ip_addr);
         rf::console::print("{}{} ({})", player->name,  rf::strings::has_joined, inet_ntoa(addr));
+        match_log_player_join(player);
         regs.eip = 0x0047B051;
     },
 };
@@ -666,14 +791,21 @@ FunHook<int(rf::LevelCollisionOut*, rf::Weapon*)> multi_lag_comp_handle_hit_hook
         if (rf::is_server) {
             maybe_increment_weapon_hits_stat(col_info->obj_handle, wp);
         }
-        return multi_lag_comp_handle_hit_hook.call_target(col_info, wp);
+        int prev_damage_source_weapon_type = weapon_get_damage_source_type();
+        weapon_set_damage_source_type(wp->info_index);
+        int result = multi_lag_comp_handle_hit_hook.call_target(col_info, wp);
+        weapon_set_damage_source_type(prev_damage_source_weapon_type);
+        return result;
     },
 };
 
 FunHook<void(rf::Entity*, rf::Weapon*)> multi_lag_comp_weapon_fire_hook{
     0x0046F7E0,
     [](rf::Entity *ep, rf::Weapon *wp) {
-        multi_lag_comp_weapon_fire_hook.call_target(ep, wp);
+        // DF lag compensation replaces the engine one if it is enabled
+        if (!server_lag_comp_weapon_fire(ep, wp)) {
+            multi_lag_comp_weapon_fire_hook.call_target(ep, wp);
+        }
         rf::Player* pp = rf::player_from_entity_handle(ep->handle);
         if (pp && pp->stats) {
             auto* stats = static_cast<PlayerStatsNew*>(pp->stats);
@@ -704,12 +836,16 @@ CodeInjection multi_limbo_init_injection{
 CodeInjection multi_level_init_injection{
     0x0046E450,
     []() {
+        server_interest_level_init();
+        server_lag_comp_level_init();
+        match_log_level_start();
         if (g_additional_server_config.random_rotation && rf::netgame.current_level_index ==
                     rf::netgame.levels.size() - 1 && rf::netgame.levels.size() > 1) {
                 // if this is the last level in the list and dynamic rotation is on, shuffle
                 xlog::info("Reached end of level rotation, shuffling");
                 shuffle_level_array();
             }
+        server_level_prefetch_next();
     },
 };
 
@@ -740,6 +876,8 @@ void server_init()
     spawn_player_sync_ammo_hook.install();
 
     init_server_commands();
+    server_adaptive_update_rate_init();
+    server_lag_comp_init();
 
     // Remove level prefix restriction (dm/ctf) for 'level' command and dedicated_server.txt
     AsmWriter(0x004350FE).nop(2);
@@ -787,12 +925,19 @@ void server_do_frame()
 {
     server_vote_do_frame();
     process_delayed_kicks();
+    net_telemetry_do_frame();
+    server_adaptive_update_rate_do_frame();
+    server_lag_comp_do_frame();
+    multi_ban_do_frame();
+    match_log_do_frame();
+    cheat_detection_do_frame();
 }
 
 void server_on_limbo_state_enter()
 {
     g_prev_level = rf::level.filename.c_str();
     server_vote_on_limbo_state_enter();
+    match_log_level_end();
 
     // Clear save data for all players
     auto player_list = SinglyLinkedList{rf::player_list};
@@ -14,3 +14,4 @@ void server_reliable_socket_ready(rf::Player* player);
 bool server_weapon_items_give_full_ammo();
 const char* get_rand_level_filename();
 void shuffle_level_array();
+void server_level_prefetch_shutdown();
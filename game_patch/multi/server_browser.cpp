@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include <xlog/xlog.h>
+#include <patch_common/FunHook.h>
+#include <patch_common/MemUtils.h>
+#include <patch_common/ShortTypes.h>
+#include "multi.h"
+#include "multi_private.h"
+#include "../rf/multi.h"
+#include "../rf/gameseq.h"
+#include "../rf/os/timer.h"
+
+// Pacing of game_info requests sent by the server browser (requests per second and maximal burst). Engine delay
+// between requests is derived from the same rate so its per-server timeout starts close to the real send time. The
+// token bucket is still needed because retries are sent by DF and the engine does not know about them.
+constexpr float browser_query_rate = 100.0f;
+constexpr float browser_query_burst = 10.0f;
+// Time after which a request is sent again if there was no response
+constexpr int browser_query_retry_timeout_ms = 1000;
+// Query results older than this are not used for prioritizing servers
+constexpr int browser_history_ttl_ms = 10 * 60 * 1000;
+
+struct ServerBrowserQuery
+{
+    rf::NetAddr addr;
+    int sent_ms = 0;
+    int max_attempts = 1;
+    int attempts = 0;
+};
+
+// Only the outcome of the last query is kept. Server info and ping are not stored.
+struct ServerBrowserHistoryEntry
+{
+    int last_query_ms = 0;
+    bool responded = false;
+};
+
+class TokenBucket
+{
+public:
+    TokenBucket(float rate, float burst) : rate_(rate), burst_(burst), tokens_(burst) {}
+
+    void refill(int now)
+    {
+        if (last_refill_ms_ >= 0) {
+            tokens_ = std::min(burst_, tokens_ + rate_ * static_cast<float>(now - last_refill_ms_) / 1000.0f);
+        }
+        last_refill_ms_ = now;
+    }
+
+    bool take()
+    {
+        if (tokens_ < 1.0f) {
+            return false;
+        }
+        tokens_ -= 1.0f;
+        return true;
+    }
+
+private:
+    float rate_;
+    float burst_;
+    float tokens_;
+    int last_refill_ms_ = -1;
+};
+
+struct ServerBrowserStats
+{
+    int num_responded = 0;
+    int num_timed_out = 0;
+    int num_retries = 0;
+};
+
+static uint64_t make_net_addr_key(const rf::NetAddr& addr)
+{
+    return (static_cast<uint64_t>(addr.ip_addr) << 16) | addr.port;
+}
+
+static TokenBucket g_browser_query_bucket{browser_query_rate, browser_query_burst};
+// Servers that responded recently are queried first so the list fills up quickly
+static std::deque<ServerBrowserQuery> g_browser_pending_alive;
+static std::deque<ServerBrowserQuery> g_browser_pending_other;
+static std::vector<ServerBrowserQuery> g_browser_inflight;
+static std::unordered_map<uint64_t, ServerBrowserHistoryEntry> g_browser_history;
+static ServerBrowserStats g_browser_stats;
+
+FunHook<void(const rf::NetAddr&)> send_game_info_req_packet_hook{
+    0x0047B450,
+    [](const rf::NetAddr& addr) {
+        // Only pace requests sent by the server browser (not LAN broadcasts or requests sent after joining)
+        if (rf::gameseq_get_state() != rf::GS_MULTI_SERVER_LIST || addr.ip_addr == 0xFFFFFFFF) {
+            send_game_info_req_packet_hook.call_target(addr);
+            return;
+        }
+
+        auto same_addr = [&](const ServerBrowserQuery& q) { return q.addr == addr; };
+        if (std::any_of(g_browser_inflight.begin(), g_browser_inflight.end(), same_addr) ||
+            std::any_of(g_browser_pending_alive.begin(), g_browser_pending_alive.end(), same_addr) ||
+            std::any_of(g_browser_pending_other.begin(), g_browser_pending_other.end(), same_addr)) {
+            // Response to the already queued request is going to be used
+            return;
+        }
+
+        ServerBrowserQuery query;
+        query.addr = addr;
+        int now = rf::timer_get(1000);
+        auto it = g_browser_history.find(make_net_addr_key(addr));
+        bool known = it != g_browser_history.end() && now - it->second.last_query_ms < browser_history_ttl_ms;
+        if (known && it->second.responded) {
+            // Retry servers that were alive during the last refresh. Servers that did not respond last time only
+            // get a single attempt so they do not slow the refresh down.
+            query.max_attempts = 2;
+            g_browser_pending_alive.push_back(query);
+        }
+        else {
+            query.max_attempts = known ? 1 : 2;
+            g_browser_pending_other.push_back(query);
+        }
+    },
+};
+
+void server_browser_on_game_info(const rf::NetAddr& addr)
+{
+    auto it = std::find_if(g_browser_inflight.begin(), g_browser_inflight.end(), [&](const auto& q) {
+        return q.addr == addr;
+    });
+    if (it == g_browser_inflight.end()) {
+        return;
+    }
+    int now = rf::timer_get(1000);
+    auto& entry = g_browser_history[make_net_addr_key(addr)];
+    entry.last_query_ms = now;
+    entry.responded = true;
+    ++g_browser_stats.num_responded;
+    g_browser_inflight.erase(it);
+}
+
+static void send_browser_query(ServerBrowserQuery query, int now)
+{
+    query.sent_ms = now;
+    ++query.attempts;
+    send_game_info_req_packet_hook.call_target(query.addr);
+    g_browser_inflight.push_back(query);
+}
+
+void multi_server_browser_do_frame()
+{
+    if (g_browser_inflight.empty() && g_browser_pending_alive.empty() && g_browser_pending_other.empty()) {
+        return;
+    }
+    int now = rf::timer_get(1000);
+    if (rf::gameseq_get_state() != rf::GS_MULTI_SERVER_LIST) {
+        // Browser was closed
+        g_browser_inflight.clear();
+        g_browser_pending_alive.clear();
+        g_browser_pending_other.clear();
+        return;
+    }
+
+    // Retry or give up on requests without a response
+    std::deque<ServerBrowserQuery> retries;
+    std::erase_if(g_browser_inflight, [&](const ServerBrowserQuery& query) {
+        if (now - query.sent_ms < browser_query_retry_timeout_ms) {
+            return false;
+        }
+        if (query.attempts < query.max_attempts) {
+            retries.push_back(query);
+            ++g_browser_stats.num_retries;
+        }
+        else {
+            auto& entry = g_browser_history[make_net_addr_key(query.addr)];
+            entry.last_query_ms = now;
+            entry.responded = false;
+            ++g_browser_stats.num_timed_out;
+        }
+        return true;
+    });
+
+    g_browser_query_bucket.refill(now);
+    while (!retries.empty() && g_browser_query_bucket.take()) {
+        send_browser_query(retries.front(), now);
+        retries.pop_front();
+    }
+    // Retries that did not get a token go first in the next frame
+    g_browser_pending_alive.insert(g_browser_pending_alive.begin(), retries.begin(), retries.end());
+    while (!g_browser_pending_alive.empty() && g_browser_query_bucket.take()) {
+        send_browser_query(g_browser_pending_alive.front(), now);
+        g_browser_pending_alive.pop_front();
+    }
+    while (!g_browser_pending_other.empty() && g_browser_query_bucket.take()) {
+        send_browser_query(g_browser_pending_other.front(), now);
+        g_browser_pending_other.pop_front();
+    }
+
+    if (g_browser_inflight.empty() && g_browser_pending_alive.empty() && g_browser_pending_other.empty()) {
+        xlog::debug("Server browser queries finished: {} responded, {} timed out, {} retries",
+            g_browser_stats.num_responded, g_browser_stats.num_timed_out, g_browser_stats.num_retries);
+        g_browser_stats = {};
+    }
+}
+
+void server_browser_apply_patch()
+{
+    // Improve simultaneous ping
+    rf::simultaneous_ping = 64;
+
+    // Change server info timeout to 3s (requests are paced and retried once)
+    write_mem<u32>(0x0044D357 + 2, 3000);
+
+    // Change delay between server info requests to match the pacing rate
+    write_mem<u8>(0x0044D338 + 1, static_cast<u8>(1000.0f / browser_query_rate));
+
+    send_game_info_req_packet_hook.install();
+}
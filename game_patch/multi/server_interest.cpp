@@ -0,0 +1,201 @@
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include <common/net/ObjUpdateDelta.h>
+#include <common/rfproto.h>
+#include <common/utils/list-utils.h>
+#include <xlog/xlog.h>
+#include "../rf/multi.h"
+#include "../rf/entity.h"
+#include "../rf/object.h"
+#include "../rf/level.h"
+#include "../rf/geometry.h"
+#include "../rf/player/player.h"
+#include "../rf/os/timer.h"
+#include "../misc/player.h"
+#include "server_internal.h"
+
+// Room connectivity graph of the current level. Portal data is not mapped so rooms are considered connected if their
+// bounding boxes touch which is true for all rooms connected by a portal.
+class RoomGraph
+{
+public:
+    void build(rf::GSolid* geometry)
+    {
+        room_indices_.clear();
+        neighbours_.clear();
+        hops_cache_.clear();
+        geometry_ = geometry;
+        if (!geometry) {
+            return;
+        }
+
+        auto& rooms = geometry->all_rooms;
+        neighbours_.resize(rooms.size());
+        for (int i = 0; i < rooms.size(); ++i) {
+            room_indices_[rooms[i]] = i;
+        }
+        constexpr float epsilon = 0.01f;
+        for (int i = 0; i < rooms.size(); ++i) {
+            for (int j = i + 1; j < rooms.size(); ++j) {
+                const auto& a = *rooms[i];
+                const auto& b = *rooms[j];
+                if (a.bbox_min.x <= b.bbox_max.x + epsilon && b.bbox_min.x <= a.bbox_max.x + epsilon &&
+                    a.bbox_min.y <= b.bbox_max.y + epsilon && b.bbox_min.y <= a.bbox_max.y + epsilon &&
+                    a.bbox_min.z <= b.bbox_max.z + epsilon && b.bbox_min.z <= a.bbox_max.z + epsilon) {
+                    neighbours_[i].push_back(j);
+                    neighbours_[j].push_back(i);
+                }
+            }
+        }
+        xlog::debug("Built room graph for interest management: {} rooms", rooms.size());
+    }
+
+    [[nodiscard]] rf::GSolid* geometry() const
+    {
+        return geometry_;
+    }
+
+    // Returns number of rooms that must be crossed to get from one room to another (255 if not connected)
+    int get_hops(const rf::GRoom* from, const rf::GRoom* to)
+    {
+        auto from_it = room_indices_.find(from);
+        auto to_it = room_indices_.find(to);
+        if (from_it == room_indices_.end() || to_it == room_indices_.end()) {
+            return 0;
+        }
+        auto& hops = hops_cache_[from_it->second];
+        if (hops.empty()) {
+            compute_hops(from_it->second, hops);
+        }
+        return hops[to_it->second];
+    }
+
+private:
+    void compute_hops(int from, std::vector<uint8_t>& hops)
+    {
+        hops.assign(neighbours_.size(), 255);
+        hops[from] = 0;
+        std::deque<int> queue{from};
+        while (!queue.empty()) {
+            int room = queue.front();
+            queue.pop_front();
+            if (hops[room] == 254) {
+                continue;
+            }
+            for (int neighbour : neighbours_[room]) {
+                if (hops[neighbour] == 255) {
+                    hops[neighbour] = hops[room] + 1;
+                    queue.push_back(neighbour);
+                }
+            }
+        }
+    }
+
+    rf::GSolid* geometry_ = nullptr;
+    std::unordered_map<const rf::GRoom*, int> room_indices_;
+    std::vector<std::vector<int>> neighbours_;
+    std::unordered_map<int, std::vector<uint8_t>> hops_cache_;
+};
+
+static RoomGraph g_room_graph;
+
+static int get_obj_update_interval(rf::Entity* viewer, rf::Object* obj)
+{
+    const auto& config = server_get_df_config().interest_management;
+    if (!obj || obj == viewer) {
+        return 0;
+    }
+    float dist = (obj->pos - viewer->pos).len();
+    if (dist <= config.near_distance) {
+        return 0;
+    }
+    int hops = 0;
+    if (viewer->room && obj->room) {
+        hops = g_room_graph.get_hops(viewer->room, obj->room);
+    }
+    if (hops <= config.max_room_depth && dist <= config.max_distance) {
+        return 0;
+    }
+    if (hops <= config.max_room_depth * 2 || dist <= config.max_distance) {
+        return config.reduced_update_interval_ms;
+    }
+    return config.refresh_interval_ms;
+}
+
+bool server_interest_filter_obj_update(rf::Player* player, const void* data, int len, std::vector<std::byte>& out)
+{
+    if (!server_get_df_config().interest_management.enabled) {
+        return false;
+    }
+
+    RF_GamePacketHeader header;
+    if (len < static_cast<int>(sizeof(header))) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.type != RF_GPT_OBJECT_UPDATE || sizeof(header) + header.size != static_cast<size_t>(len)) {
+        return false;
+    }
+
+    // Send everything to players without an entity (e.g. spectators)
+    rf::Entity* viewer = rf::entity_from_handle(player->entity_handle);
+    if (!viewer) {
+        return false;
+    }
+
+    auto payload = static_cast<const std::byte*>(data) + sizeof(header);
+    std::vector<ObjUpdateEntryView> entries;
+    if (!obj_update_split(payload, header.size, entries)) {
+        return false;
+    }
+
+    // Graph is built when the level is initialized
+    if (g_room_graph.geometry() != rf::level.geometry) {
+        return false;
+    }
+
+    int now = rf::timer_get(1000);
+    auto& last_sent = get_player_additional_data(player).obj_update_last_sent_ms;
+    out.assign(static_cast<const std::byte*>(data), payload);
+    int num_skipped = 0;
+    for (const auto& entry : entries) {
+        // Only position updates can be thinned out - other fields (e.g. firing, weapon switch or health change) are
+        // sent only once so entries containing them are always forwarded
+        if (entry.flags != RF_OUF_POS_ROT_ANIM) {
+            if (entry.flags & RF_OUF_POS_ROT_ANIM) {
+                last_sent[entry.handle] = now;
+            }
+            out.insert(out.end(), payload + entry.offset, payload + entry.offset + entry.size);
+            continue;
+        }
+        int interval = get_obj_update_interval(viewer, rf::obj_from_handle(static_cast<int>(entry.handle)));
+        auto it = last_sent.find(entry.handle);
+        if (interval > 0 && it != last_sent.end() && now - it->second < interval) {
+            ++num_skipped;
+            continue;
+        }
+        last_sent[entry.handle] = now;
+        out.insert(out.end(), payload + entry.offset, payload + entry.offset + entry.size);
+    }
+    if (num_skipped == 0) {
+        return false;
+    }
+
+    // Terminator
+    out.insert(out.end(), payload + header.size - sizeof(uint32_t), payload + header.size);
+    header.size = static_cast<uint16_t>(out.size() - sizeof(header));
+    std::memcpy(out.data(), &header, sizeof(header));
+    return true;
+}
+
+void server_interest_level_init()
+{
+    // Room pointers and object handles from the previous level are no longer valid. Building the graph is too
+    // expensive to be done when sending packets.
+    g_room_graph.build(server_get_df_config().interest_management.enabled ? rf::level.geometry : nullptr);
+    for (auto& player : SinglyLinkedList{rf::player_list}) {
+        get_player_additional_data(&player).obj_update_last_sent_ms.clear();
+    }
+}
@@ -4,18 +4,21 @@
 #include <string>
 #include <map>
 #include <optional>
+#include <vector>
 
 // Forward declarations
 namespace rf
 {
     struct Player;
+    struct Entity;
+    struct Weapon;
 }
 
 struct VoteConfig
 {
     bool enabled = false;
-    // int min_voters = 1;
-    // int min_percentage = 50;
+    int min_voters = 1;
+    int min_percentage = 50;
     int time_limit_seconds = 60;
 };
 
@@ -26,6 +29,61 @@ struct HitSoundsConfig
     int rate_limit = 10;
 };
 
+struct InterestManagementConfig
+{
+    bool enabled = false;
+    float near_distance = 20.0f;
+    float max_distance = 150.0f;
+    int max_room_depth = 2;
+    int reduced_update_interval_ms = 250;
+    int refresh_interval_ms = 1000;
+};
+
+struct AdaptiveUpdateRateConfig
+{
+    bool enabled = false;
+    int min_rate = 12;
+    int max_rate = 60;
+    int rtt_threshold_ms = 80;
+};
+
+struct LagCompensationConfig
+{
+    bool enabled = false;
+    int max_rewind_ms = 200;
+    int interp_delay_ms = 0;
+};
+
+struct RateLimitConfig
+{
+    bool enabled = false;
+    int packets_per_second = 500;
+    int unknown_packets_per_second = 20;
+    int game_info_requests_per_second = 2;
+    int join_requests_per_second = 1;
+};
+
+struct MatchLogConfig
+{
+    bool enabled = false;
+    bool csv = false;
+};
+
+struct StateSnapshotConfig
+{
+    bool enabled = false;
+    int bytes_per_second = 64000;
+};
+
+struct CheatDetectionConfig
+{
+    bool enabled = false;
+    bool kick = false;
+    float max_speed_factor = 1.5f;
+    float teleport_distance = 10.0f;
+    float snap_angle = 45.0f;
+};
+
 struct ServerAdditionalConfig
 {
     VoteConfig vote_kick;
@@ -59,6 +117,18 @@ struct ServerAdditionalConfig
     float kill_reward_effective_health = 0.0f;
     bool kill_reward_health_super = false;
     bool kill_reward_armor_super = false;
+    int net_stats_dump_interval_s = 0;
+    bool obj_update_delta = false;
+    InterestManagementConfig interest_management;
+    AdaptiveUpdateRateConfig adaptive_update_rate;
+    bool coalesce_packets = false;
+    LagCompensationConfig lag_compensation;
+    RateLimitConfig rate_limit;
+    MatchLogConfig match_log;
+    bool prefetch_next_level = false;
+    CheatDetectionConfig cheat_detection;
+    StateSnapshotConfig state_snapshot;
+    bool reliable_transport = false;
 };
 
 extern ServerAdditionalConfig g_additional_server_config;
@@ -76,3 +146,17 @@ void load_prev_level();
 void server_vote_on_limbo_state_enter();
 void process_delayed_kicks();
 const ServerAdditionalConfig& server_get_df_config();
+bool server_interest_filter_obj_update(rf::Player* player, const void* data, int len, std::vector<std::byte>& out);
+void server_interest_level_init();
+void server_adaptive_update_rate_init();
+void server_adaptive_update_rate_do_frame();
+void server_update_player_net_conditions(rf::Player& player);
+bool server_adaptive_update_rate_filter_obj_update(rf::Player* player, const void* data, int len,
+    std::vector<std::byte>& out);
+int server_get_obj_update_rate(int default_rate);
+void server_lag_comp_init();
+void server_lag_comp_do_frame();
+void server_lag_comp_level_init();
+bool server_lag_comp_weapon_fire(rf::Entity* shooter, rf::Weapon* wp);
+
+void server_level_prefetch_next();
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include <common/utils/list-utils.h>
+#include <xlog/xlog.h>
+#include "../rf/multi.h"
+#include "../rf/entity.h"
+#include "../rf/weapon.h"
+#include "../rf/collide.h"
+#include "../rf/player/player.h"
+#include "../rf/os/timer.h"
+#include "../os/console.h"
+#include "../misc/player.h"
+#include "server_internal.h"
+
+// Number of samples kept for every entity (server frame rate is limited so this covers about one second)
+constexpr std::size_t lag_comp_history_size = 64;
+// Samples are not recorded more often than this to keep the history long enough on servers with high frame rate
+constexpr int lag_comp_min_sample_interval_ms = 10;
+
+struct LagCompSample
+{
+    int time_ms;
+    rf::Vector3 pos;
+    rf::Matrix3 orient;
+};
+
+// Fixed-size ring of entity positions ordered by time
+class LagCompHistory
+{
+public:
+    void add(const LagCompSample& sample)
+    {
+        if (count_ > 0 && sample.time_ms - newest().time_ms < lag_comp_min_sample_interval_ms) {
+            return;
+        }
+        samples_[(start_ + count_) % samples_.size()] = sample;
+        if (count_ < samples_.size()) {
+            ++count_;
+        }
+        else {
+            start_ = (start_ + 1) % samples_.size();
+        }
+    }
+
+    // Returns position at given time interpolated from the two closest samples. Time is clamped to the history range.
+    [[nodiscard]] std::optional<LagCompSample> get(int time_ms) const
+    {
+        if (count_ == 0) {
+            return {};
+        }
+        if (time_ms >= newest().time_ms) {
+            return {newest()};
+        }
+        if (time_ms <= at(0).time_ms) {
+            return {at(0)};
+        }
+        // Binary search for the first sample newer than the requested time
+        std::size_t lo = 1;
+        std::size_t hi = count_ - 1;
+        while (lo < hi) {
+            std::size_t mid = (lo + hi) / 2;
+            if (at(mid).time_ms <= time_ms) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        const auto& a = at(lo - 1);
+        const auto& b = at(lo);
+        float t = static_cast<float>(time_ms - a.time_ms) / static_cast<float>(b.time_ms - a.time_ms);
+        LagCompSample result;
+        result.time_ms = time_ms;
+        result.pos = a.pos + (b.pos - a.pos) * t;
+        // Orientation only affects mesh collisions and changes little between samples so it is not interpolated
+        result.orient = t < 0.5f ? a.orient : b.orient;
+        return {result};
+    }
+
+    [[nodiscard]] const LagCompSample& newest() const
+    {
+        return at(count_ - 1);
+    }
+
+private:
+    [[nodiscard]] const LagCompSample& at(std::size_t index) const
+    {
+        return samples_[(start_ + index) % samples_.size()];
+    }
+
+    std::array<LagCompSample, lag_comp_history_size> samples_;
+    std::size_t start_ = 0;
+    std::size_t count_ = 0;
+};
+
+struct RewoundEntity
+{
+    rf::Entity* entity;
+    rf::Vector3 pos;
+    rf::Matrix3 orient;
+    rf::Vector3 p_data_pos;
+    rf::Vector3 p_data_next_pos;
+    rf::Matrix3 p_data_orient;
+    rf::Matrix3 p_data_next_orient;
+    rf::Vector3 bbox_min;
+    rf::Vector3 bbox_max;
+};
+
+static std::unordered_map<int, LagCompHistory> g_lag_comp_histories;
+static std::vector<RewoundEntity> g_rewound_entities;
+
+void server_lag_comp_do_frame()
+{
+    if (!server_get_df_config().lag_compensation.enabled) {
+        return;
+    }
+    int now = rf::timer_get(1000);
+    for (auto& player : SinglyLinkedList{rf::player_list}) {
+        if (player.net_data && &player != rf::local_player) {
+            server_update_player_net_conditions(player);
+        }
+        rf::Entity* entity = rf::entity_from_handle(player.entity_handle);
+        if (entity) {
+            g_lag_comp_histories[entity->handle].add({now, entity->pos, entity->orient});
+        }
+    }
+    // Forget entities that no longer exist (e.g. players that died or left)
+    std::erase_if(g_lag_comp_histories, [](const auto& p) {
+        return rf::entity_from_handle(p.first) == nullptr;
+    });
+}
+
+static void move_entity(rf::Entity* entity, const rf::Vector3& pos, const rf::Matrix3& orient)
+{
+    rf::Vector3 delta = pos - entity->pos;
+    entity->pos = pos;
+    entity->orient = orient;
+    entity->p_data.pos = pos;
+    entity->p_data.next_pos = pos;
+    entity->p_data.orient = orient;
+    entity->p_data.next_orient = orient;
+    entity->p_data.bbox_min += delta;
+    entity->p_data.bbox_max += delta;
+}
+
+static int get_rewind_ms(rf::Entity* shooter)
+{
+    const auto& config = server_get_df_config().lag_compensation;
+    if (!config.enabled || !rf::is_server) {
+        return 0;
+    }
+    rf::Player* shooter_player = rf::player_from_entity_handle(shooter->handle);
+    if (!shooter_player || shooter_player == rf::local_player) {
+        return 0;
+    }
+    const auto& state = get_player_additional_data(shooter_player).adaptive_update_rate;
+    if (state.last_ping < 0) {
+        return 0;
+    }
+    // Shooter sees other entities as they were one round trip ago (half of it for the state to reach the client and
+    // half for the weapon_fire packet to come back) plus client interpolation delay
+    return std::clamp(static_cast<int>(state.rtt_ms) + config.interp_delay_ms, 0, config.max_rewind_ms);
+}
+
+static void rewind(rf::Entity* shooter, int rewind_ms)
+{
+    int view_time = rf::timer_get(1000) - rewind_ms;
+    for (auto& [handle, history] : g_lag_comp_histories) {
+        if (handle == shooter->handle) {
+            continue;
+        }
+        rf::Entity* entity = rf::entity_from_handle(handle);
+        auto sample = history.get(view_time);
+        if (!entity || !sample) {
+            continue;
+        }
+        g_rewound_entities.push_back({entity, entity->pos, entity->orient, entity->p_data.pos, entity->p_data.next_pos,
+            entity->p_data.orient, entity->p_data.next_orient, entity->p_data.bbox_min, entity->p_data.bbox_max});
+        move_entity(entity, sample.value().pos, sample.value().orient);
+    }
+}
+
+static void restore()
+{
+    for (auto& rewound : g_rewound_entities) {
+        auto* entity = rewound.entity;
+        entity->pos = rewound.pos;
+        entity->orient = rewound.orient;
+        entity->p_data.pos = rewound.p_data_pos;
+        entity->p_data.next_pos = rewound.p_data_next_pos;
+        entity->p_data.orient = rewound.p_data_orient;
+        entity->p_data.next_orient = rewound.p_data_next_orient;
+        entity->p_data.bbox_min = rewound.bbox_min;
+        entity->p_data.bbox_max = rewound.bbox_max;
+    }
+    g_rewound_entities.clear();
+}
+
+bool server_lag_comp_weapon_fire(rf::Entity* shooter, rf::Weapon* wp)
+{
+    // Engine calls this only for weapons with bullets. It traces the part of the bullet path flown during the shooter
+    // latency against current positions of targets. Replace it with a trace against targets moved back to the time
+    // seen by the shooter.
+    int rewind_ms = get_rewind_ms(shooter);
+    if (rewind_ms <= 0 || !wp->info) {
+        return false;
+    }
+    float time = std::min(static_cast<float>(rewind_ms) / 1000.0f, wp->lifeleft_seconds);
+    rf::Vector3 p0 = wp->pos;
+    rf::Vector3 p1 = p0 + wp->p_data.vel * time;
+    rf::LevelCollisionOut col_info;
+    col_info.face = nullptr;
+    col_info.obj_handle = -1;
+
+    rewind(shooter, rewind_ms);
+    bool hit = rf::collide_linesegment_level_for_multi(p0, p1, shooter, wp, &col_info, 0.0f, false,
+        wp->info->multi_bbox_size_factor);
+    xlog::trace("Rewound {} entities by {} ms for weapon fired by {}: {}", g_rewound_entities.size(), rewind_ms,
+        shooter->name.c_str(), hit ? "hit" : "miss");
+    restore();
+
+    if (hit) {
+        rf::multi_lag_comp_handle_hit(&col_info, wp);
+    }
+    else {
+        // Continue from the point the bullet has reached on the shooter screen so it cannot hit anything twice
+        wp->pos = p1;
+        wp->p_data.pos = p1;
+        wp->p_data.next_pos = p1;
+        wp->lifeleft_seconds -= time;
+    }
+    return true;
+}
+
+void server_lag_comp_level_init()
+{
+    // Entity handles from the previous level are no longer valid
+    g_lag_comp_histories.clear();
+}
+
+ConsoleCommand2 lag_comp_cmd{
+    "lag_comp",
+    []() {
+        const auto& config = server_get_df_config().lag_compensation;
+        if (!rf::is_server || !config.enabled) {
+            rf::console::print("Lag compensation is not enabled");
+            return;
+        }
+        for (auto& player : SinglyLinkedList{rf::player_list}) {
+            if (&player == rf::local_player) {
+                continue;
+            }
+            const auto& state = get_player_additional_data(&player).adaptive_update_rate;
+            if (state.last_ping < 0) {
+                rf::console::print("{}: RTT n/a, rewind n/a", player.name.c_str());
+                continue;
+            }
+            int rewind_ms = std::min(static_cast<int>(state.rtt_ms) + config.interp_delay_ms, config.max_rewind_ms);
+            rf::console::print("{}: RTT {:.0f} ms, rewind {} ms", player.name.c_str(), state.rtt_ms, rewind_ms);
+        }
+    },
+    "Prints how far back in time targets are moved when each player fires",
+};
+
+void server_lag_comp_init()
+{
+    lag_comp_cmd.register_cmd();
+}
@@ -0,0 +1,110 @@
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <xlog/xlog.h>
+#include "../rf/multi.h"
+#include "../misc/vpackfile.h"
+#include "server.h"
+#include "server_internal.h"
+
+// Data is read in chunks so the prefetch can be aborted quickly
+constexpr std::size_t level_prefetch_chunk_size = 1024 * 1024;
+
+class LevelPrefetcher
+{
+public:
+    void start(std::string level_filename, std::vector<VPackfileRange> ranges)
+    {
+        stop();
+        abort_ = false;
+        thread_ = std::thread{[this, level_filename = std::move(level_filename), ranges = std::move(ranges)]() {
+            thread_proc(level_filename, ranges);
+        }};
+    }
+
+    void stop()
+    {
+        if (thread_.joinable()) {
+            abort_ = true;
+            thread_.join();
+        }
+    }
+
+private:
+    void thread_proc(const std::string& level_filename, const std::vector<VPackfileRange>& ranges)
+    {
+        // Use low CPU and I/O priority so the prefetch does not slow down the running level
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<char> buf(level_prefetch_chunk_size);
+        std::size_t total_bytes = 0;
+        for (const auto& range : ranges) {
+            if (abort_) {
+                break;
+            }
+            total_bytes += read_range(range, buf);
+        }
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        xlog::info("Prefetched {} ({} KB) in {} ms{}", level_filename, total_bytes / 1024, elapsed.count(),
+            abort_ ? " (aborted)" : "");
+    }
+
+    std::size_t read_range(const VPackfileRange& range, std::vector<char>& buf)
+    {
+        // Reading the data is enough to put it into the system file cache. It is read again by the engine when the
+        // level is loaded but that does not touch the disk anymore.
+        HANDLE file = CreateFileA(range.path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            xlog::warn("Cannot open {} for prefetching", range.path);
+            return 0;
+        }
+        LARGE_INTEGER offset;
+        offset.QuadPart = static_cast<LONGLONG>(range.offset);
+        std::size_t bytes_read = 0;
+        if (SetFilePointerEx(file, offset, nullptr, FILE_BEGIN)) {
+            while (bytes_read < range.size && !abort_) {
+                DWORD to_read = static_cast<DWORD>(std::min(range.size - bytes_read, buf.size()));
+                DWORD n = 0;
+                if (!ReadFile(file, buf.data(), to_read, &n, nullptr) || n == 0) {
+                    break;
+                }
+                bytes_read += n;
+            }
+        }
+        CloseHandle(file);
+        return bytes_read;
+    }
+
+    std::thread thread_;
+    std::atomic<bool> abort_{false};
+};
+
+static LevelPrefetcher g_level_prefetcher;
+
+void server_level_prefetch_next()
+{
+    if (!rf::is_server || !server_get_df_config().prefetch_next_level || rf::netgame.levels.size() <= 1) {
+        return;
+    }
+    // Random rotation shuffles the level list before the last level is started so the next index is already correct
+    int next_idx = (rf::netgame.current_level_index + 1) % rf::netgame.levels.size();
+    const char* next_level = rf::netgame.levels[next_idx].c_str();
+    auto ranges = vpackfile_get_level_file_ranges(next_level);
+    if (ranges.empty()) {
+        xlog::warn("Cannot prefetch level {}", next_level);
+        return;
+    }
+    xlog::debug("Prefetching next level {} ({} ranges)", next_level, ranges.size());
+    g_level_prefetcher.start(next_level, std::move(ranges));
+}
+
+void server_level_prefetch_shutdown()
+{
+    g_level_prefetcher.stop();
+}
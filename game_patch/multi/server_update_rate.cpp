@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <common/net/ObjUpdateDelta.h>
+#include <common/rfproto.h>
+#include <common/utils/list-utils.h>
+#include "../rf/multi.h"
+#include "../rf/player/player.h"
+#include "../rf/os/timer.h"
+#include "../os/console.h"
+#include "../misc/player.h"
+#include "server_internal.h"
+
+// How often the update rate is recalculated
+constexpr int adjust_interval_ms = 1000;
+// Loss ratio and jitter above which the rate is reduced even if latency is fine
+constexpr float max_loss = 0.05f;
+constexpr float max_jitter_ms = 40.0f;
+// Rate increase per adjustment step (updates per second)
+constexpr float rate_increase_step = 4.0f;
+constexpr float rate_decrease_factor = 0.75f;
+
+static float get_target_update_rate(const AdaptiveUpdateRateConfig& config, float rtt_ms)
+{
+    // High latency clients do not benefit from frequent updates and get more jitter from them (see update_rate)
+    float target = static_cast<float>(config.max_rate);
+    if (rtt_ms > config.rtt_threshold_ms) {
+        target = target * config.rtt_threshold_ms / rtt_ms;
+    }
+    return std::clamp(target, static_cast<float>(config.min_rate), static_cast<float>(config.max_rate));
+}
+
+// Used by adaptive update rate and lag compensation. Only new ping values are sampled so it can be called more than
+// once per frame.
+void server_update_player_net_conditions(rf::Player& player)
+{
+    auto& state = get_player_additional_data(&player).adaptive_update_rate;
+    int ping = player.net_data->ping;
+    if (ping > 0 && ping != state.last_ping) {
+        // Smoothed RTT and jitter estimation similar to TCP
+        auto sample = static_cast<float>(ping);
+        if (state.last_ping < 0) {
+            state.rtt_ms = sample;
+            state.jitter_ms = 0.0f;
+        }
+        else {
+            state.jitter_ms += (std::fabs(sample - state.rtt_ms) - state.jitter_ms) * 0.25f;
+            state.rtt_ms += (sample - state.rtt_ms) * 0.125f;
+        }
+        state.last_ping = ping;
+    }
+    state.loss = std::clamp(player.net_data->obj_update_packet_loss, 0.0f, 1.0f);
+}
+
+static void update_player_update_rate(rf::Player& player, int now)
+{
+    const auto& config = server_get_df_config().adaptive_update_rate;
+    auto& state = get_player_additional_data(&player).adaptive_update_rate;
+    server_update_player_net_conditions(player);
+    if (state.last_ping < 0 || now - state.last_adjust_ms < adjust_interval_ms) {
+        return;
+    }
+    state.last_adjust_ms = now;
+
+    float target = get_target_update_rate(config, state.rtt_ms);
+    if (state.update_rate <= 0.0f) {
+        state.update_rate = target;
+    }
+    else if (state.loss > max_loss || state.jitter_ms > max_jitter_ms) {
+        state.update_rate *= rate_decrease_factor;
+    }
+    else {
+        state.update_rate += rate_increase_step;
+    }
+    state.update_rate = std::clamp(std::min(state.update_rate, target), static_cast<float>(config.min_rate),
+        static_cast<float>(config.max_rate));
+}
+
+void server_adaptive_update_rate_do_frame()
+{
+    if (!server_get_df_config().adaptive_update_rate.enabled) {
+        return;
+    }
+    int now = rf::timer_get(1000);
+    for (auto& player : SinglyLinkedList{rf::player_list}) {
+        if (player.net_data && &player != rf::local_player) {
+            update_player_update_rate(player, now);
+        }
+    }
+}
+
+bool server_adaptive_update_rate_filter_obj_update(rf::Player* player, const void* data, int len,
+    std::vector<std::byte>& out)
+{
+    const auto& config = server_get_df_config().adaptive_update_rate;
+    if (!config.enabled || len < static_cast<int>(sizeof(RF_GamePacketHeader))) {
+        return false;
+    }
+    RF_GamePacketHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.type != RF_GPT_OBJECT_UPDATE || sizeof(header) + header.size != static_cast<size_t>(len)) {
+        return false;
+    }
+
+    auto& state = get_player_additional_data(player).adaptive_update_rate;
+    if (state.update_rate <= 0.0f) {
+        return false;
+    }
+    // Engine generates updates at the max rate so allow half of its interval of tolerance
+    int now = rf::timer_get(1000);
+    int interval = static_cast<int>(1000.0f / state.update_rate);
+    int tolerance = 1000 / config.max_rate / 2;
+    if (now - state.last_obj_update_ms >= interval - tolerance) {
+        state.last_obj_update_ms = now;
+        return false;
+    }
+
+    auto payload = static_cast<const std::byte*>(data) + sizeof(header);
+    std::vector<ObjUpdateEntryView> entries;
+    if (!obj_update_split(payload, header.size, entries)) {
+        return false;
+    }
+    // Only position updates are throttled. Other fields (e.g. firing, weapon switch or health change) are sent only
+    // once so entries containing them are always forwarded.
+    out.assign(static_cast<const std::byte*>(data), payload);
+    bool empty = true;
+    for (const auto& entry : entries) {
+        if (entry.flags != RF_OUF_POS_ROT_ANIM) {
+            out.insert(out.end(), payload + entry.offset, payload + entry.offset + entry.size);
+            empty = false;
+        }
+    }
+    if (empty) {
+        // Nothing left to send
+        out.clear();
+        return true;
+    }
+    // Terminator
+    out.insert(out.end(), payload + header.size - sizeof(uint32_t), payload + header.size);
+    header.size = static_cast<uint16_t>(out.size() - sizeof(header));
+    std::memcpy(out.data(), &header, sizeof(header));
+    return true;
+}
+
+int server_get_obj_update_rate(int default_rate)
+{
+    const auto& config = server_get_df_config().adaptive_update_rate;
+    return config.enabled ? config.max_rate : default_rate;
+}
+
+ConsoleCommand2 update_rates_cmd{
+    "update_rates",
+    []() {
+        if (!rf::is_server || !server_get_df_config().adaptive_update_rate.enabled) {
+            rf::console::print("Adaptive update rate is not enabled");
+            return;
+        }
+        for (auto& player : SinglyLinkedList{rf::player_list}) {
+            const auto& state = get_player_additional_data(&player).adaptive_update_rate;
+            rf::console::print("{}: {:.1f} updates/s, RTT {:.0f} ms, jitter {:.0f} ms, loss {:.1f}%",
+                player.name.c_str(), state.update_rate, state.rtt_ms, state.jitter_ms, state.loss * 100.0f);
+        }
+    },
+    "Prints object update rate chosen for each player by the adaptive update rate controller",
+};
+
+void server_adaptive_update_rate_init()
+{
+    update_rates_cmd.register_cmd();
+}
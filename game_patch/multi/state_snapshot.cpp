@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <common/net/StateSnapshot.h>
+#include <common/utils/list-utils.h>
+#include <patch_common/FunHook.h>
+#include <xlog/xlog.h>
+#include "../rf/multi.h"
+#include "../rf/gameseq.h"
+#include "../rf/player/player.h"
+#include "../rf/os/console.h"
+#include "../rf/os/timer.h"
+#include "../misc/player.h"
+#include "multi.h"
+#include "multi_private.h"
+#include "server_internal.h"
+#include "df_packets.h"
+
+extern FunHook<void(rf::Player*, const void*, int, int)> multi_io_send_reliable_hook;
+
+// Client-side state of the snapshot being received from a server that supports it
+static bool g_state_snapshot_enabled = false;
+// Set when the first chunk or the whole level state sent by the stock handler arrives
+static bool g_level_state_received = false;
+static int g_num_state_snapshot_hellos = 0;
+static int g_last_state_snapshot_hello_ms = 0;
+static int g_last_state_snapshot_progress_ms = 0;
+static StateSnapshotReceiver g_state_snapshot_receiver;
+
+// Limits how long support is announced to a server that did not start sending a snapshot
+constexpr int state_snapshot_max_hellos = 10;
+
+// Server-side ID of the last snapshot
+static uint16_t g_last_state_snapshot_id = 0;
+
+static void send_state_snapshot_hello()
+{
+    // Send: client -> server
+    df_state_snapshot_hello_packet packet{};
+    packet.hdr.type = static_cast<uint8_t>(df_packet_type::state_snapshot_hello);
+    packet.hdr.size = sizeof(packet) - sizeof(packet.hdr);
+    rf::net_send(rf::netgame.server_addr, &packet, sizeof(packet));
+}
+
+static void send_delayed_packets(rf::Player* player)
+{
+    auto& upload = get_player_additional_data(player).state_snapshot;
+    for (const auto& [data, not_limbo] : upload.delayed_packets) {
+        multi_io_send_reliable_hook.call_target(player, data.data(), static_cast<int>(data.size()), not_limbo);
+    }
+    upload.delayed_packets.clear();
+}
+
+static void finish_upload(rf::Player* player)
+{
+    auto& upload = get_player_additional_data(player).state_snapshot;
+    upload.state = StateSnapshotUpload::State::idle;
+    upload.builder.clear();
+    upload.chunks.clear();
+    upload.next_chunk = 0;
+    upload.not_limbo = false;
+    send_delayed_packets(player);
+}
+
+void state_snapshot_on_state_info_request(rf::Player* player)
+{
+    auto& upload = get_player_additional_data(player).state_snapshot;
+    if (!upload.supported || !server_get_df_config().state_snapshot.enabled) {
+        return;
+    }
+    if (upload.state != StateSnapshotUpload::State::idle) {
+        // Client requested state again (e.g. after level change) - the old snapshot is no longer needed
+        finish_upload(player);
+    }
+    upload.state = StateSnapshotUpload::State::capturing;
+}
+
+bool state_snapshot_capture_reliable(rf::Player* player, const void* data, int len, int not_limbo)
+{
+    auto& upload = get_player_additional_data(player).state_snapshot;
+    auto bytes = static_cast<const std::byte*>(data);
+    switch (upload.state) {
+        case StateSnapshotUpload::State::capturing:
+            upload.builder.add_packet(bytes, len);
+            upload.not_limbo = upload.not_limbo || not_limbo;
+            return true;
+
+        case StateSnapshotUpload::State::streaming:
+            // Keep the order of packets - they are sent after the last chunk
+            upload.delayed_packets.emplace_back(std::vector<std::byte>{bytes, bytes + len}, not_limbo);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static void start_streaming(rf::Player* player)
+{
+    auto& upload = get_player_additional_data(player).state_snapshot;
+    auto size = upload.builder.size();
+    auto num_packets = upload.builder.num_packets();
+    upload.chunks = upload.builder.build(++g_last_state_snapshot_id);
+    if (upload.chunks.empty()) {
+        xlog::warn("Failed to build level state snapshot for {}", player->name.c_str());
+        // Fall back to sending collected packets without compression
+        state_snapshot_for_each_packet(upload.builder.data(), [&](const std::byte* packet, std::size_t len) {
+            multi_io_send_reliable_hook.call_target(player, packet, static_cast<int>(len), upload.not_limbo);
+        });
+        finish_upload(player);
+        return;
+    }
+    upload.builder.clear();
+    std::size_t compressed_size = 0;
+    for (const auto& chunk : upload.chunks) {
+        compressed_size += chunk.size();
+    }
+    xlog::debug("Sending level state snapshot to {}: {} packets, {} bytes, {} compressed, {} chunks",
+        player->name.c_str(), num_packets, size, compressed_size, upload.chunks.size());
+    upload.state = StateSnapshotUpload::State::streaming;
+    upload.next_chunk = 0;
+    upload.send_budget = static_cast<float>(rf::max_packet_size);
+    upload.last_send_ms = rf::timer_get(1000);
+}
+
+static void stream_chunks(rf::Player* player)
+{
+    auto& upload = get_player_additional_data(player).state_snapshot;
+    int bytes_per_second = server_get_df_config().state_snapshot.bytes_per_second;
+    // Allow a small burst so chunks are not delayed by frame time jitter
+    float max_budget = std::max(static_cast<float>(bytes_per_second) / 4.0f, static_cast<float>(rf::max_packet_size));
+    int now = rf::timer_get(1000);
+    upload.send_budget = std::min(upload.send_budget + static_cast<float>(now - upload.last_send_ms) *
+        static_cast<float>(bytes_per_second) / 1000.0f, max_budget);
+    upload.last_send_ms = now;
+
+    std::vector<std::byte> buf;
+    while (upload.next_chunk < upload.chunks.size()) {
+        const auto& chunk = upload.chunks[upload.next_chunk];
+        auto packet_len = sizeof(df_packet_header) + chunk.size();
+        if (upload.send_budget < static_cast<float>(packet_len)) {
+            break;
+        }
+        // Send: server -> client
+        df_packet_header header;
+        header.type = static_cast<uint8_t>(df_packet_type::state_snapshot_chunk);
+        header.size = static_cast<uint16_t>(chunk.size());
+        buf.resize(packet_len);
+        std::memcpy(buf.data(), &header, sizeof(header));
+        std::memcpy(buf.data() + sizeof(header), chunk.data(), chunk.size());
+        multi_io_send_reliable_hook.call_target(player, buf.data(), static_cast<int>(buf.size()), 0);
+        upload.send_budget -= static_cast<float>(packet_len);
+        ++upload.next_chunk;
+    }
+    if (upload.next_chunk == upload.chunks.size()) {
+        finish_upload(player);
+    }
+}
+
+static void process_state_snapshot_hello_packet(rf::Player* player)
+{
+    // Receive: server <- client
+    if (!rf::is_server || !player || !server_get_df_config().state_snapshot.enabled) {
+        return;
+    }
+    auto& upload = get_player_additional_data(player).state_snapshot;
+    if (!upload.supported) {
+        xlog::debug("Enabling level state snapshots for {}", player->name.c_str());
+        upload.supported = true;
+    }
+}
+
+static void process_state_snapshot_chunk_packet(const void* data, size_t len, const rf::NetAddr& addr,
+    rf::Player* player)
+{
+    // Receive: client <- server
+    if (rf::is_server || !g_state_snapshot_enabled || addr != rf::netgame.server_addr) {
+        return;
+    }
+    g_level_state_received = true;
+
+    auto chunk = static_cast<const std::byte*>(data) + sizeof(df_packet_header);
+    auto result = g_state_snapshot_receiver.add_chunk(chunk, len - sizeof(df_packet_header));
+    if (result == StateSnapshotReceiver::Result::error) {
+        xlog::warn("Invalid level state snapshot chunk");
+        return;
+    }
+    if (result == StateSnapshotReceiver::Result::incomplete) {
+        int now = rf::timer_get(1000);
+        if (g_last_state_snapshot_progress_ms == 0 || now - g_last_state_snapshot_progress_ms >= 1000) {
+            g_last_state_snapshot_progress_ms = now;
+            rf::console::print("Receiving level state: {:.0f}%", g_state_snapshot_receiver.progress() * 100.0f);
+        }
+        return;
+    }
+
+    g_last_state_snapshot_progress_ms = 0;
+    if (rf::gameseq_get_state() == rf::GS_MULTI_LIMBO) {
+        // Level has ended in the meantime so its state is no longer needed
+        xlog::debug("Ignoring level state snapshot received in limbo");
+        return;
+    }
+    const auto& snapshot = g_state_snapshot_receiver.data();
+    xlog::debug("Received level state snapshot: {} bytes, {} compressed", snapshot.size(),
+        g_state_snapshot_receiver.compressed_size());
+    // Pass packets to the standard handler in the order they were sent by the server
+    bool valid = state_snapshot_for_each_packet(snapshot, [&](const std::byte* packet, std::size_t packet_len) {
+        multi_io_process_decoded_packets(packet, packet_len, addr, player, true);
+    });
+    if (!valid) {
+        xlog::warn("Malformed level state snapshot");
+    }
+}
+
+bool state_snapshot_process_packet(const void* data, int len, const rf::NetAddr& addr, rf::Player* player)
+{
+    df_packet_header header{};
+    if (len < static_cast<int>(sizeof(header))) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (sizeof(header) + header.size > static_cast<size_t>(len)) {
+        return false;
+    }
+
+    switch (static_cast<df_packet_type>(header.type)) {
+        case df_packet_type::state_snapshot_hello:
+            process_state_snapshot_hello_packet(player);
+            break;
+
+        case df_packet_type::state_snapshot_chunk:
+            process_state_snapshot_chunk_packet(data, sizeof(header) + header.size, addr, player);
+            break;
+
+        default:
+            return false;
+    }
+    return true;
+}
+
+void state_snapshot_on_join_accept()
+{
+    const auto& server_info = get_df_server_info();
+    g_state_snapshot_enabled = server_info && server_info.value().state_snapshot;
+    g_level_state_received = false;
+    g_num_state_snapshot_hellos = 0;
+    g_last_state_snapshot_hello_ms = 0;
+    g_last_state_snapshot_progress_ms = 0;
+    g_state_snapshot_receiver.reset();
+}
+
+void state_snapshot_on_state_info_done()
+{
+    // Server sent the level state without a snapshot so there is no point in announcing support anymore
+    g_level_state_received = true;
+}
+
+static bool is_blocked_by_limbo(const StateSnapshotUpload& upload)
+{
+    // Stock reliable channel drops packets sent with not_limbo argument when the level has ended. Check it again
+    // because packets in the snapshot are sent later than the stock handler intended.
+    return upload.not_limbo && rf::gameseq_get_state() == rf::GS_MULTI_LIMBO;
+}
+
+void multi_state_snapshot_do_frame()
+{
+    if (rf::is_server) {
+        for (auto& player : SinglyLinkedList{rf::player_list}) {
+            auto& upload = get_player_additional_data(&player).state_snapshot;
+            if (upload.state != StateSnapshotUpload::State::idle && is_blocked_by_limbo(upload)) {
+                xlog::debug("Dropping level state snapshot for {} because the level has ended", player.name.c_str());
+                finish_upload(&player);
+                continue;
+            }
+            // Stock handler has already sent the whole state so the snapshot is complete
+            if (upload.state == StateSnapshotUpload::State::capturing) {
+                start_streaming(&player);
+            }
+            if (upload.state == StateSnapshotUpload::State::streaming) {
+                stream_chunks(&player);
+            }
+        }
+        return;
+    }
+    if (!g_state_snapshot_enabled) {
+        return;
+    }
+    if (!rf::is_multi || !get_df_server_info()) {
+        g_state_snapshot_enabled = false;
+        g_state_snapshot_receiver.reset();
+        return;
+    }
+    // Announce support until the level state arrives because unreliable packets can be lost. Server falls back to
+    // the stock behaviour if state is requested before it gets the announcement.
+    if (!g_level_state_received && g_num_state_snapshot_hellos < state_snapshot_max_hellos) {
+        int now = rf::timer_get(1000);
+        if (g_last_state_snapshot_hello_ms == 0 || now - g_last_state_snapshot_hello_ms >= 1000) {
+            g_last_state_snapshot_hello_ms = now;
+            ++g_num_state_snapshot_hellos;
+            send_state_snapshot_hello();
+        }
+    }
+}
@@ -1,68 +1,146 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <memory>
+#include <optional>
 #include <string_view>
-#include <map>
-#include <set>
+#include <vector>
 #include <ctime>
 #include <format>
 #include "../rf/player/player.h"
 #include "../rf/multi.h"
 #include "../rf/gameseq.h"
 #include "../rf/misc.h"
+#include "../rf/os/timer.h"
 #include "../os/console.h"
 #include "../misc/player.h"
 #include "../main/main.h"
 #include <common/utils/list-utils.h>
 #include "server_internal.h"
 #include "multi.h"
+#include "match_log.h"
+
+// Minimal interval between vote status messages. Ballots received in the meantime are reported in a single message.
+constexpr int vote_status_interval_ms = 2000;
+constexpr std::size_t max_concurrent_votes = 3;
+
+enum class VoteKind
+{
+    kick,
+    extend,
+    level,
+    restart,
+    next,
+    random,
+    previous,
+};
+
+enum class Ballot : uint8_t
+{
+    not_eligible,
+    waiting,
+    yes,
+    no,
+};
+
+static std::optional<int> get_vote_slot(rf::Player* player)
+{
+    if (!player || !player->net_data) {
+        return {};
+    }
+    return {player->net_data->player_id};
+}
 
 struct Vote
 {
 private:
+    // Ballots are indexed by player ID so all operations on them are O(1)
+    std::array<Ballot, rf::multi_max_player_id> ballots{};
     int num_votes_yes = 0;
     int num_votes_no = 0;
+    int num_waiting = 0;
     std::time_t start_time = 0;
     bool reminder_sent = false;
-    std::map<rf::Player*, bool> players_who_voted;
-    std::set<rf::Player*> remaining_players;
-    rf::Player* owner;
+    bool status_changed = false;
+    int last_status_ms = 0;
+    int id = 0;
+    rf::Player* owner = nullptr;
 
 public:
+    // Set by VoteMgr when the vote is over
+    bool finished = false;
+
     virtual ~Vote() = default;
 
-    bool start(std::string_view arg, rf::Player* source)
+    bool start(std::string_view arg, rf::Player* source, int vote_id)
     {
         if (!process_vote_arg(arg, source)) {
             return false;
         }
 
         owner = source;
+        id = vote_id;
 
         send_vote_starting_msg(source);
+        match_log_vote_start(get_title(), source);
 
         start_time = std::time(nullptr);
+        last_status_ms = rf::timer_get(1000);
 
         // prepare allowed player list
         auto player_list = SinglyLinkedList{rf::player_list};
         for (auto& player : player_list) {
-            if (&player != source && !get_player_additional_data(&player).is_browser) {
-                remaining_players.insert(&player);
+            auto slot = get_vote_slot(&player);
+            if (&player != source && slot && !get_player_additional_data(&player).is_browser) {
+                ballots[slot.value()] = Ballot::waiting;
+                ++num_waiting;
             }
         }
 
+        if (auto slot = get_vote_slot(source)) {
+            ballots[slot.value()] = Ballot::yes;
+        }
         ++num_votes_yes;
-        players_who_voted.insert({source, true});
 
         return check_for_early_vote_finish();
     }
 
+    [[nodiscard]] int get_id() const
+    {
+        return id;
+    }
+
+    [[nodiscard]] rf::Player* get_owner() const
+    {
+        return owner;
+    }
+
+    [[nodiscard]] bool is_waiting_for(rf::Player* player) const
+    {
+        auto slot = get_vote_slot(player);
+        return slot && ballots[slot.value()] == Ballot::waiting;
+    }
+
     virtual bool on_player_leave(rf::Player* player)
     {
-        remaining_players.erase(player);
-        auto it = players_who_voted.find(player);
-        if (it != players_who_voted.end()) {
-            if (it->second)
-                num_votes_yes--;
-            else
-                num_votes_no--;
+        auto slot = get_vote_slot(player);
+        if (!slot) {
+            return true;
+        }
+        auto& ballot = ballots[slot.value()];
+        if (ballot == Ballot::waiting) {
+            --num_waiting;
+        }
+        else if (ballot == Ballot::yes) {
+            --num_votes_yes;
+        }
+        else if (ballot == Ballot::no) {
+            --num_votes_no;
+        }
+        // Player ID can be reused by a player that joins later
+        ballot = Ballot::not_eligible;
+        if (player == owner) {
+            owner = nullptr;
         }
         return check_for_early_vote_finish();
     }
@@ -72,21 +150,27 @@ public:
         return true;
     }
 
+    [[nodiscard]] virtual bool changes_level() const
+    {
+        return false;
+    }
+
     bool add_player_vote(bool is_yes_vote, rf::Player* source)
     {
-        if (players_who_voted.count(source) == 1)
+        auto slot = get_vote_slot(source);
+        auto ballot = slot ? ballots[slot.value()] : Ballot::not_eligible;
+        if (ballot == Ballot::yes || ballot == Ballot::no)
             send_chat_line_packet("You already voted!", source);
-        else if (remaining_players.count(source) == 0)
+        else if (ballot == Ballot::not_eligible)
             send_chat_line_packet("You cannot vote!", source);
         else {
             if (is_yes_vote)
                 num_votes_yes++;
             else
                 num_votes_no++;
-            remaining_players.erase(source);
-            players_who_voted.insert({source, is_yes_vote});
-            auto msg = std::format("\xA6 Vote status:  Yes: {}  No: {}  Waiting: {}", num_votes_yes, num_votes_no, remaining_players.size());
-            send_chat_line_packet(msg.c_str(), nullptr);
+            --num_waiting;
+            ballots[slot.value()] = is_yes_vote ? Ballot::yes : Ballot::no;
+            status_changed = true;
             return check_for_early_vote_finish();
         }
         return true;
@@ -97,13 +181,25 @@ public:
         const auto& vote_config = get_config();
         std::time_t passed_time_sec = std::time(nullptr) - start_time;
         if (passed_time_sec >= vote_config.time_limit_seconds) {
-            send_chat_line_packet("\xA6 Vote timed out!", nullptr);
+            send_chat_line_packet(std::format("\xA6 Vote {}timed out!", vote_prefix()).c_str(), nullptr);
+            match_log_vote_end(get_title(), "timed_out");
             return false;
         }
+        int now = rf::timer_get(1000);
+        if (status_changed && now - last_status_ms >= vote_status_interval_ms) {
+            auto msg = std::format("\xA6 Vote {}status:  Yes: {}  No: {}  Waiting: {}", vote_prefix(), num_votes_yes,
+                num_votes_no, num_waiting);
+            send_chat_line_packet(msg.c_str(), nullptr);
+            status_changed = false;
+            last_status_ms = now;
+        }
         if (passed_time_sec >= vote_config.time_limit_seconds / 2 && !reminder_sent) {
             // Send reminder to player who did not vote yet
-            for (rf::Player* player : remaining_players) {
-                send_chat_line_packet("\xA6 Send message \"/vote yes\" or \"/vote no\" to vote.", player);
+            auto msg = std::format("\xA6 Send message \"/vote yes{0}\" or \"/vote no{0}\" to vote.", vote_id_arg());
+            for (auto& player : SinglyLinkedList{rf::player_list}) {
+                if (is_waiting_for(&player)) {
+                    send_chat_line_packet(msg.c_str(), &player);
+                }
             }
             reminder_sent = true;
         }
@@ -117,14 +213,26 @@ public:
             return false;
         }
 
-        send_chat_line_packet("\xA6 Vote canceled!", nullptr);
+        send_chat_line_packet(std::format("\xA6 Vote {}canceled!", vote_prefix()).c_str(), nullptr);
+        match_log_vote_end(get_title(), "canceled");
         return true;
     }
 
+    // Vote ID is only shown to players when multiple votes are allowed to run at the same time
+    [[nodiscard]] std::string vote_prefix() const
+    {
+        return max_concurrent_votes > 1 ? std::format("#{} ", id) : std::string{};
+    }
 
+    [[nodiscard]] std::string vote_id_arg() const
+    {
+        return max_concurrent_votes > 1 ? std::format(" {}", id) : std::string{};
+    }
 
-protected:
+    [[nodiscard]] virtual VoteKind kind() const = 0;
     [[nodiscard]] virtual std::string get_title() const = 0;
+
+protected:
     [[nodiscard]] virtual const VoteConfig& get_config() const = 0;
 
     virtual bool process_vote_arg([[maybe_unused]] std::string_view arg, [[maybe_unused]] rf::Player* source)
@@ -146,15 +254,16 @@ protected:
     {
         auto title = get_title();
         auto msg = std::format(
-            "\n=============== VOTE STARTING ===============\n"
-            "{} vote started by {}.\n"
-            "Send message \"/vote yes\" or \"/vote no\" to participate.",
-            title.c_str(), source->name.c_str());
+            "\n=============== VOTE {0}STARTING ===============\n"
+            "{1} vote started by {2}.\n"
+            "Send message \"/vote yes{3}\" or \"/vote no{3}\" to participate.",
+            vote_prefix(), title.c_str(), source->name.c_str(), vote_id_arg());
         send_chat_line_packet(msg.c_str(), nullptr);
     }
 
     void finish_vote(bool is_accepted)
     {
+        match_log_vote_end(get_title(), is_accepted ? "passed" : "failed");
         if (is_accepted) {
             on_accepted();
         }
@@ -165,11 +274,17 @@ protected:
 
     bool check_for_early_vote_finish()
     {
-        if (num_votes_yes > num_votes_no + static_cast<int>(remaining_players.size())) {
+        // Players that did not vote yet are counted as potential votes for both options so the result is decided
+        // only when it cannot change anymore
+        const auto& config = get_config();
+        int num_total = num_votes_yes + num_votes_no + num_waiting;
+        bool yes_is_certain = num_votes_yes * 100 > config.min_percentage * num_total;
+        bool yes_is_impossible = (num_votes_yes + num_waiting) * 100 < config.min_percentage * num_total;
+        if (yes_is_certain && num_votes_yes + num_votes_no >= config.min_voters) {
             finish_vote(true);
             return false;
         }
-        if (num_votes_no > num_votes_yes + static_cast<int>(remaining_players.size())) {
+        if (yes_is_impossible || num_total < config.min_voters) {
             finish_vote(false);
             return false;
         }
@@ -188,6 +303,11 @@ struct VoteKick : public Vote
         return m_target_player != nullptr;
     }
 
+    [[nodiscard]] VoteKind kind() const override
+    {
+        return VoteKind::kick;
+    }
+
     [[nodiscard]] std::string get_title() const override
     {
         return std::format("KICK PLAYER '{}'", m_target_player->name);
@@ -217,6 +337,11 @@ struct VoteExtend : public Vote
 {
     rf::Player* m_target_player;
 
+    [[nodiscard]] VoteKind kind() const override
+    {
+        return VoteKind::extend;
+    }
+
     [[nodiscard]] std::string get_title() const override
     {
         return "EXTEND ROUND BY 5 MINUTES";
@@ -253,6 +378,11 @@ struct VoteLevel : public Vote
         return true;
     }
 
+    [[nodiscard]] VoteKind kind() const override
+    {
+        return VoteKind::level;
+    }
+
     [[nodiscard]] std::string get_title() const override
     {
         return std::format("LOAD LEVEL '{}'", m_level_name);
@@ -264,6 +394,11 @@ struct VoteLevel : public Vote
         rf::multi_change_level(m_level_name.c_str());
     }
 
+    [[nodiscard]] bool changes_level() const override
+    {
+        return true;
+    }
+
     [[nodiscard]] bool is_allowed_in_limbo_state() const override
     {
         return false;
@@ -277,6 +412,11 @@ struct VoteLevel : public Vote
 
 struct VoteRestart : public Vote
 {
+    [[nodiscard]] VoteKind kind() const override
+    {
+        return VoteKind::restart;
+    }
+
     [[nodiscard]] std::string get_title() const override
     {
         return "RESTART LEVEL";
@@ -288,6 +428,11 @@ struct VoteRestart : public Vote
         restart_current_level();
     }
 
+    [[nodiscard]] bool changes_level() const override
+    {
+        return true;
+    }
+
     [[nodiscard]] bool is_allowed_in_limbo_state() const override
     {
         return false;
@@ -301,6 +446,11 @@ struct VoteRestart : public Vote
 
 struct VoteNext : public Vote
 {
+    [[nodiscard]] VoteKind kind() const override
+    {
+        return VoteKind::next;
+    }
+
     [[nodiscard]] std::string get_title() const override
     {
         return "LOAD NEXT LEVEL";
@@ -312,6 +462,11 @@ struct VoteNext : public Vote
         load_next_level();
     }
 
+    [[nodiscard]] bool changes_level() const override
+    {
+        return true;
+    }
+
     [[nodiscard]] bool is_allowed_in_limbo_state() const override
     {
         return false;
@@ -325,6 +480,11 @@ struct VoteNext : public Vote
 
 struct VoteRandom : public Vote
 {
+    [[nodiscard]] VoteKind kind() const override
+    {
+        return VoteKind::random;
+    }
+
     [[nodiscard]] std::string get_title() const override
     {
         return "LOAD RANDOM LEVEL";
@@ -336,6 +496,11 @@ struct VoteRandom : public Vote
         load_rand_level();
     }
 
+    [[nodiscard]] bool changes_level() const override
+    {
+        return true;
+    }
+
     [[nodiscard]] bool is_allowed_in_limbo_state() const override
     {
         return false;
@@ -349,6 +514,11 @@ struct VoteRandom : public Vote
 
 struct VotePrevious : public Vote
 {
+    [[nodiscard]] VoteKind kind() const override
+    {
+        return VoteKind::previous;
+    }
+
     [[nodiscard]] std::string get_title() const override
     {
         return "LOAD PREV LEVEL";
@@ -360,6 +530,11 @@ struct VotePrevious : public Vote
         load_prev_level();
     }
 
+    [[nodiscard]] bool changes_level() const override
+    {
+        return true;
+    }
+
     [[nodiscard]] bool is_allowed_in_limbo_state() const override
     {
         return false;
@@ -374,17 +549,67 @@ struct VotePrevious : public Vote
 class VoteMgr
 {
 private:
-    std::optional<std::unique_ptr<Vote>> active_vote;
+    std::vector<std::unique_ptr<Vote>> active_votes;
+    int next_vote_id = 1;
+    // Finishing a vote can re-enter the manager (e.g. kicked player leaves the game) so finished votes are removed
+    // only when the outermost call returns
+    int call_depth = 0;
+
+    struct CallGuard
+    {
+        VoteMgr& mgr;
+
+        CallGuard(VoteMgr& mgr) : mgr(mgr)
+        {
+            ++mgr.call_depth;
+        }
+
+        ~CallGuard()
+        {
+            if (--mgr.call_depth == 0) {
+                std::erase_if(mgr.active_votes, [](const auto& vote) { return vote->finished; });
+            }
+        }
+    };
+
+    // Finds vote selected by the optional ID argument. Without ID the oldest vote that the player has not voted in
+    // yet is used.
+    Vote* find_vote(std::string_view id_arg, rf::Player* source)
+    {
+        Vote* result = nullptr;
+        if (!id_arg.empty()) {
+            int id = 0;
+            std::from_chars(id_arg.data(), id_arg.data() + id_arg.size(), id);
+            for (auto& vote : active_votes) {
+                if (!vote->finished && vote->get_id() == id) {
+                    return vote.get();
+                }
+            }
+            send_chat_line_packet("There is no vote with such ID!", source);
+            return nullptr;
+        }
+        for (auto& vote : active_votes) {
+            if (vote->finished) {
+                continue;
+            }
+            if (vote->is_waiting_for(source)) {
+                return vote.get();
+            }
+            if (!result) {
+                result = vote.get();
+            }
+        }
+        if (!result) {
+            send_chat_line_packet("No vote in progress!", source);
+        }
+        return result;
+    }
 
 public:
     template<typename T>
     bool StartVote(std::string_view arg, rf::Player* source)
     {
-        if (active_vote) {
-            send_chat_line_packet("Another vote is currently in progress!", source);
-            return false;
-        }
-
+        CallGuard guard{*this};
         auto vote = std::make_unique<T>();
 
         if (!vote->get_config().enabled) {
@@ -392,65 +617,95 @@ public:
             return false;
         }
 
+        // Votes of the same type or votes that change the level cannot run at the same time
+        std::size_t num_active = 0;
+        bool conflicts = false;
+        for (auto& v : active_votes) {
+            if (!v->finished) {
+                ++num_active;
+                conflicts = conflicts || v->kind() == vote->kind() || (v->changes_level() && vote->changes_level());
+            }
+        }
+        if (conflicts || num_active >= max_concurrent_votes) {
+            send_chat_line_packet("Another vote is currently in progress!", source);
+            return false;
+        }
+
         if (!vote->is_allowed_in_limbo_state() && rf::gameseq_get_state() != rf::GS_GAMEPLAY) {
             send_chat_line_packet("Vote cannot be started now!", source);
             return false;
         }
 
-        if (!vote->start(arg, source)) {
+        if (!vote->start(arg, source, next_vote_id++)) {
             return false;
         }
 
-        active_vote = {std::move(vote)};
+        active_votes.push_back(std::move(vote));
         return true;
     }
 
     void on_player_leave(rf::Player* player)
     {
-        if (active_vote && !active_vote.value()->on_player_leave(player)) {
-            active_vote.reset();
+        CallGuard guard{*this};
+        // Index based loop because finishing a vote can start another call of this function
+        for (std::size_t i = 0; i < active_votes.size(); ++i) {
+            auto& vote = *active_votes[i];
+            if (!vote.finished && !vote.on_player_leave(player)) {
+                vote.finished = true;
+            }
         }
     }
 
     void OnLimboStateEnter()
     {
-        if (active_vote && !active_vote.value()->is_allowed_in_limbo_state()) {
-            send_chat_line_packet("\xA6 Vote canceled!", nullptr);
-            active_vote.reset();
+        CallGuard guard{*this};
+        for (auto& vote : active_votes) {
+            if (!vote->finished && !vote->is_allowed_in_limbo_state()) {
+                send_chat_line_packet(std::format("\xA6 Vote {}canceled!", vote->vote_prefix()).c_str(), nullptr);
+                match_log_vote_end(vote->get_title(), "canceled");
+                vote->finished = true;
+            }
         }
     }
 
-    void add_player_vote(bool is_yes_vote, rf::Player* source)
+    void add_player_vote(bool is_yes_vote, std::string_view id_arg, rf::Player* source)
     {
-        if (!active_vote) {
-            send_chat_line_packet("No vote in progress!", source);
-            return;
-        }
-
-        if (!active_vote.value()->add_player_vote(is_yes_vote, source)) {
-            active_vote.reset();
+        CallGuard guard{*this};
+        Vote* vote = find_vote(id_arg, source);
+        if (vote && !vote->add_player_vote(is_yes_vote, source)) {
+            vote->finished = true;
         }
     }
 
-    void try_cancel_vote(rf::Player* source)
+    void try_cancel_vote(std::string_view id_arg, rf::Player* source)
     {
-        if (!active_vote) {
-            send_chat_line_packet("No vote in progress!", source);
-            return;
+        CallGuard guard{*this};
+        Vote* vote = nullptr;
+        if (id_arg.empty()) {
+            // Prefer the vote started by the player
+            for (auto& v : active_votes) {
+                if (!v->finished && v->get_owner() == source) {
+                    vote = v.get();
+                    break;
+                }
+            }
         }
-
-        if (active_vote.value()->try_cancel_vote(source)) {
-            active_vote.reset();
+        if (!vote) {
+            vote = find_vote(id_arg, source);
+        }
+        if (vote && vote->try_cancel_vote(source)) {
+            vote->finished = true;
         }
     }
 
     void do_frame()
     {
-        if (!active_vote)
-            return;
-
-        if (!active_vote.value()->do_frame()) {
-            active_vote.reset();
+        CallGuard guard{*this};
+        for (std::size_t i = 0; i < active_votes.size(); ++i) {
+            auto& vote = *active_votes[i];
+            if (!vote.finished && !vote.do_frame()) {
+                vote.finished = true;
+            }
         }
     }
 };
@@ -478,11 +733,11 @@ void handle_vote_command(std::string_view vote_name, std::string_view vote_arg,
     else if (vote_name == "previous" || vote_name == "prev")
         g_vote_mgr.StartVote<VotePrevious>(vote_arg, sender);
     else if (vote_name == "yes" || vote_name == "y")
-        g_vote_mgr.add_player_vote(true, sender);
+        g_vote_mgr.add_player_vote(true, vote_arg, sender);
     else if (vote_name == "no" || vote_name == "n")
-        g_vote_mgr.add_player_vote(false, sender);
+        g_vote_mgr.add_player_vote(false, vote_arg, sender);
     else if (vote_name == "cancel")
-        g_vote_mgr.try_cancel_vote(sender);
+        g_vote_mgr.try_cancel_vote(vote_arg, sender);
     else
         send_chat_line_packet("Unrecognized vote type!", sender);
 }
@@ -1,4 +1,8 @@
 #include <cassert>
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+#include <utility>
 #include <xlog/xlog.h>
 #include <patch_common/FunHook.h>
 #include <patch_common/AsmWriter.h>
@@ -7,6 +11,8 @@
 #include "../rf/item.h"
 #include "../rf/clutter.h"
 #include "../rf/gr/gr.h"
+#include "../rf/gr/gr_light.h"
+#include "../rf/geometry.h"
 #include "../rf/multi.h"
 #include "../rf/crt.h"
 #include "../os/console.h"
@@ -16,6 +22,84 @@ float obj_light_scale = 1.0;
 
 void gr_light_use_static(bool use_static);
 
+// Inputs of the last mesh lighting calculation of an object
+struct ObjLightCacheEntry
+{
+    // Lighting data buffer the entry belongs to - the object could get a new one in the meantime
+    const void* lighting_data;
+    rf::GRoom* room;
+    rf::Vector3 pos;
+    rf::Matrix3 orient;
+    bool use_static_lights;
+    float light_scale;
+    std::size_t lights_hash;
+};
+
+// Entries are keyed by object handle and removed when lighting data of the object is freed
+static std::unordered_map<int, ObjLightCacheEntry> g_obj_light_cache;
+static int g_obj_light_cache_hits = 0;
+static int g_obj_light_cache_misses = 0;
+
+template<typename T>
+static void hash_combine(std::size_t& seed, const T& value)
+{
+    seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+// Returns bounding sphere of the light influence
+static std::pair<rf::Vector3, float> get_light_sphere(const rf::gr::Light& light)
+{
+    if (light.type == rf::gr::LT_TUBE) {
+        rf::Vector3 center = (light.vec + light.vec2) * 0.5f;
+        return {center, light.rad_2 + (light.vec2 - light.vec).len() * 0.5f};
+    }
+    return {light.vec, light.rad_2};
+}
+
+static bool light_touches_sphere(const rf::gr::Light& light, const rf::Vector3& pos, float radius)
+{
+    if (light.type == rf::gr::LT_DIRECTIONAL) {
+        return true;
+    }
+    auto [center, light_radius] = get_light_sphere(light);
+    float max_dist = light_radius + radius;
+    return (pos - center).len_sq() <= max_dist * max_dist;
+}
+
+// Hashes lights affecting the object. Lights are taken from the list the engine keeps in the room for the current
+// light search mode (it is rebuilt when the light cache key changes). Returns nothing if the list is outdated.
+static std::optional<std::size_t> obj_light_get_lights_hash(rf::Object* objp)
+{
+    rf::GRoom* room = objp->room;
+    if (!room) {
+        return {0};
+    }
+    if (room->light_state != rf::gr::light_state) {
+        return {};
+    }
+    std::size_t hash = 0;
+    for (rf::GrLight* room_light : room->cached_lights) {
+        auto& light = *reinterpret_cast<rf::gr::Light*>(room_light);
+        if (!light_touches_sphere(light, objp->pos, objp->radius)) {
+            continue;
+        }
+        hash_combine(hash, &light);
+        hash_combine(hash, light.on);
+        hash_combine(hash, light.type);
+        hash_combine(hash, light.vec.x);
+        hash_combine(hash, light.vec.y);
+        hash_combine(hash, light.vec.z);
+        hash_combine(hash, light.vec2.x);
+        hash_combine(hash, light.vec2.y);
+        hash_combine(hash, light.vec2.z);
+        hash_combine(hash, light.rad_2);
+        hash_combine(hash, light.r);
+        hash_combine(hash, light.g);
+        hash_combine(hash, light.b);
+    }
+    return {hash};
+}
+
 void obj_light_alloc_one(rf::Object* objp)
 {
     if ((objp->type != rf::OT_ITEM && objp->type != rf::OT_CLUTTER) ||
@@ -39,20 +123,21 @@ void obj_light_free_one(rf::Object* objp)
         rf::rf_free(objp->mesh_lighting_data);
         objp->mesh_lighting_data = nullptr;
     }
+    g_obj_light_cache.erase(objp->handle);
 }
 
-void obj_light_update_one(rf::Object* objp)
+static bool obj_light_should_use_static_lights(rf::Object* objp)
 {
-    if (!objp->mesh_lighting_data) {
-        return;
-    }
-
-    bool use_static_lights = g_game_config.mesh_static_lighting;
     if (objp->type == rf::OT_ITEM && rf::is_multi) {
         // In multi-player items spin so having baked lighting makes less sense
-        use_static_lights = false;
+        return false;
     }
+    return g_game_config.mesh_static_lighting;
+}
 
+// Expects light search mode to be already set according to use_static_lights
+static void obj_light_calculate_one(rf::Object* objp, bool use_static_lights)
+{
     // Do not strengthen lighting when static lights are used
     // In other cases behave like the base game (00504275)
     if (use_static_lights) {
@@ -63,10 +148,49 @@ void obj_light_update_one(rf::Object* objp)
         obj_light_scale = 2.0;
     }
 
+    // Skip calculation if the object did not move and lights affecting it did not change since last time
+    auto lights_hash = obj_light_get_lights_hash(objp);
+    auto it = g_obj_light_cache.find(objp->handle);
+    if (it != g_obj_light_cache.end() && lights_hash) {
+        const auto& entry = it->second;
+        if (entry.lighting_data == objp->mesh_lighting_data && entry.room == objp->room && entry.pos == objp->pos &&
+            entry.orient == objp->orient && entry.use_static_lights == use_static_lights &&
+            entry.light_scale == obj_light_scale && entry.lights_hash == lights_hash.value()) {
+            ++g_obj_light_cache_hits;
+            return;
+        }
+    }
+
+    ++g_obj_light_cache_misses;
+    rf::vmesh_update_lighting_data(objp->vmesh, objp->room, objp->pos, objp->orient, objp->mesh_lighting_data);
+    // Room light list is up to date after the calculation
+    lights_hash = obj_light_get_lights_hash(objp);
+    if (!lights_hash) {
+        g_obj_light_cache.erase(objp->handle);
+        return;
+    }
+    g_obj_light_cache[objp->handle] = ObjLightCacheEntry{
+        objp->mesh_lighting_data,
+        objp->room,
+        objp->pos,
+        objp->orient,
+        use_static_lights,
+        obj_light_scale,
+        lights_hash.value(),
+    };
+}
+
+void obj_light_update_one(rf::Object* objp)
+{
+    if (!objp->mesh_lighting_data) {
+        return;
+    }
+
+    bool use_static_lights = obj_light_should_use_static_lights(objp);
     if (use_static_lights) {
         gr_light_use_static(true);
     }
-    rf::vmesh_update_lighting_data(objp->vmesh, objp->room, objp->pos, objp->orient, objp->mesh_lighting_data);
+    obj_light_calculate_one(objp, use_static_lights);
     if (use_static_lights) {
         gr_light_use_static(false);
     }
@@ -90,12 +214,23 @@ FunHook<void()> obj_light_calculate_hook{
         rf::gr::light_matrix.make_identity();
         rf::gr::light_base.zero();
 
-        for (auto& item : DoublyLinkedList{rf::item_list}) {
-            obj_light_update_one(&item);
-        }
-        for (auto& clutter : DoublyLinkedList{rf::clutter_list}) {
-            obj_light_update_one(&clutter);
+        // Switching the light search mode invalidates light lists cached in all rooms so process objects
+        // using static lights first and then the rest instead of switching it for every object
+        for (bool use_static_lights : {true, false}) {
+            gr_light_use_static(use_static_lights);
+            auto update = [=](rf::Object* objp) {
+                if (objp->mesh_lighting_data && obj_light_should_use_static_lights(objp) == use_static_lights) {
+                    obj_light_calculate_one(objp, use_static_lights);
+                }
+            };
+            for (auto& item : DoublyLinkedList{rf::item_list}) {
+                update(&item);
+            }
+            for (auto& clutter : DoublyLinkedList{rf::clutter_list}) {
+                update(&clutter);
+            }
         }
+        xlog::debug("Mesh lighting cache: {} hits, {} misses", g_obj_light_cache_hits, g_obj_light_cache_misses);
     },
 };
 
@@ -120,13 +255,13 @@ FunHook<void()> obj_light_free_hook{
         for (auto& clutter : DoublyLinkedList{rf::clutter_list}) {
             obj_light_free_one(&clutter);
         }
+        g_obj_light_cache.clear();
     },
 };
 
 void recalc_mesh_static_lighting()
 {
-    rf::obj_light_free();
-    rf::obj_light_alloc();
+    // Lighting data buffers are kept - only objects affected by the change are recalculated
     rf::obj_light_calculate();
 }
 
@@ -10,6 +10,8 @@ void object_do_patch();
 void obj_light_free_one(rf::Object *objp);
 void obj_light_init_object(rf::Object *objp);
 void trigger_send_state_info(rf::Player* player);
+int weapon_get_damage_source_type();
+void weapon_set_damage_source_type(int weapon_type);
 
 constexpr size_t old_obj_limit = 1024;
 constexpr size_t obj_limit = 65536;
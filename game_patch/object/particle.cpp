@@ -1,3 +1,4 @@
+#include <cassert>
 #include <patch_common/FunHook.h>
 #include <patch_common/CallHook.h>
 #include <patch_common/AsmOpcodes.h>
@@ -7,6 +8,7 @@
 #include "../rf/particle_emitter.h"
 #include "../rf/geometry.h"
 #include "../rf/multi.h"
+#include "../graphics/gr.h"
 
 FunHook<rf::ParticleEmitter*(int, rf::ParticleEmitterType&, rf::GRoom*, rf::Vector3&, bool)> particle_emitter_create_hook{
     0x00497CA0,
@@ -77,6 +79,17 @@ CodeInjection particle_emitter_update_cull_radius_injection{
     },
 };
 
+static void (*g_particle_emitter_render_function)(int, rf::GSolid*);
+
+static void particle_emitter_render(int emitter_ptr, rf::GSolid* solid)
+{
+    // First argument is the object passed to g_portal_object_add - particle emitter in this case
+    auto emitter = reinterpret_cast<rf::ParticleEmitter*>(emitter_ptr);
+    gr_render_particle_emitter(emitter, [=]() {
+        g_particle_emitter_render_function(emitter_ptr, solid);
+    });
+}
+
 CallHook<void(rf::ParticleEmitter*, const rf::Vector3*, const rf::Vector3*, float, void (*)(int, rf::GSolid*), bool, const rf::Plane*, const rf::Vector3*, const rf::Vector3*, bool, bool)> particle_emitter_g_portal_object_add_hook{
     0x00497C82,
     [](rf::ParticleEmitter* emitter, const rf::Vector3 *pos, const rf::Vector3 *cull_pos, float radius, void (*render_function)(int, rf::GSolid*), bool has_alpha, const rf::Plane*, const rf::Vector3*, const rf::Vector3*, bool lights_enabled, bool use_static_lights) {
@@ -94,7 +107,13 @@ CallHook<void(rf::ParticleEmitter*, const rf::Vector3*, const rf::Vector3*, floa
         // because they are often far from a ball shape (e.g. flamethrower). Because of that flame coming from a flamethrower
         // can be rendered as underwater, when the player is close to the water surface, even if particles don't touch the water.
         // To mitigate this issue use particle emitter center point for sorting.
-        particle_emitter_g_portal_object_add_hook.call_target(emitter, pos, cull_pos, radius, render_function, has_alpha, nullptr, &emitter->world_pos, &emitter->world_pos, lights_enabled, use_static_lights);
+        // Route rendering through the graphics module so the D3D11 renderer can draw particles on GPU.
+        // The engine always passes the same render function here so it is enough to remember it once.
+        if (!g_particle_emitter_render_function) {
+            g_particle_emitter_render_function = render_function;
+        }
+        assert(render_function == g_particle_emitter_render_function);
+        particle_emitter_g_portal_object_add_hook.call_target(emitter, pos, cull_pos, radius, particle_emitter_render, has_alpha, nullptr, &emitter->world_pos, &emitter->world_pos, lights_enabled, use_static_lights);
     },
 };
 
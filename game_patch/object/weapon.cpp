@@ -46,10 +46,27 @@ CodeInjection weapons_tbl_buffer_overflow_fix_2{
     },
 };
 
+// Type of the weapon that hits objects in the current call (-1 if none). Damage dealt meanwhile comes from it.
+static int g_damage_source_weapon_type = -1;
+
+int weapon_get_damage_source_type()
+{
+    return g_damage_source_weapon_type;
+}
+
+void weapon_set_damage_source_type(int weapon_type)
+{
+    g_damage_source_weapon_type = weapon_type;
+}
+
 FunHook<void(rf::Weapon*)> weapon_move_one_hook{
     0x004C69A0,
     [](rf::Weapon* weapon) {
+        // Projectiles hit objects when they are moved
+        int prev_damage_source_weapon_type = g_damage_source_weapon_type;
+        g_damage_source_weapon_type = weapon->info_index;
         weapon_move_one_hook.call_target(weapon);
+        g_damage_source_weapon_type = prev_damage_source_weapon_type;
         auto& level_aabb_min = rf::level.geometry->bbox_min;
         auto& level_aabb_max = rf::level.geometry->bbox_max;
         float margin = weapon->vmesh ? 275.0f : 10.0f;
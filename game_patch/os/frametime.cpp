@@ -12,6 +12,10 @@
 #include "../rf/os/frametime.h"
 #include "../main/main.h"
 #include "../hud/hud.h"
+#include "os.h"
+
+// Engine frame limiter value used by dedicated server - only protects against zero frame time
+constexpr float server_frametime_min = 0.001f;
 
 static float g_frametime_history[1024];
 static int g_frametime_history_index = 0;
@@ -91,8 +95,15 @@ FunHook<void()> frametime_reset_hook{
         frametime_reset_hook.call_target();
 
         // Set initial FPS limit
-        unsigned max_fps = rf::is_dedicated_server ? g_game_config.server_max_fps.value() : g_game_config.max_fps.value();
-        rf::frametime_min = 1.0f / static_cast<float>(max_fps);
+        if (rf::is_dedicated_server) {
+            // Dedicated server is paced by the tick scheduler. Engine limiter only sleeps with millisecond precision.
+            server_tick_init();
+            server_tick_set_rate(g_game_config.server_max_fps.value());
+            rf::frametime_min = server_frametime_min;
+        }
+        else {
+            rf::frametime_min = 1.0f / static_cast<float>(g_game_config.max_fps.value());
+        }
     },
 };
 
@@ -103,13 +114,16 @@ ConsoleCommand2 max_fps_cmd{
             int limit = std::clamp<int>(limit_opt.value(), GameConfig::min_fps_limit, GameConfig::max_fps_limit);
             if (rf::is_dedicated_server) {
                 g_game_config.server_max_fps = limit;
+                server_tick_set_rate(limit);
             }
             else {
                 g_game_config.max_fps = limit;
+                rf::frametime_min = 1.0f / limit;
             }
             g_game_config.save();
-            rf::frametime_min = 1.0f / limit;
         }
+        else if (rf::is_dedicated_server)
+            rf::console::print("Maximal FPS: {}", g_game_config.server_max_fps.value());
         else
             rf::console::print("Maximal FPS: {:.1f}", 1.0f / rf::frametime_min);
     },
@@ -133,6 +147,7 @@ void frametime_apply_patch()
 
     // Set initial FPS limit
     frametime_reset_hook.install();
+    server_tick_apply_patch();
 
     // Commands
     max_fps_cmd.register_cmd();
@@ -2,3 +2,7 @@
 
 void os_apply_patch();
 void frametime_render_ui();
+void server_tick_apply_patch();
+void server_tick_init();
+void server_tick_set_rate(unsigned rate);
+void server_tick_wait();
@@ -0,0 +1,163 @@
+#include <windows.h>
+#include <mmsystem.h>
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <xlog/xlog.h>
+#include "../rf/multi.h"
+#include "console.h"
+#include "os.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Remaining time that is spent busy-waiting instead of sleeping. Sleeping is not precise enough for the whole wait.
+constexpr long long server_tick_spin_us_high_res = 500;
+constexpr long long server_tick_spin_us_low_res = 2000;
+
+struct ServerTickStats
+{
+    unsigned long long num_ticks = 0;
+    unsigned long long num_overruns = 0;
+    unsigned long long num_resyncs = 0;
+    long long total_jitter_us = 0;
+    long long max_jitter_us = 0;
+    long long total_work_us = 0;
+    long long max_work_us = 0;
+};
+
+static LARGE_INTEGER g_server_tick_qpc_frequency;
+static HANDLE g_server_tick_timer = nullptr;
+static long long g_server_tick_spin_us = server_tick_spin_us_low_res;
+static long long g_server_tick_period_us = 0;
+static std::optional<long long> g_server_tick_deadline_us;
+static long long g_server_tick_last_wake_us = 0;
+static ServerTickStats g_server_tick_stats;
+
+static long long server_tick_now_us()
+{
+    LARGE_INTEGER qpc;
+    QueryPerformanceCounter(&qpc);
+    // Split the multiplication to avoid overflow for high QPC frequencies
+    long long freq = g_server_tick_qpc_frequency.QuadPart;
+    return qpc.QuadPart / freq * 1000000 + qpc.QuadPart % freq * 1000000 / freq;
+}
+
+static void server_tick_sleep_until(long long deadline_us)
+{
+    long long sleep_us = deadline_us - server_tick_now_us() - g_server_tick_spin_us;
+    if (sleep_us > 0) {
+        if (g_server_tick_timer) {
+            LARGE_INTEGER due_time;
+            // Negative value means relative time in 100 ns units
+            due_time.QuadPart = -sleep_us * 10;
+            if (SetWaitableTimer(g_server_tick_timer, &due_time, 0, nullptr, nullptr, FALSE)) {
+                WaitForSingleObject(g_server_tick_timer, INFINITE);
+            }
+        }
+        else {
+            Sleep(static_cast<DWORD>(sleep_us / 1000));
+        }
+    }
+    while (server_tick_now_us() < deadline_us) {
+        YieldProcessor();
+    }
+}
+
+void server_tick_init()
+{
+    if (g_server_tick_qpc_frequency.QuadPart != 0) {
+        // Already initialized
+        return;
+    }
+    QueryPerformanceFrequency(&g_server_tick_qpc_frequency);
+    // High resolution waitable timers are available since Windows 10 1803
+    g_server_tick_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+        TIMER_ALL_ACCESS);
+    if (g_server_tick_timer) {
+        g_server_tick_spin_us = server_tick_spin_us_high_res;
+    }
+    else {
+        // Increase system timer resolution so Sleep is accurate to about a millisecond
+        timeBeginPeriod(1);
+    }
+}
+
+void server_tick_set_rate(unsigned rate)
+{
+    g_server_tick_period_us = 1000000 / std::max(rate, 1u);
+    // Start a new schedule on the next tick
+    g_server_tick_deadline_us.reset();
+}
+
+void server_tick_wait()
+{
+    if (g_server_tick_period_us <= 0) {
+        return;
+    }
+    long long now = server_tick_now_us();
+    if (!g_server_tick_deadline_us) {
+        g_server_tick_deadline_us = now;
+        g_server_tick_last_wake_us = now;
+        return;
+    }
+
+    long long work_us = now - g_server_tick_last_wake_us;
+    g_server_tick_stats.total_work_us += work_us;
+    g_server_tick_stats.max_work_us = std::max(g_server_tick_stats.max_work_us, work_us);
+
+    // Deadlines are absolute so errors of single waits do not accumulate
+    long long deadline = g_server_tick_deadline_us.value() + g_server_tick_period_us;
+    if (now > deadline) {
+        ++g_server_tick_stats.num_overruns;
+        if (now - deadline > g_server_tick_period_us) {
+            // Frame took much longer than a tick (e.g. level load) - do not try to catch up with many short frames
+            ++g_server_tick_stats.num_resyncs;
+            deadline = now;
+        }
+    }
+    else {
+        server_tick_sleep_until(deadline);
+    }
+    long long wake = server_tick_now_us();
+    long long jitter = std::abs(wake - deadline);
+    ++g_server_tick_stats.num_ticks;
+    g_server_tick_stats.total_jitter_us += jitter;
+    g_server_tick_stats.max_jitter_us = std::max(g_server_tick_stats.max_jitter_us, jitter);
+    g_server_tick_deadline_us = deadline;
+    g_server_tick_last_wake_us = wake;
+}
+
+ConsoleCommand2 server_tick_cmd{
+    "server_tick",
+    [](std::optional<std::string> action) {
+        if (!rf::is_dedicated_server) {
+            rf::console::print("Tick scheduler is only used by dedicated server");
+            return;
+        }
+        if (action == "reset") {
+            g_server_tick_stats = {};
+            rf::console::print("Tick statistics cleared");
+            return;
+        }
+        const auto& stats = g_server_tick_stats;
+        auto num_ticks = std::max(stats.num_ticks, 1ull);
+        rf::console::print("Tick rate: {} Hz ({} timer)", 1000000 / std::max(g_server_tick_period_us, 1ll),
+            g_server_tick_timer ? "high resolution" : "default");
+        rf::console::print("Ticks: {}, overruns: {}, resyncs: {}", stats.num_ticks, stats.num_overruns,
+            stats.num_resyncs);
+        rf::console::print("Jitter: avg {:.3f} ms, max {:.3f} ms", stats.total_jitter_us / 1000.0 / num_ticks,
+            stats.max_jitter_us / 1000.0);
+        rf::console::print("Work time: avg {:.3f} ms, max {:.3f} ms", stats.total_work_us / 1000.0 / num_ticks,
+            stats.max_work_us / 1000.0);
+    },
+    "Prints dedicated server tick timing statistics",
+    "server_tick [reset]",
+};
+
+void server_tick_apply_patch()
+{
+    server_tick_cmd.register_cmd();
+}
@@ -64,6 +64,8 @@ namespace rf::gr
     static auto& light_filter_reset = addr_as_ref<void()>(0x004D9FA0);
     static auto& light_get_ambient = addr_as_ref<void(float *r, float *g, float *b)>(0x004D8D10);
 
+    // Light cache key - room light lists are rebuilt when it does not match GRoom::light_state
+    static auto& light_state = addr_as_ref<int>(0x00C96874);
     static auto& num_relevant_lights = addr_as_ref<int>(0x00C9687C);
     static auto& relevant_lights = addr_as_ref<Light*[1100]>(0x00C4D588);
 }
@@ -11,6 +11,8 @@ namespace rf
     // Forward declarations
     struct Player;
     struct Entity;
+    struct Weapon;
+    struct LevelCollisionOut;
 
     // nw/psnet
 
@@ -156,6 +158,7 @@ namespace rf
     static auto& multi_set_next_weapon = addr_as_ref<void(int weapon_type)>(0x0047FCA0);
     static auto& multi_change_level = addr_as_ref<void(const char* filename)>(0x0047BF50);
     static auto& multi_ping_player = addr_as_ref<void(Player*)>(0x00484D00);
+    static auto& multi_lag_comp_handle_hit = addr_as_ref<int(LevelCollisionOut *col_info, Weapon *wp)>(0x0046F380);
     static auto& send_entity_create_packet = addr_as_ref<void(Entity *entity, Player* player)>(0x00475160);
     static auto& send_entity_create_packet_to_all = addr_as_ref<void(Entity *entity)>(0x00475110);
     static auto& multi_find_character = addr_as_ref<int(const char *name)>(0x00476270);
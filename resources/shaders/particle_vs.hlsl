@@ -0,0 +1,48 @@
+struct VsInput
+{
+    float2 corner : POSITION;
+    float2 uv0 : TEXCOORD0;
+    float4 pos_and_radius : TEXCOORD1;
+    float angle : TEXCOORD2;
+    float4 color : COLOR;
+};
+
+cbuffer ModelTransformBuffer : register(b0)
+{
+    float4x3 world_mat;
+};
+
+cbuffer ViewProjTransformBuffer : register(b1)
+{
+    float4x3 view_mat;
+    float4x4 proj_mat;
+};
+
+struct VsOutput
+{
+    float4 pos : SV_POSITION;
+    float3 norm : NORMAL;
+    float4 color : COLOR;
+    float2 uv0 : TEXCOORD0;
+    float2 uv1 : TEXCOORD1;
+    float4 world_pos_and_depth : TEXCOORD2;
+};
+
+VsOutput main(VsInput input)
+{
+    VsOutput output;
+    float3 world_pos = input.pos_and_radius.xyz;
+    float3 view_pos = mul(float4(world_pos, 1), view_mat);
+    // Expand the quad in view space so it always faces the camera
+    float s = sin(input.angle);
+    float c = cos(input.angle);
+    float2 offset = float2(input.corner.x * c - input.corner.y * s, input.corner.x * s + input.corner.y * c);
+    view_pos.xy += offset * input.pos_and_radius.w;
+    output.pos = mul(float4(view_pos, 1), proj_mat);
+    output.norm = float3(0, 0, 0); // dummy normal
+    output.uv0 = input.uv0;
+    output.uv1 = float2(0, 0);
+    output.color = input.color;
+    output.world_pos_and_depth = float4(world_pos, view_pos.z);
+    return output;
+}
@@ -0,0 +1,789 @@
+// Headless load generator for Dash Faction dedicated servers
+//
+// Every simulated client uses its own UDP socket and goes through the same steps as the game: join_request,
+// reliable connection handshake, state_info_request, respawn_request and then it periodically sends obj_update,
+// weapon_fire and chat_line packets. Server response times and traffic are measured and printed every second.
+//
+// Note: reliable connection packet types are taken from rfproto.h. Their payload is not documented and it is not
+// used by the server so control packets are sent without any data.
+
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <common/net/PacketCodec.h>
+#include <common/rfproto.h>
+#include <common/version/version.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using socket_t = SOCKET;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using socket_t = int;
+constexpr socket_t INVALID_SOCKET = -1;
+#endif
+
+constexpr uint32_t dash_faction_signature = 0xDA58FAC7;
+constexpr int max_datagram_size = 512;
+constexpr uint32_t resend_interval_ms = 1000;
+constexpr uint32_t reliable_resend_interval_ms = 500;
+constexpr uint32_t heartbeat_interval_ms = 1000;
+
+// RF_ReliablePacket without the flexible array member so it can be copied by value
+#pragma pack(push, 1)
+struct ReliablePacketHeader
+{
+    uint8_t type;
+    uint8_t unknown;
+    uint16_t id;
+    uint16_t len;
+    uint32_t ticks;
+};
+#pragma pack(pop)
+static_assert(sizeof(ReliablePacketHeader) == offsetof(RF_ReliablePacket, data));
+
+struct LoadOptions
+{
+    std::string host = "127.0.0.1";
+    uint16_t port = 7755;
+    int num_clients = 8;
+    int duration_s = 60;
+    int join_interval_ms = 100;
+    float obj_update_rate = 20.0f;
+    float fire_rate = 2.0f;
+    float chat_rate = 0.1f;
+    std::string password;
+    std::string name_prefix = "loadgen";
+    uint32_t tables_vpp_checksum = 0x1AC2407E;
+    uint32_t tables_vpp_size = 0;
+    unsigned seed = 1;
+};
+
+class LatencyStats
+{
+public:
+    void add(uint32_t value)
+    {
+        samples_.push_back(value);
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return samples_.empty();
+    }
+
+    [[nodiscard]] uint32_t percentile(double p) const
+    {
+        if (samples_.empty()) {
+            return 0;
+        }
+        std::vector<uint32_t> sorted = samples_;
+        auto index = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1));
+        std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(index), sorted.end());
+        return sorted[index];
+    }
+
+    void clear()
+    {
+        samples_.clear();
+    }
+
+private:
+    std::vector<uint32_t> samples_;
+};
+
+// Remembers which of the recently received reliable packet IDs were already processed. IDs wrap around so they are
+// compared relative to the newest one.
+class ReceivedIdWindow
+{
+public:
+    // Returns false if the packet was already received or is too old to tell
+    bool insert(uint16_t id)
+    {
+        if (!newest_) {
+            newest_ = id;
+            received_.set(id % window_size);
+            return true;
+        }
+        auto diff = static_cast<int16_t>(static_cast<uint16_t>(id - newest_.value()));
+        if (diff > 0) {
+            // Forget IDs that are now outside of the window
+            for (int i = 1; i <= std::min<int>(diff, window_size); ++i) {
+                received_.reset(static_cast<uint16_t>(newest_.value() + i) % window_size);
+            }
+            newest_ = id;
+        }
+        else if (-diff >= window_size || received_.test(id % window_size)) {
+            return false;
+        }
+        received_.set(id % window_size);
+        return true;
+    }
+
+private:
+    // Must divide 65536 so positions in the bitset do not change when IDs wrap around
+    static constexpr int window_size = 1024;
+    std::bitset<window_size> received_;
+    std::optional<uint16_t> newest_;
+};
+
+struct LoadStats
+{
+    unsigned long long packets_sent = 0;
+    unsigned long long bytes_sent = 0;
+    unsigned long long packets_received = 0;
+    unsigned long long bytes_received = 0;
+    unsigned long long obj_updates_received = 0;
+    unsigned long long reliable_resends = 0;
+    int num_joined = 0;
+    int num_in_game = 0;
+    int num_denied = 0;
+    LatencyStats join_latency;
+    LatencyStats state_info_latency;
+    LatencyStats reliable_rtt;
+};
+
+static uint32_t get_ticks()
+{
+    static auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+static void close_socket(socket_t sock)
+{
+#ifdef _WIN32
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+}
+
+static bool set_non_blocking(socket_t sock)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(sock, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+enum class ClientState
+{
+    joining,
+    connecting_reliable,
+    loading_level,
+    spawning,
+    in_game,
+    denied,
+};
+
+class LoadClient
+{
+public:
+    LoadClient(int index, const LoadOptions& options, const sockaddr_in& server_addr, LoadStats& stats) :
+        index_(index), options_(options), server_addr_(server_addr), stats_(stats),
+        rng_(options.seed + static_cast<unsigned>(index))
+    {}
+
+    ~LoadClient()
+    {
+        if (sock_ != INVALID_SOCKET) {
+            close_socket(sock_);
+        }
+    }
+
+    LoadClient(const LoadClient&) = delete;
+    LoadClient& operator=(const LoadClient&) = delete;
+
+    bool open()
+    {
+        sock_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (sock_ == INVALID_SOCKET) {
+            return false;
+        }
+        sockaddr_in local_addr{};
+        local_addr.sin_family = AF_INET;
+        local_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        local_addr.sin_port = 0;
+        return bind(sock_, reinterpret_cast<sockaddr*>(&local_addr), sizeof(local_addr)) == 0 &&
+            set_non_blocking(sock_);
+    }
+
+    void do_frame(uint32_t now)
+    {
+        receive(now);
+        switch (state_) {
+            case ClientState::joining:
+                if (!join_request_sent_ms_ || now - last_join_request_ms_ >= resend_interval_ms) {
+                    send_join_request(now);
+                }
+                break;
+            case ClientState::connecting_reliable:
+                if (now - last_reliable_control_ms_ >= resend_interval_ms) {
+                    last_reliable_control_ms_ = now;
+                    send_reliable_control(RF_RPT_JOIN_03);
+                }
+                break;
+            case ClientState::spawning:
+                if (now - last_respawn_request_ms_ >= resend_interval_ms) {
+                    send_respawn_request(now);
+                }
+                break;
+            case ClientState::in_game:
+                simulate(now);
+                break;
+            default:
+                break;
+        }
+        if (reliable_connected_) {
+            if (now - last_reliable_control_ms_ >= heartbeat_interval_ms) {
+                last_reliable_control_ms_ = now;
+                send_reliable_control(RF_RPT_JOIN_05);
+            }
+            resend_reliable_packets(now);
+        }
+    }
+
+    [[nodiscard]] ClientState state() const
+    {
+        return state_;
+    }
+
+private:
+    struct PendingReliablePacket
+    {
+        uint16_t id;
+        uint32_t first_sent_ms;
+        uint32_t last_sent_ms;
+        std::vector<std::byte> datagram;
+    };
+
+    void send_datagram(const void* data, std::size_t len)
+    {
+        sendto(sock_, static_cast<const char*>(data), static_cast<int>(len), 0,
+            reinterpret_cast<const sockaddr*>(&server_addr_), sizeof(server_addr_));
+        ++stats_.packets_sent;
+        stats_.bytes_sent += len;
+    }
+
+    template<typename F>
+    void send_game_packet(uint8_t type, F&& write_payload)
+    {
+        std::byte buf[max_datagram_size];
+        buf[0] = static_cast<std::byte>(RF_GAME);
+        auto len = write_game_packet(buf + 1, sizeof(buf) - 1, type, write_payload);
+        if (len > 0) {
+            send_datagram(buf, len + 1);
+        }
+    }
+
+    template<typename F>
+    void send_reliable_game_packet(uint8_t type, F&& write_payload)
+    {
+        std::byte buf[max_datagram_size];
+        constexpr std::size_t data_offset = 1 + sizeof(ReliablePacketHeader);
+        auto len = write_game_packet(buf + data_offset, sizeof(buf) - data_offset, type, write_payload);
+        if (len == 0) {
+            return;
+        }
+        uint32_t now = get_ticks();
+        ReliablePacketHeader header{};
+        header.type = RF_RPT_PACKETS;
+        header.id = next_reliable_id_++;
+        header.len = static_cast<uint16_t>(len);
+        header.ticks = now;
+        buf[0] = static_cast<std::byte>(RF_RELIABLE);
+        std::memcpy(buf + 1, &header, sizeof(header));
+        send_datagram(buf, data_offset + len);
+        pending_reliable_.push_back({header.id, now, now, {buf, buf + data_offset + len}});
+    }
+
+    void send_reliable_control(uint8_t type)
+    {
+        std::byte buf[1 + sizeof(ReliablePacketHeader)];
+        ReliablePacketHeader header{};
+        header.type = type;
+        header.ticks = get_ticks();
+        buf[0] = static_cast<std::byte>(RF_RELIABLE);
+        std::memcpy(buf + 1, &header, sizeof(header));
+        send_datagram(buf, sizeof(buf));
+    }
+
+    void send_reliable_reply(const ReliablePacketHeader& packet)
+    {
+        std::byte buf[1 + sizeof(RF_ReliableReplyPacket)];
+        RF_ReliableReplyPacket reply{};
+        reply.type = RF_RPT_REPLY;
+        reply.len = 4;
+        reply.ticks = packet.ticks;
+        reply.packet_id = packet.id;
+        buf[0] = static_cast<std::byte>(RF_RELIABLE);
+        std::memcpy(buf + 1, &reply, sizeof(reply));
+        send_datagram(buf, sizeof(buf));
+    }
+
+    void resend_reliable_packets(uint32_t now)
+    {
+        for (auto& pending : pending_reliable_) {
+            if (now - pending.last_sent_ms >= reliable_resend_interval_ms) {
+                pending.last_sent_ms = now;
+                send_datagram(pending.datagram.data(), pending.datagram.size());
+                ++stats_.reliable_resends;
+            }
+        }
+    }
+
+    void send_join_request(uint32_t now)
+    {
+        if (!join_request_sent_ms_) {
+            join_request_sent_ms_ = {now};
+        }
+        last_join_request_ms_ = now;
+        name_ = options_.name_prefix + std::to_string(index_);
+        send_game_packet(RF_GPT_JOIN_REQUEST, [&](PacketWriter& writer) {
+            writer.write<uint8_t>(RF_VER_12);
+            writer.write_string(name_);
+            writer.write<uint32_t>(5); // entity type
+            writer.write_string(options_.password);
+            writer.write<uint32_t>(100000); // rate
+            writer.write<uint32_t>(options_.tables_vpp_checksum);
+            writer.write<uint32_t>(options_.tables_vpp_size);
+            writer.write<uint32_t>(0); // mod VPP checksum
+            writer.write<uint32_t>(0); // mod VPP size
+            // Dash Faction signature
+            writer.write<uint32_t>(dash_faction_signature);
+            writer.write<uint8_t>(VERSION_MAJOR);
+            return writer.write<uint8_t>(VERSION_MINOR);
+        });
+    }
+
+    void send_respawn_request(uint32_t now)
+    {
+        last_respawn_request_ms_ = now;
+        send_game_packet(RF_GPT_RESPAWN_REQUEST, [&](PacketWriter& writer) {
+            writer.write<uint32_t>(0); // character
+            return writer.write<uint8_t>(player_id_);
+        });
+    }
+
+    void simulate(uint32_t now)
+    {
+        std::uniform_real_distribution<float> unit_dist{-1.0f, 1.0f};
+        std::uniform_real_distribution<float> probability_dist{0.0f, 1.0f};
+        float dt = static_cast<float>(now - last_simulate_ms_) / 1000.0f;
+        last_simulate_ms_ = now;
+
+        if (options_.obj_update_rate > 0 && now - last_obj_update_ms_ >= 1000.0f / options_.obj_update_rate) {
+            last_obj_update_ms_ = now;
+            // Random walk around the spawn point
+            yaw_ += unit_dist(rng_) * 0.3f;
+            pos_.x += std::cos(yaw_) * 8.0f * dt;
+            pos_.z += std::sin(yaw_) * 8.0f * dt;
+            send_game_packet(RF_GPT_OBJECT_UPDATE, [&](PacketWriter& writer) {
+                writer.write<uint32_t>(entity_handle_);
+                writer.write<uint8_t>(RF_OUF_POS_ROT_ANIM);
+                writer.write<uint16_t>(static_cast<uint16_t>(now));
+                writer.write(pos_);
+                writer.write<int16_t>(0);
+                writer.write<int16_t>(static_cast<int16_t>(yaw_ * 10430.0f));
+                writer.write<uint8_t>(0);
+                writer.write<int8_t>(static_cast<int8_t>(std::cos(yaw_) * 127.0f));
+                writer.write<int8_t>(static_cast<int8_t>(std::sin(yaw_) * 127.0f));
+                writer.write<int8_t>(64);
+                return writer.write<uint32_t>(0xFFFFFFFF);
+            });
+        }
+        if (probability_dist(rng_) < options_.fire_rate * dt) {
+            send_game_packet(RF_GPT_WEAPON_FIRE, [&](PacketWriter& writer) {
+                writer.write<uint8_t>(weapon_type_);
+                writer.write<uint8_t>(0);
+                writer.write(pos_);
+                writer.write<int16_t>(static_cast<int16_t>(std::cos(yaw_) * 32767.0f));
+                writer.write<int16_t>(0);
+                return writer.write<int16_t>(static_cast<int16_t>(std::sin(yaw_) * 32767.0f));
+            });
+        }
+        if (probability_dist(rng_) < options_.chat_rate * dt) {
+            send_reliable_game_packet(RF_GPT_CHAT_LINE, [&](PacketWriter& writer) {
+                writer.write<uint8_t>(player_id_);
+                writer.write<uint8_t>(0);
+                return writer.write_string("load test message " + std::to_string(now));
+            });
+        }
+    }
+
+    void receive(uint32_t now)
+    {
+        std::byte buf[2048];
+        while (true) {
+            sockaddr_in from{};
+            socklen_t from_len = sizeof(from);
+            auto len = recvfrom(sock_, reinterpret_cast<char*>(buf), sizeof(buf), 0,
+                reinterpret_cast<sockaddr*>(&from), &from_len);
+            if (len <= 0) {
+                break;
+            }
+            ++stats_.packets_received;
+            stats_.bytes_received += static_cast<unsigned long long>(len);
+            if (from.sin_addr.s_addr != server_addr_.sin_addr.s_addr || from.sin_port != server_addr_.sin_port) {
+                continue;
+            }
+            process_datagram(buf, static_cast<std::size_t>(len), now);
+        }
+    }
+
+    void process_datagram(const std::byte* data, std::size_t len, uint32_t now)
+    {
+        if (len < 1) {
+            return;
+        }
+        auto main_type = static_cast<uint8_t>(data[0]);
+        if (main_type == RF_GAME) {
+            process_game_packets(data + 1, len - 1, now);
+        }
+        else if (main_type == RF_RELIABLE) {
+            process_reliable_packet(data + 1, len - 1, now);
+        }
+    }
+
+    void process_reliable_packet(const std::byte* data, std::size_t len, uint32_t now)
+    {
+        PacketReader reader{data, len};
+        auto header = reader.read<ReliablePacketHeader>();
+        if (!header) {
+            return;
+        }
+        switch (header.value().type) {
+            case RF_RPT_REPLY: {
+                RF_ReliableReplyPacket reply;
+                if (len < sizeof(reply)) {
+                    return;
+                }
+                std::memcpy(&reply, data, sizeof(reply));
+                auto it = std::find_if(pending_reliable_.begin(), pending_reliable_.end(), [&](const auto& p) {
+                    return p.id == reply.packet_id;
+                });
+                if (it != pending_reliable_.end()) {
+                    stats_.reliable_rtt.add(now - it->first_sent_ms);
+                    pending_reliable_.erase(it);
+                }
+                break;
+            }
+            case RF_RPT_PACKETS:
+                send_reliable_reply(header.value());
+                // Packets can be retransmitted so skip the ones that were already processed
+                if (received_reliable_ids_.insert(header.value().id)) {
+                    std::size_t data_len = std::min<std::size_t>(header.value().len, reader.remaining());
+                    process_game_packets(reader.current(), data_len, now);
+                }
+                break;
+            case RF_RPT_JOIN_03:
+                // Server opened the connection first
+                send_reliable_control(RF_RPT_JOIN_06);
+                on_reliable_connected(now);
+                break;
+            case RF_RPT_JOIN_06:
+                on_reliable_connected(now);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void on_reliable_connected(uint32_t now)
+    {
+        if (reliable_connected_) {
+            return;
+        }
+        reliable_connected_ = true;
+        state_ = ClientState::loading_level;
+        state_info_request_sent_ms_ = now;
+        send_reliable_game_packet(RF_GPT_STATE_INFO_REQUEST, [&](PacketWriter& writer) {
+            return writer.write_string(level_);
+        });
+    }
+
+    void process_game_packets(const std::byte* data, std::size_t len, uint32_t now)
+    {
+        std::size_t offset = 0;
+        while (offset < len) {
+            RF_GamePacketHeader header;
+            auto reader = read_game_packet(data + offset, len - offset, header);
+            if (!reader) {
+                break;
+            }
+            process_game_packet(header, reader.value(), now);
+            offset += sizeof(header) + header.size;
+        }
+    }
+
+    void process_game_packet(const RF_GamePacketHeader& header, PacketReader& reader, uint32_t now)
+    {
+        switch (header.type) {
+            case RF_GPT_JOIN_ACCEPT: {
+                if (state_ != ClientState::joining) {
+                    break;
+                }
+                auto level = reader.read_string(255);
+                auto rest = reader.read<RF_JoinAcceptRest>();
+                if (!level || !rest) {
+                    break;
+                }
+                level_ = level.value();
+                player_id_ = rest.value().player_id;
+                stats_.join_latency.add(now - join_request_sent_ms_.value_or(now));
+                ++stats_.num_joined;
+                state_ = ClientState::connecting_reliable;
+                last_reliable_control_ms_ = now;
+                send_reliable_control(RF_RPT_JOIN_03);
+                break;
+            }
+            case RF_GPT_JOIN_DENY: {
+                auto reason = reader.read<uint8_t>();
+                std::printf("Client %d was denied to join (reason %d)\n", index_, reason.value_or(0));
+                ++stats_.num_denied;
+                state_ = ClientState::denied;
+                break;
+            }
+            case RF_GPT_STATE_INFO_DONE:
+                if (state_ == ClientState::loading_level) {
+                    stats_.state_info_latency.add(now - state_info_request_sent_ms_);
+                    send_reliable_game_packet(RF_GPT_CLIENT_IN_GAME, [&](PacketWriter& writer) {
+                        return writer.write<uint8_t>(player_id_);
+                    });
+                    state_ = ClientState::spawning;
+                    send_respawn_request(now);
+                }
+                break;
+            case RF_GPT_ENTITY_CREATE: {
+                auto packet = read_entity_create_packet(reader);
+                if (state_ == ClientState::spawning && packet && packet.value().rest.player_id == player_id_) {
+                    const auto& rest = packet.value().rest;
+                    entity_handle_ = rest.entity_handle;
+                    weapon_type_ = static_cast<uint8_t>(rest.weapon);
+                    pos_ = rest.pos;
+                    last_simulate_ms_ = now;
+                    state_ = ClientState::in_game;
+                    ++stats_.num_in_game;
+                }
+                break;
+            }
+            case RF_GPT_OBJECT_UPDATE:
+                ++stats_.obj_updates_received;
+                break;
+            case RF_GPT_PING: {
+                // Echo the payload so the server can measure latency
+                std::vector<std::byte> payload{reader.current(), reader.current() + reader.remaining()};
+                send_game_packet(RF_GPT_PONG, [&](PacketWriter& writer) {
+                    return writer.write_bytes(payload.data(), payload.size());
+                });
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    int index_;
+    const LoadOptions& options_;
+    sockaddr_in server_addr_;
+    LoadStats& stats_;
+    std::mt19937 rng_;
+    socket_t sock_ = INVALID_SOCKET;
+    ClientState state_ = ClientState::joining;
+    std::string name_;
+    std::string level_;
+    uint8_t player_id_ = 0;
+    uint32_t entity_handle_ = 0;
+    uint8_t weapon_type_ = 0;
+    RF_Vector pos_{};
+    float yaw_ = 0.0f;
+    std::optional<uint32_t> join_request_sent_ms_;
+    uint32_t last_join_request_ms_ = 0;
+    uint32_t state_info_request_sent_ms_ = 0;
+    uint32_t last_respawn_request_ms_ = 0;
+    uint32_t last_reliable_control_ms_ = 0;
+    uint32_t last_obj_update_ms_ = 0;
+    uint32_t last_simulate_ms_ = 0;
+    bool reliable_connected_ = false;
+    uint16_t next_reliable_id_ = 0;
+    std::deque<PendingReliablePacket> pending_reliable_;
+    ReceivedIdWindow received_reliable_ids_;
+};
+
+static void print_stats(const LoadStats& stats, double seconds)
+{
+    std::printf("Joined %d, in game %d, denied %d | out %.0f pkt/s %.1f KB/s | in %.0f pkt/s %.1f KB/s | "
+                "obj_update %.0f/s | reliable RTT p50 %u p95 %u p99 %u ms, resends %llu\n",
+        stats.num_joined, stats.num_in_game, stats.num_denied,
+        static_cast<double>(stats.packets_sent) / seconds, static_cast<double>(stats.bytes_sent) / seconds / 1024.0,
+        static_cast<double>(stats.packets_received) / seconds,
+        static_cast<double>(stats.bytes_received) / seconds / 1024.0,
+        static_cast<double>(stats.obj_updates_received) / seconds, stats.reliable_rtt.percentile(0.5),
+        stats.reliable_rtt.percentile(0.95), stats.reliable_rtt.percentile(0.99), stats.reliable_resends);
+}
+
+static void reset_interval_stats(LoadStats& stats)
+{
+    stats.packets_sent = 0;
+    stats.bytes_sent = 0;
+    stats.packets_received = 0;
+    stats.bytes_received = 0;
+    stats.obj_updates_received = 0;
+    stats.reliable_resends = 0;
+    stats.reliable_rtt.clear();
+}
+
+static bool resolve_server_addr(const LoadOptions& options, sockaddr_in& addr)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(options.host.c_str(), nullptr, &hints, &result) != 0 || !result) {
+        return false;
+    }
+    std::memcpy(&addr, result->ai_addr, sizeof(addr));
+    addr.sin_port = htons(options.port);
+    freeaddrinfo(result);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        bool has_value = i + 1 < argc;
+        if (arg == "-s" && has_value) {
+            options.host = argv[++i];
+        }
+        else if (arg == "-p" && has_value) {
+            options.port = static_cast<uint16_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "-n" && has_value) {
+            options.num_clients = std::stoi(argv[++i]);
+        }
+        else if (arg == "-d" && has_value) {
+            options.duration_s = std::stoi(argv[++i]);
+        }
+        else if (arg == "-j" && has_value) {
+            options.join_interval_ms = std::stoi(argv[++i]);
+        }
+        else if (arg == "-u" && has_value) {
+            options.obj_update_rate = std::stof(argv[++i]);
+        }
+        else if (arg == "-f" && has_value) {
+            options.fire_rate = std::stof(argv[++i]);
+        }
+        else if (arg == "-c" && has_value) {
+            options.chat_rate = std::stof(argv[++i]);
+        }
+        else if (arg == "-w" && has_value) {
+            options.password = argv[++i];
+        }
+        else if (arg == "-a" && has_value) {
+            options.name_prefix = argv[++i];
+        }
+        else if (arg == "-t" && has_value) {
+            options.tables_vpp_checksum = static_cast<uint32_t>(std::stoul(argv[++i], nullptr, 16));
+        }
+        else if (arg == "-T" && has_value) {
+            options.tables_vpp_size = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "-r" && has_value) {
+            options.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else {
+            std::printf(
+                "Usage: load_generator [options...]\n\n"
+                "Available options:\n"
+                "-s host        server host (default: 127.0.0.1)\n"
+                "-p port        server port (default: 7755)\n"
+                "-n count       number of simulated clients (default: 8)\n"
+                "-d seconds     test duration (default: 60)\n"
+                "-j ms          delay between joining clients (default: 100)\n"
+                "-u rate        obj_update packets per second per client (default: 20)\n"
+                "-f rate        weapon_fire packets per second per client (default: 2)\n"
+                "-c rate        chat_line packets per second per client (default: 0.1)\n"
+                "-w password    server password\n"
+                "-a prefix      player name prefix (default: loadgen)\n"
+                "-t checksum    tables.vpp checksum in hex (default: 1AC2407E)\n"
+                "-T size        tables.vpp size (default: 0)\n"
+                "-r seed        random seed (default: 1)\n"
+            );
+            return 1;
+        }
+    }
+
+#ifdef _WIN32
+    WSADATA wsa_data;
+    WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+
+    sockaddr_in server_addr{};
+    if (!resolve_server_addr(options, server_addr)) {
+        std::fprintf(stderr, "Cannot resolve %s\n", options.host.c_str());
+        return 1;
+    }
+
+    LoadStats stats;
+    std::vector<std::unique_ptr<LoadClient>> clients;
+    uint32_t start = get_ticks();
+    uint32_t last_report = start;
+    while (get_ticks() - start < static_cast<uint32_t>(options.duration_s) * 1000) {
+        uint32_t now = get_ticks();
+        // Join clients gradually like real players do
+        while (static_cast<int>(clients.size()) < options.num_clients &&
+            now - start >= static_cast<uint32_t>(clients.size()) * static_cast<uint32_t>(options.join_interval_ms)) {
+            auto client = std::make_unique<LoadClient>(static_cast<int>(clients.size()), options, server_addr, stats);
+            if (!client->open()) {
+                std::fprintf(stderr, "Cannot open socket\n");
+                return 1;
+            }
+            clients.push_back(std::move(client));
+        }
+        for (auto& client : clients) {
+            client->do_frame(now);
+        }
+        if (now - last_report >= 1000) {
+            print_stats(stats, (now - last_report) / 1000.0);
+            reset_interval_stats(stats);
+            last_report = now;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    if (!stats.join_latency.empty()) {
+        std::printf("Join latency p50 %u p95 %u max %u ms\n", stats.join_latency.percentile(0.5),
+            stats.join_latency.percentile(0.95), stats.join_latency.percentile(1.0));
+    }
+    if (!stats.state_info_latency.empty()) {
+        std::printf("State info latency p50 %u p95 %u max %u ms\n", stats.state_info_latency.percentile(0.5),
+            stats.state_info_latency.percentile(0.95), stats.state_info_latency.percentile(1.0));
+    }
+    clients.clear();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return stats.num_denied > 0 ? 2 : 0;
+}
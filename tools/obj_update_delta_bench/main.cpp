@@ -0,0 +1,280 @@
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <common/net/ObjUpdateDelta.h>
+#include <common/net/PacketLog.h>
+#include <common/rfproto.h>
+
+struct BenchOptions
+{
+    const char* packet_log = nullptr;
+    int num_packets = 10000;
+    int num_objects = 16;
+    double loss = 0.05;
+    unsigned ack_delay = 3;
+    unsigned seed = 1;
+};
+
+struct BenchResult
+{
+    unsigned num_packets = 0;
+    unsigned num_delivered = 0;
+    unsigned num_decoded = 0;
+    unsigned num_mismatched = 0;
+    unsigned long long stock_bytes = 0;
+    unsigned long long delta_bytes = 0;
+    double encode_seconds = 0;
+    double decode_seconds = 0;
+};
+
+// Generates obj_update payloads of players running around a level
+class SyntheticObjUpdates
+{
+public:
+    SyntheticObjUpdates(int num_objects, unsigned seed) : rng_{seed}
+    {
+        std::uniform_real_distribution<float> pos_dist{-100.0f, 100.0f};
+        for (int i = 0; i < num_objects; ++i) {
+            SyntheticObject obj;
+            obj.handle = 0x1000 + static_cast<uint32_t>(i) * 7;
+            obj.pos = {pos_dist(rng_), pos_dist(rng_), pos_dist(rng_)};
+            objects_.push_back(obj);
+        }
+    }
+
+    std::vector<std::byte> next()
+    {
+        ticks_ += 85;
+        std::uniform_real_distribution<float> dir_dist{-1.0f, 1.0f};
+        std::uniform_int_distribution<int> percent_dist{0, 99};
+        ObjUpdateSnapshot snapshot;
+        for (auto& obj : objects_) {
+            if (percent_dist(rng_) < 10) {
+                obj.vel = {dir_dist(rng_) * 10.0f, 0.0f, dir_dist(rng_) * 10.0f};
+            }
+            for (int i = 0; i < 3; ++i) {
+                obj.pos[i] += obj.vel[i] * 0.085f;
+            }
+            obj.yaw = static_cast<int16_t>(obj.yaw + static_cast<int>(dir_dist(rng_) * 500.0f));
+            obj.pitch = static_cast<int16_t>(dir_dist(rng_) * 2000.0f);
+            if (percent_dist(rng_) < 2) {
+                obj.health = static_cast<uint8_t>(std::max(obj.health - 10, 1));
+            }
+
+            ObjUpdateState state;
+            state.handle = obj.handle;
+            state.flags = ObjUpdateState::flag_pos_rot_anim | 0x20;
+            state.ticks = ticks_;
+            for (int i = 0; i < 3; ++i) {
+                state.pos[i] = static_cast<int32_t>(std::lround(obj.pos[i] * obj_update_pos_scale));
+            }
+            state.angle_x = obj.pitch;
+            state.angle_y = obj.yaw;
+            state.movement = {0, static_cast<uint8_t>(obj.vel[0] * 12.0f), static_cast<uint8_t>(obj.vel[2] * 12.0f), 100};
+            state.extra = {std::byte{obj.health}, std::byte{50}, std::byte{0}};
+            snapshot.push_back(state);
+        }
+        std::vector<std::byte> payload;
+        obj_update_write(snapshot, payload);
+        return payload;
+    }
+
+private:
+    struct SyntheticObject
+    {
+        uint32_t handle = 0;
+        std::array<float, 3> pos{};
+        std::array<float, 3> vel{};
+        int16_t yaw = 0;
+        int16_t pitch = 0;
+        uint8_t health = 100;
+    };
+
+    std::mt19937 rng_;
+    std::vector<SyntheticObject> objects_;
+    uint16_t ticks_ = 0;
+};
+
+// Simulates a client connection with packet loss and delayed acknowledgements
+class DeltaChannel
+{
+public:
+    DeltaChannel(const BenchOptions& options) :
+        rng_{options.seed}, loss_{options.loss}, ack_delay_{options.ack_delay}
+    {}
+
+    void send(const std::vector<std::byte>& stock_payload, BenchResult& result)
+    {
+        ObjUpdateSnapshot sent_snapshot;
+        if (!obj_update_parse(stock_payload.data(), stock_payload.size(), sent_snapshot)) {
+            std::fprintf(stderr, "Failed to parse obj_update packet (%zu bytes)\n", stock_payload.size());
+            return;
+        }
+        ++result.num_packets;
+        result.stock_bytes += stock_payload.size();
+
+        encoded_.clear();
+        auto encode_start = std::chrono::steady_clock::now();
+        encoder_.encode(sent_snapshot, encoded_);
+        result.encode_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - encode_start).count();
+        result.delta_bytes += encoded_.size();
+
+        // Deliver acknowledgements after configured number of packets
+        while (!pending_acks_.empty() && pending_acks_.front().first <= result.num_packets) {
+            encoder_.ack(pending_acks_.front().second);
+            pending_acks_.pop_front();
+        }
+
+        std::bernoulli_distribution loss_dist{loss_};
+        if (loss_dist(rng_)) {
+            return;
+        }
+        ++result.num_delivered;
+
+        auto decode_start = std::chrono::steady_clock::now();
+        bool decoded = decoder_.decode(encoded_.data(), encoded_.size(), received_snapshot_);
+        if (decoded) {
+            received_payload_.clear();
+            obj_update_write(received_snapshot_, received_payload_);
+        }
+        result.decode_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - decode_start).count();
+        if (!decoded) {
+            return;
+        }
+        ++result.num_decoded;
+
+        // Decoded snapshot must be identical and rebuilt stock packet must parse to the same snapshot
+        ObjUpdateSnapshot reparsed_snapshot;
+        if (received_snapshot_ != sent_snapshot ||
+            !obj_update_parse(received_payload_.data(), received_payload_.size(), reparsed_snapshot) ||
+            reparsed_snapshot != sent_snapshot) {
+            ++result.num_mismatched;
+        }
+        if (!loss_dist(rng_)) {
+            pending_acks_.emplace_back(result.num_packets + ack_delay_, decoder_.last_sequence().value());
+        }
+    }
+
+private:
+    std::mt19937 rng_;
+    double loss_;
+    unsigned ack_delay_;
+    ObjUpdateDeltaEncoder encoder_;
+    ObjUpdateDeltaDecoder decoder_;
+    std::vector<std::byte> encoded_;
+    ObjUpdateSnapshot received_snapshot_;
+    std::vector<std::byte> received_payload_;
+    std::deque<std::pair<unsigned, uint16_t>> pending_acks_;
+};
+
+static void run_synthetic(const BenchOptions& options, BenchResult& result)
+{
+    SyntheticObjUpdates updates{options.num_objects, options.seed};
+    DeltaChannel channel{options};
+    for (int i = 0; i < options.num_packets; ++i) {
+        channel.send(updates.next(), result);
+    }
+}
+
+static void run_packet_log(const BenchOptions& options, BenchResult& result)
+{
+    // Client-side capture contains packets from a single server so all obj_update packets go through one channel
+    PacketLogReader reader{options.packet_log};
+    PacketLogRecord record;
+    DeltaChannel channel{options};
+    while (reader.read(record)) {
+        std::size_t offset = 0;
+        while (offset + sizeof(RF_GamePacketHeader) <= record.data.size()) {
+            RF_GamePacketHeader header;
+            std::memcpy(&header, record.data.data() + offset, sizeof(header));
+            std::size_t packet_size = sizeof(header) + header.size;
+            if (offset + packet_size > record.data.size()) {
+                break;
+            }
+            if (header.type == RF_GPT_OBJECT_UPDATE) {
+                auto* payload = record.data.data() + offset + sizeof(header);
+                channel.send({payload, payload + header.size}, result);
+            }
+            offset += packet_size;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        bool has_value = i + 1 < argc;
+        if (arg == "-f" && has_value) {
+            options.packet_log = argv[++i];
+        }
+        else if (arg == "-n" && has_value) {
+            options.num_packets = std::stoi(argv[++i]);
+        }
+        else if (arg == "-o" && has_value) {
+            options.num_objects = std::stoi(argv[++i]);
+        }
+        else if (arg == "-l" && has_value) {
+            options.loss = std::stod(argv[++i]);
+        }
+        else if (arg == "-a" && has_value) {
+            options.ack_delay = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else if (arg == "-s" && has_value) {
+            options.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else {
+            std::printf(
+                "Usage: obj_update_delta_bench [options...]\n\n"
+                "Available options:\n"
+                "-f packet_log  uses obj_update packets from a packet log instead of synthetic ones\n"
+                "-n count       number of synthetic packets (default: 10000)\n"
+                "-o count       number of objects in synthetic packets (default: 16)\n"
+                "-l loss        packet loss ratio (default: 0.05)\n"
+                "-a packets     acknowledgement delay in packets (default: 3)\n"
+                "-s seed        random seed (default: 1)\n"
+            );
+            return 1;
+        }
+    }
+
+    BenchResult result;
+    try {
+        if (options.packet_log) {
+            run_packet_log(options, result);
+        }
+        else {
+            run_synthetic(options, result);
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    if (result.num_packets == 0) {
+        std::printf("No obj_update packets\n");
+        return 1;
+    }
+    std::printf("Packets: %u (%u delivered, %u decoded, %u mismatched)\n", result.num_packets, result.num_delivered,
+        result.num_decoded, result.num_mismatched);
+    std::printf("Stock bytes: %llu (avg %.1f)\n", result.stock_bytes,
+        static_cast<double>(result.stock_bytes) / result.num_packets);
+    std::printf("Delta bytes: %llu (avg %.1f, %.1f%% of stock)\n", result.delta_bytes,
+        static_cast<double>(result.delta_bytes) / result.num_packets,
+        100.0 * static_cast<double>(result.delta_bytes) / static_cast<double>(result.stock_bytes));
+    std::printf("Encode: %.2f us/packet\n", result.encode_seconds * 1e6 / result.num_packets);
+    if (result.num_delivered > 0) {
+        std::printf("Decode: %.2f us/packet\n", result.decode_seconds * 1e6 / result.num_delivered);
+    }
+    return result.num_mismatched == 0 ? 0 : 2;
+}
@@ -0,0 +1,115 @@
+// Fuzzing harness of the packet codec
+//
+// libFuzzer: clang++ -std=c++20 -DPACKET_CODEC_LIBFUZZER -fsanitize=fuzzer,address,undefined -I common/include fuzz.cpp
+// AFL:       afl-clang-fast++ -std=c++20 -I common/include fuzz.cpp (input is read from stdin)
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <common/net/PacketCodec.h>
+
+static void check(bool condition, const char* what)
+{
+    if (!condition) {
+        std::fprintf(stderr, "Check failed: %s\n", what);
+        std::abort();
+    }
+}
+
+static void fuzz_entity_create(PacketReader reader)
+{
+    auto packet = read_entity_create_packet(reader);
+    if (!packet) {
+        return;
+    }
+    // Encode it back and make sure the result is identical to the consumed part of the input
+    std::byte buf[512];
+    auto len = write_game_packet(buf, sizeof(buf), RF_GPT_ENTITY_CREATE, [&](PacketWriter& writer) {
+        writer.write_string(packet.value().name);
+        return writer.write(packet.value().rest);
+    });
+    check(len == 0 || len == sizeof(RF_GamePacketHeader) + reader.offset(), "entity_create size");
+    if (len > 0) {
+        check(std::memcmp(buf + sizeof(RF_GamePacketHeader), reader.current() - reader.offset(), reader.offset()) == 0,
+              "entity_create content");
+    }
+}
+
+static void fuzz_chat_line(PacketReader reader)
+{
+    auto player_id = reader.read<uint8_t>();
+    auto is_team_msg = reader.read<uint8_t>();
+    auto message = reader.read_string(RF_MAX_MSG_LEN);
+    check(reader.failed() == (!player_id || !is_team_msg || !message), "chat_line failed state");
+    if (message) {
+        check(message.value().size() <= RF_MAX_MSG_LEN, "chat_line message length");
+        check(message.value().find('\0') == std::string_view::npos, "chat_line message terminator");
+    }
+}
+
+static void fuzz_fixed(PacketReader reader, uint8_t type)
+{
+    if (type == RF_GPT_RELOAD) {
+        // entity handle, weapon type, ammo, clip ammo
+        std::size_t payload_size = reader.remaining();
+        auto values = reader.read<std::array<uint32_t, 4>>();
+        check(values.has_value() == (payload_size >= sizeof(RF_ReloadPacket) - sizeof(RF_GamePacketHeader)),
+              "reload size");
+    }
+    else if (type == RF_GPT_TEAM_CHANGE) {
+        auto player_id = reader.read<uint8_t>();
+        auto team = reader.read<uint8_t>();
+        check(reader.failed() || (player_id && team), "team_change fields");
+    }
+}
+
+static void fuzz_one(const uint8_t* data, std::size_t size)
+{
+    // Datagram can contain multiple game packets
+    std::size_t offset = 0;
+    while (offset < size) {
+        RF_GamePacketHeader header;
+        auto reader = read_game_packet(data + offset, size - offset, header);
+        if (!reader) {
+            break;
+        }
+        check(reader.value().remaining() == header.size, "payload size");
+        switch (header.type) {
+            case RF_GPT_ENTITY_CREATE:
+                fuzz_entity_create(reader.value());
+                break;
+            case RF_GPT_CHAT_LINE:
+                fuzz_chat_line(reader.value());
+                break;
+            default:
+                fuzz_fixed(reader.value(), header.type);
+                break;
+        }
+        offset += sizeof(header) + header.size;
+    }
+}
+
+#ifdef PACKET_CODEC_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size)
+{
+    fuzz_one(data, size);
+    return 0;
+}
+
+#else
+
+int main()
+{
+    std::vector<uint8_t> input;
+    int c;
+    while ((c = std::getchar()) != EOF) {
+        input.push_back(static_cast<uint8_t>(c));
+    }
+    fuzz_one(input.data(), input.size());
+    return 0;
+}
+
+#endif
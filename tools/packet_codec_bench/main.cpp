@@ -0,0 +1,180 @@
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <common/net/PacketCodec.h>
+
+struct BenchOptions
+{
+    int num_packets = 100000;
+    int num_iterations = 20;
+    unsigned seed = 1;
+};
+
+// Builds a stream of entity_create, reload and chat_line packets with random content
+static std::vector<std::byte> generate_packets(const BenchOptions& options)
+{
+    std::mt19937 rng{options.seed};
+    std::uniform_int_distribution<int> type_dist{0, 2};
+    std::uniform_int_distribution<int> len_dist{1, 20};
+    std::uniform_int_distribution<int> char_dist{'a', 'z'};
+    std::vector<std::byte> stream;
+    std::byte buf[512];
+    for (int i = 0; i < options.num_packets; ++i) {
+        std::string str;
+        int str_len = len_dist(rng);
+        for (int j = 0; j < str_len; ++j) {
+            str += static_cast<char>(char_dist(rng));
+        }
+        std::size_t len = 0;
+        switch (type_dist(rng)) {
+            case 0:
+                len = write_game_packet(buf, sizeof(buf), RF_GPT_ENTITY_CREATE, [&](PacketWriter& writer) {
+                    RF_EntityCreatePacketRest rest{};
+                    rest.entity_handle = static_cast<uint32_t>(i);
+                    rest.player_id = static_cast<uint8_t>(i % 2 ? 0xFF : i % 32);
+                    rest.weapon = static_cast<uint32_t>(i % 16);
+                    return writer.write_string(str) && writer.write(rest);
+                });
+                break;
+            case 1:
+                len = write_game_packet(buf, sizeof(buf), RF_GPT_RELOAD, [&](PacketWriter& writer) {
+                    std::array<uint32_t, 4> values{static_cast<uint32_t>(i), static_cast<uint32_t>(i % 16), 30, 120};
+                    return writer.write(values);
+                });
+                break;
+            default:
+                len = write_game_packet(buf, sizeof(buf), RF_GPT_CHAT_LINE, [&](PacketWriter& writer) {
+                    return writer.write<uint8_t>(static_cast<uint8_t>(i % 32)) && writer.write<uint8_t>(0) &&
+                        writer.write_string(str);
+                });
+                break;
+        }
+        stream.insert(stream.end(), buf, buf + len);
+    }
+    return stream;
+}
+
+// Parsing with hard-coded offsets like the handlers did before the codec existed (no length validation)
+static uint64_t parse_raw(const std::vector<std::byte>& stream)
+{
+    uint64_t checksum = 0;
+    std::size_t offset = 0;
+    while (offset < stream.size()) {
+        const auto* packet = reinterpret_cast<const char*>(stream.data() + offset);
+        RF_GamePacketHeader header;
+        std::memcpy(&header, packet, sizeof(header));
+        const char* data = packet + sizeof(header);
+        if (header.type == RF_GPT_ENTITY_CREATE) {
+            std::size_t name_size = std::strlen(data) + 1;
+            char player_id = data[name_size + 58];
+            if (player_id != '\xFF') {
+                uint32_t weapon_type;
+                std::memcpy(&weapon_type, data + name_size + 63, sizeof(weapon_type));
+                checksum += weapon_type;
+            }
+        }
+        else if (header.type == RF_GPT_RELOAD) {
+            uint32_t weapon_type;
+            std::memcpy(&weapon_type, data + 4, sizeof(weapon_type));
+            checksum += weapon_type;
+        }
+        else if (header.type == RF_GPT_CHAT_LINE) {
+            checksum += std::strlen(data + 2);
+        }
+        offset += sizeof(header) + header.size;
+    }
+    return checksum;
+}
+
+static uint64_t parse_codec(const std::vector<std::byte>& stream)
+{
+    uint64_t checksum = 0;
+    std::size_t offset = 0;
+    while (offset < stream.size()) {
+        RF_GamePacketHeader header;
+        auto reader = read_game_packet(stream.data() + offset, stream.size() - offset, header);
+        if (!reader) {
+            break;
+        }
+        if (header.type == RF_GPT_ENTITY_CREATE) {
+            auto packet = read_entity_create_packet(reader.value());
+            if (packet && packet.value().rest.player_id != 0xFF) {
+                checksum += packet.value().rest.weapon;
+            }
+        }
+        else if (header.type == RF_GPT_RELOAD) {
+            reader.value().skip(sizeof(RF_ReloadPacket::entity_handle));
+            checksum += reader.value().read<uint32_t>().value_or(0);
+        }
+        else if (header.type == RF_GPT_CHAT_LINE) {
+            reader.value().skip(2);
+            auto message = reader.value().read_string(RF_MAX_MSG_LEN);
+            checksum += message ? message.value().size() : 0;
+        }
+        offset += sizeof(header) + header.size;
+    }
+    return checksum;
+}
+
+template<typename F>
+static double measure(const BenchOptions& options, F&& fun, uint64_t& checksum)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.num_iterations; ++i) {
+        checksum = fun();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / options.num_iterations;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        bool has_value = i + 1 < argc;
+        if (arg == "-n" && has_value) {
+            options.num_packets = std::stoi(argv[++i]);
+        }
+        else if (arg == "-i" && has_value) {
+            options.num_iterations = std::stoi(argv[++i]);
+        }
+        else if (arg == "-s" && has_value) {
+            options.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else {
+            std::printf(
+                "Usage: packet_codec_bench [options...]\n\n"
+                "Available options:\n"
+                "-n count       number of packets (default: 100000)\n"
+                "-i count       number of iterations (default: 20)\n"
+                "-s seed        random seed (default: 1)\n"
+            );
+            return 1;
+        }
+    }
+
+    auto stream = generate_packets(options);
+    uint64_t raw_checksum = 0;
+    uint64_t codec_checksum = 0;
+    double raw_seconds = measure(options, [&]() { return parse_raw(stream); }, raw_checksum);
+    double codec_seconds = measure(options, [&]() { return parse_codec(stream); }, codec_checksum);
+
+    double megabytes = static_cast<double>(stream.size()) / (1024.0 * 1024.0);
+    std::printf("Packets: %d (%zu bytes)\n", options.num_packets, stream.size());
+    std::printf("Raw offsets: %.1f MB/s, %.1f ns/packet\n", megabytes / raw_seconds,
+        raw_seconds * 1e9 / options.num_packets);
+    std::printf("Codec: %.1f MB/s, %.1f ns/packet\n", megabytes / codec_seconds,
+        codec_seconds * 1e9 / options.num_packets);
+    if (raw_checksum != codec_checksum) {
+        std::printf("Checksum mismatch: %llu != %llu\n", static_cast<unsigned long long>(raw_checksum),
+            static_cast<unsigned long long>(codec_checksum));
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <cstdio>
+#include <cstring>
+#include <array>
+#include <exception>
+#include <string_view>
+#include <common/net/PacketLog.h>
+#include <common/rfproto.h>
+
+struct PacketTypeStats
+{
+    unsigned count = 0;
+    unsigned long long bytes = 0;
+};
+
+static void print_record(const PacketLogRecord& record)
+{
+    const auto* ip = reinterpret_cast<const unsigned char*>(&record.ip_addr);
+    unsigned port = ((record.port & 0xFF) << 8) | (record.port >> 8);
+    std::printf("%10.3f %u.%u.%u.%u:%u %s %zu bytes\n", record.timestamp_ms / 1000.0, ip[0], ip[1], ip[2], ip[3],
+        port, record.is_reliable() ? "R" : "U", record.data.size());
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc <= 1) {
+        std::printf(
+            "Usage: packet_log_dump [options...] packet_log_file\n\n"
+            "Available options:\n"
+            "-v             prints every datagram\n"
+        );
+        return 1;
+    }
+
+    bool verbose = false;
+    const char* filename = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        if (arg == "-v") {
+            verbose = true;
+        }
+        else {
+            filename = argv[i];
+        }
+    }
+    if (!filename) {
+        std::fprintf(stderr, "Packet log file not specified\n");
+        return 1;
+    }
+
+    try {
+        PacketLogReader reader{filename};
+        PacketLogRecord record;
+        unsigned num_datagrams = 0;
+        unsigned num_reliable = 0;
+        unsigned num_malformed = 0;
+        unsigned long long num_bytes = 0;
+        uint32_t last_timestamp_ms = 0;
+        std::array<PacketTypeStats, 256> type_stats{};
+
+        while (reader.read(record)) {
+            ++num_datagrams;
+            num_bytes += record.data.size();
+            last_timestamp_ms = record.timestamp_ms;
+            if (record.is_reliable()) {
+                ++num_reliable;
+            }
+            if (verbose) {
+                print_record(record);
+            }
+
+            // Datagram can contain multiple game packets
+            std::size_t offset = 0;
+            while (offset < record.data.size()) {
+                RF_GamePacketHeader header;
+                if (offset + sizeof(header) > record.data.size()) {
+                    ++num_malformed;
+                    break;
+                }
+                std::memcpy(&header, record.data.data() + offset, sizeof(header));
+                std::size_t packet_size = sizeof(header) + header.size;
+                if (offset + packet_size > record.data.size()) {
+                    ++num_malformed;
+                    break;
+                }
+                auto& stats = type_stats[header.type];
+                ++stats.count;
+                stats.bytes += packet_size;
+                offset += packet_size;
+            }
+        }
+
+        double duration = last_timestamp_ms / 1000.0;
+        std::printf("Capture start: %llu\n", static_cast<unsigned long long>(reader.start_time()));
+        std::printf("Duration: %.3f s\n", duration);
+        std::printf("Datagrams: %u (%u reliable, %u unreliable)\n", num_datagrams, num_reliable,
+            num_datagrams - num_reliable);
+        std::printf("Bytes: %llu\n", num_bytes);
+        std::printf("Malformed datagrams: %u\n", num_malformed);
+        std::printf("\n%-6s %10s %12s %10s\n", "Type", "Packets", "Bytes", "Avg size");
+        for (std::size_t type = 0; type < type_stats.size(); ++type) {
+            const auto& stats = type_stats[type];
+            if (stats.count > 0) {
+                std::printf("0x%02zX   %10u %12llu %10.1f\n", type, stats.count, stats.bytes,
+                    static_cast<double>(stats.bytes) / stats.count);
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <common/net/NetConditionSim.h>
+#include <common/net/ReliableTransport.h>
+
+struct SimOptions
+{
+    NetConditions conditions{50, 10, 0.05f};
+    int messages_per_second = 200;
+    int duration_ms = 30000;
+    int frame_ms = 16;
+    unsigned seed = 1;
+};
+
+struct Datagram
+{
+    int deliver_ms;
+    std::vector<std::byte> data;
+};
+
+// One direction of a link with simulated network conditions
+class SimLink
+{
+public:
+    SimLink(const NetConditions& conditions, unsigned seed) : sim_{seed}
+    {
+        sim_.set_conditions(conditions);
+    }
+
+    void send(const std::byte* data, std::size_t len, int now_ms)
+    {
+        std::array<int, 2> deliver_ms;
+        int count = sim_.schedule(len, now_ms, deliver_ms);
+        for (int i = 0; i < count; ++i) {
+            in_flight_.push_back({deliver_ms[i], {data, data + len}});
+        }
+    }
+
+    template<typename F>
+    void deliver(int now_ms, F&& callback)
+    {
+        auto it = std::partition(in_flight_.begin(), in_flight_.end(), [=](const Datagram& d) {
+            return d.deliver_ms > now_ms;
+        });
+        std::vector<Datagram> ready{std::make_move_iterator(it), std::make_move_iterator(in_flight_.end())};
+        in_flight_.erase(it, in_flight_.end());
+        // Jitter can reorder datagrams like a real network does
+        std::sort(ready.begin(), ready.end(), [](const Datagram& a, const Datagram& b) {
+            return a.deliver_ms < b.deliver_ms;
+        });
+        for (const auto& d : ready) {
+            callback(d.data.data(), d.data.size());
+        }
+    }
+
+    [[nodiscard]] const NetConditionSimStats& stats() const
+    {
+        return sim_.stats();
+    }
+
+private:
+    NetConditionSim sim_;
+    std::vector<Datagram> in_flight_;
+};
+
+// Message: u32 index, u32 write time, u16 payload size, payload
+constexpr std::size_t message_header_size = 10;
+
+static void write_message(ReliableSender& sender, uint32_t index, int now_ms, std::mt19937& rng)
+{
+    auto payload_size = std::uniform_int_distribution<uint16_t>{4, 200}(rng);
+    std::vector<std::byte> msg(message_header_size + payload_size);
+    auto write_time = static_cast<uint32_t>(now_ms);
+    std::memcpy(msg.data(), &index, sizeof(index));
+    std::memcpy(msg.data() + 4, &write_time, sizeof(write_time));
+    std::memcpy(msg.data() + 8, &payload_size, sizeof(payload_size));
+    for (uint16_t i = 0; i < payload_size; ++i) {
+        msg[message_header_size + i] = static_cast<std::byte>((index + i) & 0xFF);
+    }
+    sender.write(msg.data(), msg.size());
+}
+
+int main(int argc, char* argv[])
+{
+    SimOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        bool has_value = i + 1 < argc;
+        if (arg == "-l" && has_value) {
+            options.conditions.loss = std::stof(argv[++i]);
+        }
+        else if (arg == "-u" && has_value) {
+            options.conditions.duplicate = std::stof(argv[++i]);
+        }
+        else if (arg == "-r" && has_value) {
+            options.conditions.reorder = std::stof(argv[++i]);
+        }
+        else if (arg == "-d" && has_value) {
+            options.conditions.latency_ms = std::stoi(argv[++i]);
+        }
+        else if (arg == "-j" && has_value) {
+            options.conditions.jitter_ms = std::stoi(argv[++i]);
+        }
+        else if (arg == "-b" && has_value) {
+            options.conditions.bytes_per_second = std::stoi(argv[++i]);
+        }
+        else if (arg == "-m" && has_value) {
+            options.messages_per_second = std::stoi(argv[++i]);
+        }
+        else if (arg == "-t" && has_value) {
+            options.duration_ms = std::stoi(argv[++i]) * 1000;
+        }
+        else if (arg == "-f" && has_value) {
+            options.frame_ms = std::max(std::stoi(argv[++i]), 1);
+        }
+        else if (arg == "-s" && has_value) {
+            options.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else {
+            std::printf(
+                "Usage: reliable_transport_sim [options...]\n\n"
+                "Available options:\n"
+                "-l loss     packet loss probability in both directions (default: 0.05)\n"
+                "-u dup      packet duplication probability (default: 0)\n"
+                "-r reorder  probability of delaying a packet so it is reordered (default: 0)\n"
+                "-d ms       one-way delay (default: 50)\n"
+                "-j ms       maximal random jitter added to the delay (default: 10)\n"
+                "-b bytes    link bandwidth in bytes per second, 0 means unlimited (default: 0)\n"
+                "-m count    messages written per second (default: 200)\n"
+                "-t seconds  duration of sending (default: 30)\n"
+                "-f ms       frame time of both peers (default: 16)\n"
+                "-s seed     random seed (default: 1)\n"
+            );
+            return 1;
+        }
+    }
+
+    std::mt19937 rng{options.seed};
+    SimLink data_link{options.conditions, options.seed + 1};
+    SimLink ack_link{options.conditions, options.seed + 2};
+    ReliableSender sender;
+    ReliableReceiver receiver;
+    std::vector<std::byte> stream;
+    std::vector<std::byte> ack;
+    std::vector<int> latencies;
+    uint32_t num_written = 0;
+    uint32_t num_received = 0;
+    unsigned num_corrupted = 0;
+    int max_srtt = 0;
+
+    // Run until all data is delivered or the sender gives up (with a hard limit in case of a bug)
+    int end_ms = options.duration_ms + 120000;
+    int now_ms = 0;
+    for (; now_ms < end_ms; now_ms += options.frame_ms) {
+        // Sender frame
+        ack_link.deliver(now_ms, [&](const std::byte* data, std::size_t len) {
+            sender.process_ack(data, len, now_ms);
+        });
+        if (now_ms < options.duration_ms) {
+            auto target = static_cast<uint32_t>(static_cast<long long>(now_ms) * options.messages_per_second / 1000);
+            while (num_written < target) {
+                write_message(sender, num_written++, now_ms, rng);
+            }
+        }
+        sender.poll(now_ms, [&](const std::byte* data, std::size_t len) {
+            data_link.send(data, len, now_ms);
+        });
+        max_srtt = std::max(max_srtt, sender.srtt_ms());
+
+        // Receiver frame
+        data_link.deliver(now_ms, [&](const std::byte* data, std::size_t len) {
+            receiver.process_data(data, len);
+        });
+        receiver.read(stream);
+        std::size_t offset = 0;
+        while (stream.size() - offset >= message_header_size) {
+            uint32_t index;
+            uint32_t write_time;
+            uint16_t payload_size;
+            std::memcpy(&index, stream.data() + offset, sizeof(index));
+            std::memcpy(&write_time, stream.data() + offset + 4, sizeof(write_time));
+            std::memcpy(&payload_size, stream.data() + offset + 8, sizeof(payload_size));
+            if (stream.size() - offset < message_header_size + payload_size) {
+                break;
+            }
+            bool valid = index == num_received;
+            for (uint16_t i = 0; i < payload_size && valid; ++i) {
+                valid = stream[offset + message_header_size + i] == static_cast<std::byte>((index + i) & 0xFF);
+            }
+            if (!valid) {
+                ++num_corrupted;
+            }
+            latencies.push_back(now_ms - static_cast<int>(write_time));
+            ++num_received;
+            offset += message_header_size + payload_size;
+        }
+        stream.erase(stream.begin(), stream.begin() + static_cast<std::ptrdiff_t>(offset));
+        if (receiver.poll_ack(ack)) {
+            ack_link.send(ack.data(), ack.size(), now_ms);
+        }
+
+        if (sender.failed() || (now_ms >= options.duration_ms && sender.idle() && num_received == num_written)) {
+            break;
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        if (latencies.empty()) {
+            return 0;
+        }
+        auto idx = static_cast<std::size_t>(p * static_cast<double>(latencies.size() - 1));
+        return latencies[idx];
+    };
+    const auto& stats = sender.stats();
+    std::printf("Messages: %u written, %u received, %u corrupted or out of order\n", num_written, num_received,
+        num_corrupted);
+    std::printf("Datagrams: %llu data (%llu lost), %llu ack (%llu lost)\n", data_link.stats().num_datagrams,
+        data_link.stats().num_lost, ack_link.stats().num_datagrams, ack_link.stats().num_lost);
+    std::printf("Segments: %llu sent, %llu retransmits (%llu fast), %llu timeouts\n", stats.num_segments_sent,
+        stats.num_retransmits, stats.num_fast_retransmits, stats.num_timeouts);
+    std::printf("RTT: final %d ms, max %d ms, RTO %d ms, cwnd %.1f\n", sender.srtt_ms(), max_srtt, sender.rto_ms(),
+        sender.cwnd());
+    std::printf("Latency: p50 %d ms, p90 %d ms, p99 %d ms, max %d ms\n", percentile(0.5), percentile(0.9),
+        percentile(0.99), percentile(1.0));
+    if (sender.failed()) {
+        std::printf("Sender gave up after too many retransmissions\n");
+    }
+    bool ok = !sender.failed() && num_corrupted == 0 && num_received == num_written;
+    return ok ? 0 : 2;
+}
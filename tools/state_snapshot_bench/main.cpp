@@ -0,0 +1,253 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <common/net/PacketLog.h>
+#include <common/net/StateSnapshot.h>
+#include <common/rfproto.h>
+
+struct BenchOptions
+{
+    const char* packet_log = nullptr;
+    int num_booleans = 500;
+    int num_glass = 100;
+    int num_clutter = 200;
+    int num_triggers = 20;
+    int compression_level = 6;
+    int num_iterations = 20;
+    unsigned seed = 1;
+};
+
+struct BenchResult
+{
+    unsigned num_snapshots = 0;
+    unsigned num_packets = 0;
+    unsigned num_mismatched = 0;
+    unsigned long long raw_bytes = 0;
+    unsigned long long compressed_bytes = 0;
+    unsigned long long num_chunks = 0;
+    double build_seconds = 0;
+    double receive_seconds = 0;
+};
+
+template<typename T>
+static void append_packet(std::vector<std::byte>& out, uint8_t type, const T& payload)
+{
+    RF_GamePacketHeader header{type, static_cast<uint16_t>(sizeof(payload))};
+    auto offset = out.size();
+    out.resize(offset + sizeof(header) + sizeof(payload));
+    std::memcpy(out.data() + offset, &header, sizeof(header));
+    std::memcpy(out.data() + offset + sizeof(header), &payload, sizeof(payload));
+}
+
+// Generates packets sent by the server to a player joining a heavily geomodded level
+static std::vector<std::byte> generate_state(const BenchOptions& options)
+{
+    std::mt19937 rng{options.seed};
+    std::uniform_real_distribution<float> pos_dist{-200.0f, 200.0f};
+    std::uniform_int_distribution<uint32_t> uid_dist{1, 20000};
+    std::vector<std::byte> packets;
+    for (int i = 0; i < options.num_booleans; ++i) {
+        // Geomod crater: flags, position and random seed of the crater shape
+        struct
+        {
+            uint8_t flags;
+            float pos[3];
+            float scale;
+            uint32_t seed;
+            uint8_t padding[13];
+        } boolean{1, {pos_dist(rng), pos_dist(rng) / 10.0f, pos_dist(rng)}, 1.0f, static_cast<uint32_t>(rng()), {}};
+        append_packet(packets, RF_GPT_BOOLEAN, boolean);
+    }
+    for (int i = 0; i < options.num_glass; ++i) {
+        struct
+        {
+            int32_t room_id;
+            uint8_t explosion;
+            float pos[3];
+            float unknown[3];
+        } glass{
+            static_cast<int32_t>(0x7FFFFFFF - i), 0, {pos_dist(rng), pos_dist(rng), pos_dist(rng)}, {0.0f, 1.0f, 0.0f},
+        };
+        append_packet(packets, RF_GPT_GLASS_KILL, glass);
+    }
+    for (int i = 0; i < options.num_clutter; ++i) {
+        struct
+        {
+            uint32_t uid;
+            uint32_t reason;
+        } clutter{uid_dist(rng), 1};
+        append_packet(packets, RF_GPT_CLUTTER_KILL, clutter);
+    }
+    for (int i = 0; i < options.num_triggers; ++i) {
+        struct
+        {
+            uint32_t uid;
+            int32_t entity_handle;
+        } trigger{uid_dist(rng), -1};
+        append_packet(packets, RF_GPT_TRIGGER_ACTIVATE, trigger);
+    }
+    RF_GamePacketHeader done{RF_GPT_STATE_INFO_DONE, 0};
+    auto offset = packets.size();
+    packets.resize(offset + sizeof(done));
+    std::memcpy(packets.data() + offset, &done, sizeof(done));
+    return packets;
+}
+
+// Extracts packets sent in response to state_info_request from a client-side packet log. Every burst ends with
+// state_info_done and starts after the previous one (or leave_limbo packet that starts the level change).
+static std::vector<std::vector<std::byte>> extract_states(const char* packet_log)
+{
+    PacketLogReader reader{packet_log};
+    PacketLogRecord record;
+    std::vector<std::vector<std::byte>> states;
+    std::vector<std::byte> current;
+    while (reader.read(record)) {
+        if (!record.is_reliable()) {
+            continue;
+        }
+        std::size_t offset = 0;
+        while (offset + sizeof(RF_GamePacketHeader) <= record.data.size()) {
+            RF_GamePacketHeader header;
+            std::memcpy(&header, record.data.data() + offset, sizeof(header));
+            std::size_t packet_size = sizeof(header) + header.size;
+            if (offset + packet_size > record.data.size()) {
+                break;
+            }
+            if (header.type == RF_GPT_LEAVE_LIMBO) {
+                current.clear();
+            }
+            else {
+                auto* packet = record.data.data() + offset;
+                current.insert(current.end(), packet, packet + packet_size);
+                if (header.type == RF_GPT_STATE_INFO_DONE) {
+                    states.push_back(std::move(current));
+                    current.clear();
+                }
+            }
+            offset += packet_size;
+        }
+    }
+    return states;
+}
+
+static void run(const BenchOptions& options, const std::vector<std::byte>& state, BenchResult& result)
+{
+    StateSnapshotBuilder builder;
+    unsigned num_packets = 0;
+    state_snapshot_for_each_packet(state, [&](const std::byte*, std::size_t) { ++num_packets; });
+
+    std::vector<std::vector<std::byte>> chunks;
+    auto build_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.num_iterations; ++i) {
+        builder.clear();
+        state_snapshot_for_each_packet(state, [&](const std::byte* data, std::size_t len) {
+            builder.add_packet(data, len);
+        });
+        chunks = builder.build(static_cast<uint16_t>(i), options.compression_level);
+    }
+    result.build_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count() /
+        options.num_iterations;
+
+    StateSnapshotReceiver receiver;
+    bool complete = false;
+    auto receive_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.num_iterations; ++i) {
+        receiver.reset();
+        for (const auto& chunk : chunks) {
+            complete = receiver.add_chunk(chunk.data(), chunk.size()) == StateSnapshotReceiver::Result::complete;
+        }
+    }
+    result.receive_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - receive_start).count() /
+        options.num_iterations;
+
+    ++result.num_snapshots;
+    result.num_packets += num_packets;
+    result.raw_bytes += state.size();
+    result.num_chunks += chunks.size();
+    for (const auto& chunk : chunks) {
+        result.compressed_bytes += chunk.size();
+    }
+    if (!complete || receiver.data() != state) {
+        ++result.num_mismatched;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        bool has_value = i + 1 < argc;
+        if (arg == "-f" && has_value) {
+            options.packet_log = argv[++i];
+        }
+        else if (arg == "-b" && has_value) {
+            options.num_booleans = std::stoi(argv[++i]);
+        }
+        else if (arg == "-g" && has_value) {
+            options.num_glass = std::stoi(argv[++i]);
+        }
+        else if (arg == "-c" && has_value) {
+            options.num_clutter = std::stoi(argv[++i]);
+        }
+        else if (arg == "-z" && has_value) {
+            options.compression_level = std::stoi(argv[++i]);
+        }
+        else if (arg == "-i" && has_value) {
+            options.num_iterations = std::stoi(argv[++i]);
+        }
+        else if (arg == "-s" && has_value) {
+            options.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else {
+            std::printf(
+                "Usage: state_snapshot_bench [options...]\n\n"
+                "Available options:\n"
+                "-f packet_log  uses level states received in a packet log instead of a synthetic one\n"
+                "-b count       number of geomod craters in synthetic state (default: 500)\n"
+                "-g count       number of broken glass faces in synthetic state (default: 100)\n"
+                "-c count       number of destroyed clutter objects in synthetic state (default: 200)\n"
+                "-z level       zlib compression level (default: 6)\n"
+                "-i count       number of iterations (default: 20)\n"
+                "-s seed        random seed (default: 1)\n"
+            );
+            return 1;
+        }
+    }
+
+    BenchResult result;
+    try {
+        if (options.packet_log) {
+            for (const auto& state : extract_states(options.packet_log)) {
+                run(options, state, result);
+            }
+        }
+        else {
+            run(options, generate_state(options), result);
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    if (result.num_snapshots == 0) {
+        std::printf("No level states\n");
+        return 1;
+    }
+    // Stock server packs reliable packets into datagrams of at most 512 bytes
+    unsigned long long stock_datagrams = (result.raw_bytes + 511) / 512;
+    std::printf("Snapshots: %u (%u packets, %u mismatched)\n", result.num_snapshots, result.num_packets,
+        result.num_mismatched);
+    std::printf("Raw bytes: %llu (at least %llu reliable datagrams)\n", result.raw_bytes, stock_datagrams);
+    std::printf("Compressed bytes: %llu in %llu chunks (%.1f%% of raw)\n", result.compressed_bytes, result.num_chunks,
+        100.0 * static_cast<double>(result.compressed_bytes) / static_cast<double>(result.raw_bytes));
+    std::printf("Build: %.1f us/snapshot, receive: %.1f us/snapshot\n",
+        result.build_seconds * 1e6 / result.num_snapshots, result.receive_seconds * 1e6 / result.num_snapshots);
+    return result.num_mismatched == 0 ? 0 : 2;
+}